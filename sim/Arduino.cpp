@@ -0,0 +1,380 @@
+#include "Arduino.h"
+
+#include <avr/sleep.h>
+#include <util/atomic.h>
+
+#include "Simulation.h"
+
+// Registers backed by the simulation.
+SimRegister ADCSRA(Simulation::readAdcControl, Simulation::writeAdcControl);
+SimRegister TWCR(Simulation::readTwiControl, Simulation::writeTwiControl);
+
+// Plain registers.
+volatile uint8_t ADMUX = 0;
+volatile uint8_t ADCSRB = 0;
+volatile uint8_t DIDR0 = 0;
+volatile uint16_t ADC = 0;
+
+volatile uint8_t TWBR = 0;
+volatile uint8_t TWSR = 0;
+volatile uint8_t TWDR = 0;
+volatile uint8_t TWAR = 0;
+
+volatile uint8_t PINB = 0;
+volatile uint8_t PINC = 0;
+volatile uint8_t PIND = 0;
+
+volatile uint8_t PCICR = 0;
+volatile uint8_t PCMSK0 = 0;
+volatile uint8_t PCMSK1 = 0;
+volatile uint8_t PCMSK2 = 0;
+
+// Serial port.
+HardwareSerial Serial;
+
+// Sleep mode, and whether sleeping is enabled.
+static uint8_t sleep_mode = SLEEP_MODE_IDLE;
+static bool sleep_enabled = false;
+
+uint32_t millis()
+{
+    Simulation::advance(SIM_CLOCK_READ_CYCLES);
+
+    return Simulation::getAwakeTime() / SIM_CYCLES_PER_MS;
+}
+
+uint32_t micros()
+{
+    Simulation::advance(SIM_CLOCK_READ_CYCLES);
+
+    return Simulation::getAwakeTime() / SIM_CYCLES_PER_US;
+}
+
+void delay(uint32_t ms)
+{
+    Simulation::advance((uint64_t) ms * SIM_CYCLES_PER_MS);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    Simulation::advance((uint64_t) us * SIM_CYCLES_PER_US);
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    Simulation::setPinMode(pin, mode);
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    Simulation::writePin(pin, value);
+}
+
+int digitalRead(uint8_t pin)
+{
+    return Simulation::readPin(pin);
+}
+
+int analogRead(uint8_t pin)
+{
+    uint8_t mux = pin >= A0 ? pin - A0 : pin;
+
+    ADMUX = (ADMUX & 0xF0) | mux;
+    Simulation::advance(SIM_ADC_CONVERSION_CYCLES);
+
+    return Simulation::sample(mux);
+}
+
+void analogReference(uint8_t mode)
+{
+}
+
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout)
+{
+    uint32_t started = micros();
+    uint32_t pulse;
+
+    // Wait for any previous pulse to end, then for the pulse to start
+    while (digitalRead(pin) == state) {
+        if ((micros() - started) >= timeout) {
+            return 0;
+        }
+    }
+
+    while (digitalRead(pin) != state) {
+        if ((micros() - started) >= timeout) {
+            return 0;
+        }
+    }
+
+    pulse = micros();
+
+    while (digitalRead(pin) == state) {
+        if ((micros() - started) >= timeout) {
+            return 0;
+        }
+    }
+
+    return micros() - pulse;
+}
+
+void attachInterrupt(uint8_t interrupt, void (*callback)(void), int mode)
+{
+    Simulation::attachInterrupt(interrupt, callback, mode);
+}
+
+void detachInterrupt(uint8_t interrupt)
+{
+    Simulation::detachInterrupt(interrupt);
+}
+
+void interrupts()
+{
+    Simulation::enableInterrupts();
+}
+
+void noInterrupts()
+{
+    Simulation::disableInterrupts();
+}
+
+void sei()
+{
+    Simulation::enableInterrupts();
+}
+
+void cli()
+{
+    Simulation::disableInterrupts();
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+void set_sleep_mode(uint8_t mode)
+{
+    sleep_mode = mode;
+}
+
+void sleep_enable()
+{
+    sleep_enabled = true;
+}
+
+void sleep_disable()
+{
+    sleep_enabled = false;
+}
+
+void sleep_cpu()
+{
+    if (sleep_enabled) {
+        Simulation::idle(sleep_mode == SLEEP_MODE_ADC);
+    }
+}
+
+SimAtomicBlock::SimAtomicBlock(bool restore)
+{
+    this->entered = false;
+    this->restore = restore;
+    this->enabled = Simulation::areInterruptsEnabled();
+
+    Simulation::disableInterrupts();
+}
+
+SimAtomicBlock::~SimAtomicBlock()
+{
+    if (!this->restore || this->enabled) {
+        Simulation::enableInterrupts();
+    }
+}
+
+void simulateReset()
+{
+    throw SimulationReset();
+}
+
+int simulateFreeMemory()
+{
+    return SIM_FREE_MEMORY;
+}
+
+String::String(const char* value)
+{
+    this->buffer = NULL;
+    this->assign(value, strlen(value));
+}
+
+String::String(const String& other)
+{
+    this->buffer = NULL;
+    this->assign(other.buffer, other.size);
+}
+
+String::~String()
+{
+    free(this->buffer);
+}
+
+String& String::operator=(const String& other)
+{
+    if (this != &other) {
+        this->assign(other.buffer, other.size);
+    }
+
+    return *this;
+}
+
+String& String::operator=(const char* value)
+{
+    this->assign(value, strlen(value));
+
+    return *this;
+}
+
+String& String::operator+=(char ch)
+{
+    this->buffer = (char*) realloc(this->buffer, this->size + 2);
+    this->buffer[this->size++] = ch;
+    this->buffer[this->size] = '\0';
+
+    return *this;
+}
+
+String& String::operator+=(const char* value)
+{
+    while (*value) {
+        *this += *value++;
+    }
+
+    return *this;
+}
+
+unsigned int String::length() const
+{
+    return this->size;
+}
+
+const char* String::c_str() const
+{
+    return this->buffer;
+}
+
+int String::indexOf(char ch) const
+{
+    const char* found = strchr(this->buffer, ch);
+
+    return found == NULL ? -1 : found - this->buffer;
+}
+
+String String::substring(unsigned int from) const
+{
+    return this->substring(from, this->size);
+}
+
+String String::substring(unsigned int from, unsigned int to) const
+{
+    String result;
+
+    if (from > to) {
+        unsigned int swap = from;
+
+        from = to;
+        to = swap;
+    }
+
+    to = min(to, this->size);
+
+    if (from < to) {
+        result.assign(this->buffer + from, to - from);
+    }
+
+    return result;
+}
+
+long String::toInt() const
+{
+    return atol(this->buffer);
+}
+
+void String::toCharArray(char* buffer, unsigned int size) const
+{
+    if (!size) {
+        return;
+    }
+
+    strncpy(buffer, this->buffer, size - 1);
+    buffer[size - 1] = '\0';
+}
+
+void String::assign(const char* value, unsigned int length)
+{
+    char* copy = (char*) malloc(length + 1);
+
+    memcpy(copy, value, length);
+    copy[length] = '\0';
+
+    free(this->buffer);
+    this->buffer = copy;
+    this->size = length;
+}
+
+void HardwareSerial::begin(unsigned long baud)
+{
+}
+
+void HardwareSerial::end()
+{
+}
+
+int HardwareSerial::available()
+{
+    return Simulation::availableSerial();
+}
+
+int HardwareSerial::read()
+{
+    return Simulation::readSerial();
+}
+
+int HardwareSerial::peek()
+{
+    return Simulation::peekSerial();
+}
+
+int HardwareSerial::availableForWrite()
+{
+    return SERIAL_TX_BUFFER_SIZE - 1;
+}
+
+size_t HardwareSerial::write(uint8_t ch)
+{
+    return fputc(ch, stdout) == EOF ? 0 : 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size)
+{
+    return fwrite(buffer, 1, size, stdout);
+}
+
+size_t HardwareSerial::print(const char* value)
+{
+    return fputs(value, stdout) == EOF ? 0 : strlen(value);
+}
+
+size_t HardwareSerial::print(char ch)
+{
+    return this->write((uint8_t) ch);
+}
+
+void HardwareSerial::flush()
+{
+    fflush(stdout);
+}
+
+HardwareSerial::operator bool()
+{
+    return true;
+}
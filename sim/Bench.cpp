@@ -0,0 +1,453 @@
+#include <time.h>
+#include <unistd.h>
+
+#include "Simulation.h"
+
+#include <Logging.h>
+
+#include "ConfigurationManager.h"
+#include "CommandManager.h"
+#include "LogManager.h"
+#include "ModuleManager.h"
+#include "AdcManager.h"
+
+#define BENCH_DEFAULT_ITERATIONS 1000
+#define BENCH_DEFAULT_BASELINE "bench/baseline.txt"
+
+// Every benchmark is run this many times; the fastest run counts for the host
+// time, as anything slower is the host being busy with something else.
+#define BENCH_RUNS 5
+
+// Differences in host time this small are noise, whatever the percentage.
+#define BENCH_HOST_SLACK 10.0
+
+#define BENCH_MAX_BENCHMARKS 16
+#define BENCH_NAME_SIZE 24
+#define BENCH_LINE_SIZE 128
+
+// Module configuration used throughout: a generic voltage sensor on A0.
+#define BENCH_MODULE_SLOT 0
+#define BENCH_MODULE_CONFIGURATION "6,14,4"
+#define BENCH_MODULE_PIN A0
+
+// Sketch entry points, from src/main.cpp.
+void setup();
+void serialEvent();
+
+/**
+ * A hot path of the firmware, called over and over.
+ */
+struct Benchmark {
+    const char* name;
+    void (*function)();
+};
+
+/**
+ * Cost per call: host time in nanoseconds, simulated time spent awake in
+ * microseconds, allocations made, and allocations not freed again.
+ */
+struct Result {
+    char name[BENCH_NAME_SIZE];
+    double host;
+    double simulated;
+    double allocations;
+    double retained;
+};
+
+// Allocations counted while a benchmark runs.
+static bool counting = false;
+static uint64_t allocations = 0;
+static uint64_t frees = 0;
+
+// Objects the benchmarks work on.
+static GenericVoltage* voltage = NULL;
+static char module_configuration[] = BENCH_MODULE_CONFIGURATION;
+static char command_arguments[] = "11";
+static CommandManager::Response command_response;
+static volatile int32_t sink;
+
+// Allocation counting. Replacing malloc() and friends catches every
+// allocation, including those made by the C and C++ libraries on behalf of
+// the firmware, e.g. by strdup() or operator new.
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* pointer, size_t size);
+    void __libc_free(void* pointer);
+
+    void* malloc(size_t size) noexcept
+    {
+        allocations += counting;
+
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size) noexcept
+    {
+        allocations += counting;
+
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* pointer, size_t size) noexcept
+    {
+        allocations += counting && size;
+        frees += counting && pointer != NULL;
+
+        return __libc_realloc(pointer, size);
+    }
+
+    void free(void* pointer) noexcept
+    {
+        frees += counting && pointer != NULL;
+
+        __libc_free(pointer);
+    }
+}
+
+/**
+ * Return the host time in nanoseconds.
+ *
+ * @return uint64_t
+ */
+static uint64_t getHostTime()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t) now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+static void registerModule()
+{
+    ModuleManager::registerModule(BENCH_MODULE_SLOT, module_configuration);
+}
+
+static void updateModules()
+{
+    ModuleManager::updateModules();
+}
+
+static void handleCommand()
+{
+    CommandManager::handleCommand(43, command_arguments, &command_response);
+}
+
+static void handleUnknownCommand()
+{
+    CommandManager::handleCommand(99, command_arguments, &command_response);
+}
+
+static void handleSerialInput()
+{
+    Simulation::feedSerial("43 11\n");
+    serialEvent();
+}
+
+static void getConfiguration()
+{
+    sink = ConfigurationManager::getInteger(CFG_LOOP_DELAY) + ConfigurationManager::getBoolean(CFG_DEBUG);
+}
+
+static void setConfiguration()
+{
+    ConfigurationManager::setInteger(CFG_LOOP_DELAY, ConfigurationManager::getInteger(CFG_LOOP_DELAY));
+}
+
+static void saveConfiguration()
+{
+    ConfigurationManager::save();
+}
+
+static void getVoltageLevel()
+{
+    sink = voltage->getLevel();
+}
+
+static void logLine()
+{
+    LogManager::debug(LOG_MOD, F("mod: spike rejected; slot=%d, value=%l" CR), 1, (int32_t) -12345);
+    LogManager::drain();
+}
+
+// Benchmarks, in the order they're run in.
+static const Benchmark benchmarks[] = {
+    { "mod::register", registerModule },
+    { "mod::update", updateModules },
+    { "cmd::handle", handleCommand },
+    { "cmd::unknown", handleUnknownCommand },
+    { "serial::input", handleSerialInput },
+    { "cfg::get", getConfiguration },
+    { "cfg::set", setConfiguration },
+    { "cfg::save", saveConfiguration },
+    { "volt::level", getVoltageLevel },
+    { "log::line", logLine },
+};
+
+/**
+ * Run a benchmark, and measure its cost per call.
+ *
+ * @return void
+ */
+static void measure(const Benchmark* benchmark, uint32_t iterations, Result* result)
+{
+    uint64_t awake = 0;
+    uint64_t host;
+    uint64_t fastest = UINT64_MAX;
+    uint32_t run;
+    uint32_t i;
+
+    snprintf(result->name, sizeof(result->name), "%s", benchmark->name);
+
+    // Warm up caches and anything allocated on first use
+    for (i = 0; i < iterations / 10 + 1; i++) {
+        benchmark->function();
+    }
+
+    allocations = 0;
+    frees = 0;
+
+    for (run = 0; run < BENCH_RUNS; run++) {
+        awake = Simulation::getAwakeTime();
+        counting = true;
+        host = getHostTime();
+
+        for (i = 0; i < iterations; i++) {
+            benchmark->function();
+        }
+
+        host = getHostTime() - host;
+        counting = false;
+        awake = Simulation::getAwakeTime() - awake;
+
+        fastest = min(fastest, host);
+    }
+
+    result->host = (double) fastest / iterations;
+    result->simulated = (double) awake / iterations / SIM_CYCLES_PER_US;
+    result->allocations = (double) allocations / BENCH_RUNS / iterations;
+    result->retained = ((double) allocations - frees) / BENCH_RUNS / iterations;
+}
+
+/**
+ * Read a baseline, as written by writeBaseline().
+ *
+ * @return uint8_t Amount of results read, or 0 if there's no baseline
+ */
+static uint8_t readBaseline(const char* path, Result* results)
+{
+    char line[BENCH_LINE_SIZE];
+    uint8_t count = 0;
+    FILE* file = fopen(path, "r");
+    Result* result;
+
+    if (file == NULL) {
+        return 0;
+    }
+
+    while (count < BENCH_MAX_BENCHMARKS && fgets(line, sizeof(line), file) != NULL) {
+        result = &results[count];
+
+        if (line[0] == '#') {
+            continue;
+        }
+
+        if (sscanf(line, "%23s %lf %lf %lf %lf", result->name, &result->host, &result->simulated, &result->allocations, &result->retained) == 5) {
+            count++;
+        }
+    }
+
+    fclose(file);
+
+    return count;
+}
+
+static bool writeBaseline(const char* path, const Result* results, uint8_t count)
+{
+    FILE* file = fopen(path, "w");
+    uint8_t i;
+
+    if (file == NULL) {
+        fprintf(stderr, "bench: can't write baseline; path=%s\n", path);
+
+        return false;
+    }
+
+    fprintf(file, "# name, host ns, simulated us, allocations and allocations retained per call\n");
+
+    for (i = 0; i < count; i++) {
+        fprintf(
+            file,
+            "%s %.1f %.3f %.3f %.3f\n",
+            results[i].name, results[i].host, results[i].simulated, results[i].allocations, results[i].retained
+        );
+    }
+
+    return !fclose(file);
+}
+
+static const Result* findResult(const Result* results, uint8_t count, const char* name)
+{
+    uint8_t i;
+
+    for (i = 0; i < count; i++) {
+        if (!strcmp(results[i].name, name)) {
+            return &results[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Compare a result against its baseline. Allocations and simulated time are
+ * exact, so any increase is a regression. Host time varies from run to run
+ * and from machine to machine, so it's only compared if a tolerance is given,
+ * allowing it to be that percentage slower, and a few nanoseconds on top.
+ *
+ * @return const char* What regressed, or NULL if nothing did
+ */
+static const char* compare(const Result* result, const Result* baseline, uint32_t tolerance)
+{
+    if (result->allocations > baseline->allocations + 0.0005) {
+        return "allocations";
+    }
+
+    if (result->retained > baseline->retained + 0.0005) {
+        return "retained";
+    }
+
+    if (result->simulated > baseline->simulated + 0.0005) {
+        return "simulated time";
+    }
+
+    if (tolerance && result->host > (baseline->host * (100 + tolerance) / 100) + BENCH_HOST_SLACK) {
+        return "host time";
+    }
+
+    return NULL;
+}
+
+static void usage(const char* name)
+{
+    fprintf(
+        stderr,
+        "usage: %s [-n iterations] [-b baseline] [-x percent] [-w]\n"
+        "  -n  calls per run of a benchmark (default %d)\n"
+        "  -b  baseline to compare against (default %s)\n"
+        "  -x  also compare host time, tolerating a slowdown of this many %%\n"
+        "  -w  write the results as the new baseline\n",
+        name, BENCH_DEFAULT_ITERATIONS, BENCH_DEFAULT_BASELINE
+    );
+}
+
+/**
+ * Benchmark the firmware's hot paths, and compare the results against a
+ * baseline.
+ *
+ * @return int 1 if anything regressed
+ */
+int main(int argc, char** argv)
+{
+    Result results[BENCH_MAX_BENCHMARKS];
+    Result baselines[BENCH_MAX_BENCHMARKS];
+    const Result* baseline;
+    const char* baseline_path = BENCH_DEFAULT_BASELINE;
+    const char* regression;
+    uint32_t iterations = BENCH_DEFAULT_ITERATIONS;
+    uint32_t tolerance = 0;
+    uint8_t count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+    uint8_t baseline_count;
+    uint8_t regressions = 0;
+    bool write = false;
+    int option;
+    uint8_t i;
+
+    while ((option = getopt(argc, argv, "n:b:x:w")) != -1) {
+        switch (option) {
+            case 'n':
+                iterations = max(atoi(optarg), 1);
+
+                break;
+            case 'b':
+                baseline_path = optarg;
+
+                break;
+            case 'x':
+                tolerance = atoi(optarg);
+
+                break;
+            case 'w':
+                write = true;
+
+                break;
+            default:
+                usage(argv[0]);
+
+                return 1;
+        }
+    }
+
+    Logging::setMuted(true);
+    Simulation::setAnalog(BENCH_MODULE_PIN - A0, 512, 4);
+
+    // Start from the default configuration, with a single module
+    setup();
+    registerModule();
+    AdcManager::sweep();
+
+    voltage = new GenericVoltage(BENCH_MODULE_PIN, 4);
+    voltage->read();
+
+    for (i = 0; i < count; i++) {
+        measure(&benchmarks[i], iterations, &results[i]);
+    }
+
+    baseline_count = write ? 0 : readBaseline(baseline_path, baselines);
+
+    printf("# kalmon-bench\n");
+    printf("iterations:  %u per run, fastest of %d runs\n", iterations, BENCH_RUNS);
+    printf("baseline:    %s\n", write ? "writing" : (baseline_count ? baseline_path : "none"));
+
+    if (tolerance) {
+        printf("host time:   compared, %u%% slowdown tolerated\n", tolerance);
+    } else {
+        printf("host time:   not compared\n");
+    }
+
+    printf(
+        "\n%-16s %10s %12s %10s %10s %12s %8s\n",
+        "benchmark", "host ns", "sim us", "allocs", "retained", "baseline ns", "change"
+    );
+
+    for (i = 0; i < count; i++) {
+        baseline = findResult(baselines, baseline_count, results[i].name);
+        regression = baseline != NULL ? compare(&results[i], baseline, tolerance) : NULL;
+        regressions += regression != NULL;
+
+        printf("%-16s %10.1f %12.3f %10.3f %10.3f", results[i].name, results[i].host, results[i].simulated, results[i].allocations, results[i].retained);
+
+        if (baseline == NULL) {
+            printf(" %12s %8s\n", "-", "-");
+        } else {
+            printf(
+                " %12.1f %+7.1f%%%s%s\n",
+                baseline->host,
+                baseline->host ? (results[i].host - baseline->host) * 100 / baseline->host : 0,
+                regression != NULL ? " regressed: " : "",
+                regression != NULL ? regression : ""
+            );
+        }
+    }
+
+    if (write && !writeBaseline(baseline_path, results, count)) {
+        return 1;
+    }
+
+    if (regressions) {
+        printf("\n%u of %u benchmarks regressed\n", regressions, count);
+    }
+
+    return regressions ? 1 : 0;
+}
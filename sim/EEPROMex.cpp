@@ -0,0 +1,178 @@
+#include "EEPROMex.h"
+
+// EEPROM.
+EEPROMClassEx EEPROM;
+
+// Contents, erased until loaded from the backing file.
+static uint8_t memory[EEPROMSizeATmega328];
+static bool loaded = false;
+
+// Backing file, or NULL to keep the contents in memory only.
+static const char* file_path = NULL;
+
+// Amount of bytes written, as a measure of wear.
+static uint32_t writes = 0;
+
+/**
+ * Load the contents from the backing file on first access.
+ *
+ * @return void
+ */
+static void load()
+{
+    FILE* file;
+
+    if (loaded) {
+        return;
+    }
+
+    loaded = true;
+    memset(memory, 0xFF, sizeof(memory));
+
+    if (file_path == NULL || (file = fopen(file_path, "rb")) == NULL) {
+        return;
+    }
+
+    if (fread(memory, 1, sizeof(memory), file) != sizeof(memory)) {
+        fprintf(stderr, "sim: short eeprom image; path=%s\n", file_path);
+    }
+
+    fclose(file);
+}
+
+/**
+ * Write the contents to the backing file.
+ *
+ * @return void
+ */
+static void store()
+{
+    FILE* file;
+
+    if (file_path == NULL) {
+        return;
+    }
+
+    file = fopen(file_path, "wb");
+
+    if (file == NULL) {
+        fprintf(stderr, "sim: can't write eeprom image; path=%s\n", file_path);
+
+        return;
+    }
+
+    fwrite(memory, 1, sizeof(memory), file);
+    fclose(file);
+}
+
+EEPROMClassEx::EEPROMClassEx()
+{
+    this->base = 0;
+    this->size = EEPROMSizeATmega328;
+    this->next = 0;
+}
+
+/**
+ * Set the file backing the EEPROM. It is created on the first write.
+ *
+ * @return void
+ */
+void EEPROMClassEx::setFile(const char* path)
+{
+    file_path = path;
+    loaded = false;
+}
+
+/**
+ * Return the amount of bytes written so far.
+ *
+ * @return uint32_t
+ */
+uint32_t EEPROMClassEx::getWriteCount()
+{
+    return writes;
+}
+
+void EEPROMClassEx::setMemPool(int base, int size)
+{
+    this->base = base;
+    this->size = min(size, EEPROMSizeATmega328);
+    this->next = base;
+}
+
+int EEPROMClassEx::getAddress(int bytes)
+{
+    int address = this->next;
+
+    if (this->next + bytes > this->size) {
+        return -bytes;
+    }
+
+    this->next += bytes;
+
+    return address;
+}
+
+uint8_t EEPROMClassEx::read(int address)
+{
+    uint8_t value = 0;
+
+    this->readBytes(address, &value, 1);
+
+    return value;
+}
+
+bool EEPROMClassEx::write(int address, uint8_t value)
+{
+    return this->writeBytes(address, &value, 1, false) == 1;
+}
+
+bool EEPROMClassEx::update(int address, uint8_t value)
+{
+    return this->writeBytes(address, &value, 1, true) == 1;
+}
+
+int EEPROMClassEx::readBytes(int address, uint8_t* buffer, int length)
+{
+    if (address < 0 || address + length > this->size) {
+        return 0;
+    }
+
+    load();
+    memcpy(buffer, memory + address, length);
+
+    return length;
+}
+
+/**
+ * Write bytes, skipping those that are unchanged when updating, and persist
+ * the result.
+ *
+ * @return int Amount of bytes written or, if updating, changed
+ */
+int EEPROMClassEx::writeBytes(int address, const uint8_t* buffer, int length, bool update)
+{
+    int written = 0;
+    int i;
+
+    if (address < 0 || address + length > this->size) {
+        return 0;
+    }
+
+    load();
+
+    for (i = 0; i < length; i++) {
+        if (!update || memory[address + i] != buffer[i]) {
+            memory[address + i] = buffer[i];
+            written++;
+        }
+    }
+
+    writes += written;
+
+    if (written) {
+        store();
+    }
+
+    return update ? written : length;
+}
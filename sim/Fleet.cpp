@@ -0,0 +1,830 @@
+#include <dlfcn.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Simulation.h"
+#include "Fleet.h"
+
+#define FLEET_DEFAULT_NODES 10
+#define FLEET_DEFAULT_DURATION 3600
+#define FLEET_DEFAULT_LATENCY 2.0
+#define FLEET_DEFAULT_JITTER 1.0
+#define FLEET_DEFAULT_LOSS 1.0
+#define FLEET_DEFAULT_SPREAD 10.0
+#define FLEET_DEFAULT_SKEW 1.0
+#define FLEET_DEFAULT_SEED 1
+
+#define FLEET_MAX_NODES 254
+#define FLEET_LIBRARY "libkalmon-node.so"
+
+// Source of the gateway's transmissions; nodes use their ID.
+#define FLEET_GATEWAY GATEWAY_ADDRESS
+
+// How long transmissions are remembered after the slowest node has passed
+// them, so late arrivals can still be checked for collisions.
+#define FLEET_CHANNEL_HISTORY (60000UL * SIM_CYCLES_PER_MS)
+
+#define FLEET_NONE -1
+#define FLEET_NEVER UINT64_MAX
+
+/**
+ * A transmission on the radio channel, which every node and the gateway
+ * share. Transmissions that overlap in time collide, and neither is received.
+ */
+struct Transmission {
+    uint32_t id;
+    uint8_t source;
+    uint64_t start;
+    uint64_t end;
+};
+
+/**
+ * A message on its way from the gateway to a node.
+ */
+struct Delivery {
+    uint64_t arrival;
+    uint64_t sent;
+    uint32_t transmission;
+    FleetMessage message;
+};
+
+/**
+ * A node: a copy of the node library running the firmware on a thread of its
+ * own. Only the node whose turn it is runs. Turns are handed over when a node
+ * needs the others to catch up, always to the one furthest behind, so every
+ * run with the same seed is the same.
+ */
+struct Node {
+    uint8_t index;
+
+    FleetNodeOptions options;
+    FleetNodeResult result;
+    FleetLink link;
+    bool started;
+
+    char library_path[PATH_MAX];
+    char eeprom_path[PATH_MAX];
+    void* library;
+    FleetNodeEntry entry;
+
+    pthread_t thread;
+    pthread_cond_t turn;
+    uint64_t time;
+    bool finished;
+
+    FleetMessage outgoing;
+
+    Delivery* inbox;
+    uint16_t inbox_count;
+    uint16_t inbox_capacity;
+
+    uint32_t received;
+    uint32_t acks_requested;
+    uint32_t acks_received;
+    uint64_t ack_latency;
+};
+
+// Nodes, and the one whose turn it is.
+static Node nodes[FLEET_MAX_NODES];
+static uint8_t node_count = FLEET_DEFAULT_NODES;
+static int16_t running = FLEET_NONE;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t done = PTHREAD_COND_INITIALIZER;
+
+// Link model, in cycles and parts per million.
+static uint64_t latency;
+static uint64_t jitter;
+static uint32_t loss;
+
+// Transmissions on the channel, and the time the gateway's radio is free.
+static Transmission* transmissions = NULL;
+static uint32_t transmission_count = 0;
+static uint32_t transmission_capacity = 0;
+static uint32_t last_transmission = 0;
+static uint64_t gateway_free_at = 0;
+
+// Random number generator state, so runs with the same seed are identical.
+static uint32_t random_state = FLEET_DEFAULT_SEED;
+
+// Totals.
+static uint32_t collided = 0;
+static uint32_t lost = 0;
+static uint32_t acks_sent = 0;
+static uint32_t acks_lost = 0;
+static uint32_t acks_missed = 0;
+static uint64_t airtime = 0;
+
+// Ack latencies, in cycles.
+static uint64_t* latencies = NULL;
+static uint32_t latency_count = 0;
+static uint32_t latency_capacity = 0;
+
+/**
+ * Return the host time in nanoseconds.
+ *
+ * @return uint64_t
+ */
+static uint64_t getHostTime()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t) now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+/**
+ * Return a random number below the given limit.
+ *
+ * @return uint32_t
+ */
+static uint32_t getRandom(uint32_t limit)
+{
+    random_state = random_state * 1664525UL + 1013904223UL;
+
+    return ((uint64_t) random_state * limit) >> 32;
+}
+
+static uint64_t getLatency()
+{
+    return latency + getRandom(2 * jitter + 1) - jitter;
+}
+
+static bool isLost()
+{
+    return getRandom(1000000) < loss;
+}
+
+/**
+ * Return the index of the node furthest behind, or FLEET_NONE once all have
+ * finished.
+ *
+ * @return int16_t
+ */
+static int16_t getNextNode()
+{
+    int16_t next = FLEET_NONE;
+    uint8_t i;
+
+    for (i = 0; i < node_count; i++) {
+        if (!nodes[i].finished && (next == FLEET_NONE || nodes[i].time < nodes[next].time)) {
+            next = i;
+        }
+    }
+
+    return next;
+}
+
+/**
+ * Hand the turn to the node furthest behind, and wait for it to come back.
+ * Must be called with the lock held.
+ *
+ * @return void
+ */
+static void handOver(Node* node)
+{
+    running = getNextNode();
+
+    if (running == FLEET_NONE) {
+        pthread_cond_signal(&done);
+
+        return;
+    }
+
+    if (running != node->index) {
+        pthread_cond_signal(&nodes[running].turn);
+    }
+
+    while (!node->finished && running != node->index) {
+        pthread_cond_wait(&node->turn, &lock);
+    }
+}
+
+/**
+ * Wait until every other node has caught up with the given time, handing the
+ * turn to the node furthest behind in the meantime.
+ *
+ * @return void
+ */
+static void catchUp(Node* node, uint64_t now)
+{
+    pthread_mutex_lock(&lock);
+
+    node->time = now;
+    handOver(node);
+
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * Forget transmissions nothing can collide with anymore.
+ *
+ * @return void
+ */
+static void pruneTransmissions()
+{
+    uint64_t oldest = FLEET_NEVER;
+    uint32_t kept = 0;
+    uint32_t i;
+    uint8_t j;
+
+    for (j = 0; j < node_count; j++) {
+        if (!nodes[j].finished) {
+            oldest = min(oldest, nodes[j].time);
+        }
+    }
+
+    for (i = 0; i < transmission_count; i++) {
+        if (transmissions[i].end + FLEET_CHANNEL_HISTORY >= oldest) {
+            transmissions[kept++] = transmissions[i];
+        }
+    }
+
+    transmission_count = kept;
+}
+
+static Transmission* addTransmission(uint8_t source, uint64_t start)
+{
+    Transmission* transmission;
+
+    if (transmission_count >= transmission_capacity) {
+        pruneTransmissions();
+    }
+
+    if (transmission_count >= transmission_capacity) {
+        transmission_capacity = transmission_capacity ? transmission_capacity * 2 : 256;
+        transmissions = (Transmission*) realloc(transmissions, transmission_capacity * sizeof(Transmission));
+    }
+
+    transmission = &transmissions[transmission_count++];
+    transmission->id = ++last_transmission;
+    transmission->source = source;
+    transmission->start = start;
+    transmission->end = start + SIM_TRANSMIT_CYCLES;
+
+    airtime += SIM_TRANSMIT_CYCLES;
+
+    return transmission;
+}
+
+static Transmission* findTransmission(uint32_t id)
+{
+    uint32_t i;
+
+    for (i = transmission_count; i > 0; i--) {
+        if (transmissions[i - 1].id == id) {
+            return &transmissions[i - 1];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Return whether a transmission overlaps with one from another source. Only
+ * valid once every node has passed its end.
+ *
+ * @return bool
+ */
+static bool hasCollided(const Transmission* transmission)
+{
+    uint32_t i;
+
+    if (transmission == NULL) {
+        return false;
+    }
+
+    for (i = 0; i < transmission_count; i++) {
+        if (transmissions[i].source != transmission->source
+            && transmissions[i].start < transmission->end
+            && transmission->start < transmissions[i].end) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Have the gateway echo a message back to its sender as an ack, once it's
+ * done sending anything before it.
+ *
+ * @return void
+ */
+static void sendAck(Node* node, const Transmission* received)
+{
+    Transmission* transmission;
+    Delivery* delivery;
+    uint64_t sent = received->start;
+    uint64_t start = max(received->end + getLatency(), gateway_free_at);
+    uint64_t arrival;
+    uint16_t i;
+
+    // Adding a transmission may move the one received
+    transmission = addTransmission(FLEET_GATEWAY, start);
+    gateway_free_at = transmission->end;
+    arrival = transmission->end + getLatency();
+    acks_sent++;
+
+    if (node->inbox_count >= node->inbox_capacity) {
+        node->inbox_capacity = node->inbox_capacity ? node->inbox_capacity * 2 : 16;
+        node->inbox = (Delivery*) realloc(node->inbox, node->inbox_capacity * sizeof(Delivery));
+    }
+
+    // Keep the inbox in order of arrival
+    for (i = node->inbox_count; i > 0 && node->inbox[i - 1].arrival > arrival; i--) {
+        node->inbox[i] = node->inbox[i - 1];
+    }
+
+    delivery = &node->inbox[i];
+    delivery->arrival = arrival;
+    delivery->sent = sent;
+    delivery->transmission = transmission->id;
+    delivery->message = node->outgoing;
+    delivery->message.sender = GATEWAY_ADDRESS;
+    delivery->message.destination = node->options.id;
+    delivery->message.request_ack = false;
+    delivery->message.ack = true;
+
+    node->inbox_count++;
+}
+
+static uint32_t startTransmission(void* context, uint64_t now, const FleetMessage* message)
+{
+    Node* node = (Node*) context;
+
+    node->outgoing = *message;
+    node->acks_requested += message->request_ack;
+
+    return addTransmission(node->options.id, now)->id;
+}
+
+static bool endTransmission(void* context, uint32_t id, uint64_t now)
+{
+    Node* node = (Node*) context;
+    Transmission* transmission;
+
+    catchUp(node, now);
+    transmission = findTransmission(id);
+
+    if (hasCollided(transmission)) {
+        collided++;
+
+        return false;
+    }
+
+    if (isLost()) {
+        lost++;
+
+        return false;
+    }
+
+    node->received++;
+
+    if (node->outgoing.request_ack) {
+        sendAck(node, transmission);
+    }
+
+    return true;
+}
+
+static bool receive(void* context, uint64_t now, uint64_t woke, FleetMessage* message)
+{
+    Node* node = (Node*) context;
+    Delivery delivery;
+
+    while (node->inbox_count && node->inbox[0].arrival <= now) {
+        catchUp(node, now);
+
+        delivery = node->inbox[0];
+        memmove(node->inbox, node->inbox + 1, --node->inbox_count * sizeof(Delivery));
+
+        // The radio is off while powered down
+        if (delivery.arrival < woke) {
+            acks_missed++;
+
+            continue;
+        }
+
+        if (hasCollided(findTransmission(delivery.transmission)) || isLost()) {
+            acks_lost++;
+
+            continue;
+        }
+
+        if (latency_count >= latency_capacity) {
+            latency_capacity = latency_capacity ? latency_capacity * 2 : 1024;
+            latencies = (uint64_t*) realloc(latencies, latency_capacity * sizeof(uint64_t));
+        }
+
+        latencies[latency_count++] = now - delivery.sent;
+        node->ack_latency += now - delivery.sent;
+        node->acks_received++;
+
+        *message = delivery.message;
+
+        return true;
+    }
+
+    return false;
+}
+
+static void* runNode(void* argument)
+{
+    Node* node = (Node*) argument;
+
+    pthread_mutex_lock(&lock);
+
+    while (running != node->index) {
+        pthread_cond_wait(&node->turn, &lock);
+    }
+
+    pthread_mutex_unlock(&lock);
+
+    node->started = node->entry(&node->options, &node->link, &node->result);
+
+    pthread_mutex_lock(&lock);
+    node->finished = true;
+    handOver(node);
+    pthread_mutex_unlock(&lock);
+
+    return NULL;
+}
+
+/**
+ * Copy a file, e.g. the node library, as every node needs one of its own.
+ *
+ * @return bool
+ */
+static bool copyFile(const char* from, const char* to)
+{
+    char buffer[65536];
+    FILE* input = fopen(from, "rb");
+    FILE* output;
+    size_t size;
+    bool ok = true;
+
+    if (input == NULL) {
+        fprintf(stderr, "fleet: can't open file; path=%s\n", from);
+
+        return false;
+    }
+
+    output = fopen(to, "wb");
+
+    if (output == NULL) {
+        fprintf(stderr, "fleet: can't create file; path=%s\n", to);
+        fclose(input);
+
+        return false;
+    }
+
+    while (ok && (size = fread(buffer, 1, sizeof(buffer), input)) > 0) {
+        ok = fwrite(buffer, 1, size, output) == size;
+    }
+
+    fclose(input);
+    ok = !fclose(output) && ok;
+
+    return ok;
+}
+
+/**
+ * Load a copy of the node library for a node, so it gets globals of its own.
+ *
+ * @return bool
+ */
+static bool loadNode(Node* node, const char* library, const char* directory, const char* eeprom)
+{
+    pthread_cond_init(&node->turn, NULL);
+
+    snprintf(node->library_path, sizeof(node->library_path), "%s/node-%u.so", directory, node->options.id);
+    snprintf(node->eeprom_path, sizeof(node->eeprom_path), "%s/node-%u.eeprom", directory, node->options.id);
+
+    if (!copyFile(library, node->library_path) || (eeprom != NULL && !copyFile(eeprom, node->eeprom_path))) {
+        return false;
+    }
+
+    node->library = dlopen(node->library_path, RTLD_NOW | RTLD_LOCAL);
+
+    if (node->library == NULL) {
+        fprintf(stderr, "fleet: can't load node library; error=%s\n", dlerror());
+
+        return false;
+    }
+
+    // The copy stays mapped, so it's not needed anymore
+    unlink(node->library_path);
+
+    node->entry = (FleetNodeEntry) dlsym(node->library, FLEET_NODE_ENTRY);
+
+    if (node->entry == NULL) {
+        fprintf(stderr, "fleet: node library lacks entry point; path=%s\n", library);
+
+        return false;
+    }
+
+    node->options.eeprom = node->eeprom_path;
+
+    node->link.context = node;
+    node->link.startTransmission = startTransmission;
+    node->link.endTransmission = endTransmission;
+    node->link.receive = receive;
+
+    return true;
+}
+
+static void unloadNode(Node* node)
+{
+    if (node->library != NULL) {
+        dlclose(node->library);
+    }
+
+    unlink(node->library_path);
+    unlink(node->eeprom_path);
+
+    pthread_cond_destroy(&node->turn);
+    free(node->inbox);
+}
+
+static int compareCycles(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*) a;
+    uint64_t y = *(const uint64_t*) b;
+
+    return x < y ? -1 : x > y;
+}
+
+static double toPercentage(uint64_t part, uint64_t total)
+{
+    return total ? (double) part * 100 / total : 0;
+}
+
+/**
+ * Print the distribution of ack latencies, from sending a message to its ack
+ * being received, in milliseconds.
+ *
+ * @return void
+ */
+static void printLatencies()
+{
+    uint64_t sum = 0;
+    uint32_t i;
+
+    printf("\n%-16s %10s %10s %10s %10s %10s %10s\n", "ack latency", "count", "mean ms", "p50 ms", "p90 ms", "p99 ms", "max ms");
+
+    if (!latency_count) {
+        printf("%-16s %10u\n", "all", 0);
+
+        return;
+    }
+
+    for (i = 0; i < latency_count; i++) {
+        sum += latencies[i];
+    }
+
+    qsort(latencies, latency_count, sizeof(uint64_t), compareCycles);
+
+    printf(
+        "%-16s %10u %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+        "all",
+        latency_count,
+        (double) sum / latency_count / SIM_CYCLES_PER_MS,
+        (double) latencies[latency_count / 2] / SIM_CYCLES_PER_MS,
+        (double) latencies[(latency_count * 90) / 100] / SIM_CYCLES_PER_MS,
+        (double) latencies[(latency_count * 99) / 100] / SIM_CYCLES_PER_MS,
+        (double) latencies[latency_count - 1] / SIM_CYCLES_PER_MS
+    );
+}
+
+/**
+ * Print a row per node: time spent awake, loops run, messages sent, received
+ * by the gateway and acked, and the mean ack latency.
+ *
+ * @return void
+ */
+static void printNodes(uint64_t duration)
+{
+    Node* node;
+    uint8_t i;
+
+    printf(
+        "\n%-6s %10s %10s %10s %10s %10s %10s %10s\n",
+        "node", "awake s", "awake %", "loops", "sent", "received", "acked", "ack ms"
+    );
+
+    for (i = 0; i < node_count; i++) {
+        node = &nodes[i];
+
+        if (!node->started) {
+            printf("%-6u %10s\n", node->options.id, "-");
+
+            continue;
+        }
+
+        printf(
+            "%-6u %10.3f %10.3f %10u %10u %10u %10u %10.3f%s\n",
+            node->options.id,
+            (double) node->result.awake / F_CPU,
+            toPercentage(node->result.awake, duration - node->options.start),
+            node->result.loops,
+            node->result.sent,
+            node->received,
+            node->acks_received,
+            node->acks_received ? (double) node->ack_latency / node->acks_received / SIM_CYCLES_PER_MS : 0,
+            node->result.reset ? " (reset)" : ""
+        );
+    }
+}
+
+static void usage(const char* name)
+{
+    fprintf(
+        stderr,
+        "usage: %s [-n nodes] [-s script] [-e eeprom] [-t seconds] [-l ms] [-j ms] [-p %%] [-o seconds] [-d %%] [-r seed] [-L library]\n"
+        "  -n  amount of nodes, up to %d (default %d)\n"
+        "  -s  script of timed events every node runs\n"
+        "  -e  EEPROM image every node starts from\n"
+        "  -t  simulated time to run for in seconds (default %d)\n"
+        "  -l  latency of the link to the gateway in ms, each way (default %.1f)\n"
+        "  -j  jitter of the latency in ms (default %.1f)\n"
+        "  -p  chance of a transmission being lost in %% (default %.1f)\n"
+        "  -o  spread of the times nodes power on at in seconds (default %.1f)\n"
+        "  -d  spread of the nodes' sleep timer deviation in %% (default %.1f)\n"
+        "  -r  random seed (default %d)\n"
+        "  -L  node library (default %s next to this program)\n",
+        name, FLEET_MAX_NODES, FLEET_DEFAULT_NODES, FLEET_DEFAULT_DURATION,
+        FLEET_DEFAULT_LATENCY, FLEET_DEFAULT_JITTER, FLEET_DEFAULT_LOSS,
+        FLEET_DEFAULT_SPREAD, FLEET_DEFAULT_SKEW, FLEET_DEFAULT_SEED, FLEET_LIBRARY
+    );
+}
+
+/**
+ * Run a fleet of nodes against a gateway over a shared radio channel, then
+ * report on the traffic, the ack latency and the time every node spent awake.
+ *
+ * @return int
+ */
+int main(int argc, char** argv)
+{
+    char library[PATH_MAX];
+    char directory[] = "/tmp/kalmon-fleet.XXXXXX";
+    const char* slash = strrchr(argv[0], '/');
+    const char* script = NULL;
+    const char* eeprom = NULL;
+    uint64_t duration = (uint64_t) FLEET_DEFAULT_DURATION * 1000 * SIM_CYCLES_PER_MS;
+    double latency_ms = FLEET_DEFAULT_LATENCY;
+    double jitter_ms = FLEET_DEFAULT_JITTER;
+    double loss_percentage = FLEET_DEFAULT_LOSS;
+    double spread = FLEET_DEFAULT_SPREAD;
+    double skew = FLEET_DEFAULT_SKEW;
+    uint32_t seed = FLEET_DEFAULT_SEED;
+    uint64_t host;
+    uint32_t sent = 0;
+    uint32_t received = 0;
+    uint32_t acks_requested = 0;
+    bool ok = true;
+    int option;
+    uint8_t i;
+
+    // The node library is looked for next to this program by default
+    snprintf(library, sizeof(library), "%.*s%s", slash ? (int) (slash - argv[0] + 1) : 0, argv[0], FLEET_LIBRARY);
+
+    while ((option = getopt(argc, argv, "n:s:e:t:l:j:p:o:d:r:L:")) != -1) {
+        switch (option) {
+            case 'n':
+                node_count = constrain(atoi(optarg), 1, FLEET_MAX_NODES);
+
+                break;
+            case 's':
+                script = optarg;
+
+                break;
+            case 'e':
+                eeprom = optarg;
+
+                break;
+            case 't':
+                duration = (uint64_t) (atof(optarg) * 1000 * SIM_CYCLES_PER_MS);
+
+                break;
+            case 'l':
+                latency_ms = max(atof(optarg), 0.0);
+
+                break;
+            case 'j':
+                jitter_ms = max(atof(optarg), 0.0);
+
+                break;
+            case 'p':
+                loss_percentage = constrain(atof(optarg), 0.0, 100.0);
+
+                break;
+            case 'o':
+                spread = max(atof(optarg), 0.0);
+
+                break;
+            case 'd':
+                skew = constrain(atof(optarg), 0.0, 50.0);
+
+                break;
+            case 'r':
+                seed = strtoul(optarg, NULL, 10);
+
+                break;
+            case 'L':
+                snprintf(library, sizeof(library), "%s", optarg);
+
+                break;
+            default:
+                usage(argv[0]);
+
+                return 1;
+        }
+    }
+
+    latency = (uint64_t) (latency_ms * SIM_CYCLES_PER_MS);
+    jitter = (uint64_t) (min(jitter_ms, latency_ms) * SIM_CYCLES_PER_MS);
+    loss = (uint32_t) (loss_percentage * 10000);
+    random_state = seed;
+
+    if (mkdtemp(directory) == NULL) {
+        fprintf(stderr, "fleet: can't create directory; path=%s\n", directory);
+
+        return 1;
+    }
+
+    for (i = 0; ok && i < node_count; i++) {
+        nodes[i].index = i;
+        nodes[i].options.id = i + 1;
+        nodes[i].options.script = script;
+        nodes[i].options.start = getRandom((uint32_t) (spread * 1000)) * SIM_CYCLES_PER_MS;
+        nodes[i].options.duration = duration;
+        nodes[i].options.sleep_skew = (int32_t) getRandom((uint32_t) (skew * 20000) + 1) - (int32_t) (skew * 10000);
+        nodes[i].time = nodes[i].options.start;
+
+        ok = loadNode(&nodes[i], library, directory, eeprom);
+    }
+
+    host = getHostTime();
+
+    for (i = 0; ok && i < node_count; i++) {
+        pthread_create(&nodes[i].thread, NULL, runNode, &nodes[i]);
+    }
+
+    if (ok) {
+        pthread_mutex_lock(&lock);
+        running = getNextNode();
+        pthread_cond_signal(&nodes[running].turn);
+
+        while (running != FLEET_NONE) {
+            pthread_cond_wait(&done, &lock);
+        }
+
+        pthread_mutex_unlock(&lock);
+
+        for (i = 0; i < node_count; i++) {
+            pthread_join(nodes[i].thread, NULL);
+        }
+    }
+
+    host = getHostTime() - host;
+
+    for (i = 0; i < node_count; i++) {
+        ok = ok && nodes[i].started;
+        sent += nodes[i].result.sent;
+        received += nodes[i].received;
+        acks_requested += nodes[i].acks_requested;
+    }
+
+    if (ok) {
+        printf("# kalmon-fleet\n");
+        printf("nodes:       %u, %.3fs simulated in %.3fs, seed %u\n",
+            node_count, (double) duration / F_CPU, (double) host / 1000000000, seed);
+        printf("link:        %.1fms +/- %.1fms latency, %.1f%% loss\n",
+            (double) latency / SIM_CYCLES_PER_MS, (double) jitter / SIM_CYCLES_PER_MS, loss_percentage);
+        printf("messages:    %u sent, %u received (%.1f%%), %u collided, %u lost\n",
+            sent, received, toPercentage(received, sent), collided, lost);
+        printf("throughput:  %.3f messages/s received by the gateway\n",
+            duration ? (double) received * F_CPU / duration : 0);
+        printf("channel:     %.3f%% airtime\n", toPercentage(airtime, duration));
+        printf("acks:        %u requested, %u sent, %u received (%.1f%%), %u collided or lost, %u missed asleep\n",
+            acks_requested, acks_sent, latency_count, toPercentage(latency_count, acks_requested), acks_lost, acks_missed);
+
+        printLatencies();
+        printNodes(duration);
+    }
+
+    for (i = 0; i < node_count; i++) {
+        unloadNode(&nodes[i]);
+    }
+
+    rmdir(directory);
+    free(transmissions);
+    free(latencies);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+#ifndef FLEET_H
+#define FLEET_H
+
+/**
+ * Interface between the fleet simulator and the node library it loads once
+ * per node. Every copy of the library holds the firmware and a simulation of
+ * its own, so nodes share nothing but what goes through this interface.
+ */
+
+#include <MySensor.h>
+
+// Function every copy of the node library exports, as a FleetNodeEntry.
+#define FLEET_NODE_ENTRY "runFleetNode"
+
+/**
+ * A message as it goes between a node and the fleet.
+ */
+struct FleetMessage {
+    uint8_t sender;
+    uint8_t destination;
+    uint8_t sensor;
+    uint8_t command;
+    uint8_t type;
+    bool request_ack;
+    bool ack;
+    char data[MAX_PAYLOAD + 1];
+};
+
+/**
+ * Calls a node makes into the fleet. Only one node runs at a time, so the
+ * fleet needs no locking beyond handing out turns. Nodes run freely in
+ * between, as the outcome of a transmission only depends on the others once
+ * they've all caught up with its end.
+ */
+struct FleetLink {
+    void* context;
+
+    // Put a message on air, and once it's been on air for as long as it takes
+    // to send it, return whether the gateway received it.
+    uint32_t (*startTransmission)(void* context, uint64_t now, const FleetMessage* message);
+    bool (*endTransmission)(void* context, uint32_t transmission, uint64_t now);
+
+    // Take a message that has arrived for the node since it last woke up.
+    bool (*receive)(void* context, uint64_t now, uint64_t woke, FleetMessage* message);
+};
+
+/**
+ * How to run a node. Times are in cycles.
+ */
+struct FleetNodeOptions {
+    uint8_t id;
+    const char* script;
+    const char* eeprom;
+    uint64_t start;
+    uint64_t duration;
+    int32_t sleep_skew;
+};
+
+/**
+ * What a node did over a run. Times are in cycles.
+ */
+struct FleetNodeResult {
+    uint64_t awake;
+    uint64_t asleep;
+    uint32_t loops;
+    uint32_t sent;
+    uint32_t failed;
+    bool reset;
+};
+
+typedef bool (*FleetNodeEntry)(const FleetNodeOptions* options, FleetLink* link, FleetNodeResult* result);
+
+#endif
@@ -0,0 +1,182 @@
+#include "Logging.h"
+
+#include "Simulation.h"
+
+// Logger.
+Logging Log;
+
+// Whether all output is suppressed.
+static bool muted = false;
+
+void Logging::Init(int level, long baud)
+{
+    this->level = constrain(level, LOG_LEVEL_NOOUTPUT, LOG_LEVEL_VERBOSE);
+}
+
+void Logging::setMuted(bool value)
+{
+    muted = value;
+}
+
+void Logging::Error(const __FlashStringHelper* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    this->print(LOG_LEVEL_ERRORS, reinterpret_cast<const char*>(format), args);
+    va_end(args);
+}
+
+void Logging::Info(const __FlashStringHelper* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    this->print(LOG_LEVEL_INFOS, reinterpret_cast<const char*>(format), args);
+    va_end(args);
+}
+
+void Logging::Debug(const __FlashStringHelper* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    this->print(LOG_LEVEL_DEBUG, reinterpret_cast<const char*>(format), args);
+    va_end(args);
+}
+
+void Logging::Verbose(const __FlashStringHelper* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    this->print(LOG_LEVEL_VERBOSE, reinterpret_cast<const char*>(format), args);
+    va_end(args);
+}
+
+void Logging::Error(const char* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    this->print(LOG_LEVEL_ERRORS, format, args);
+    va_end(args);
+}
+
+void Logging::Info(const char* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    this->print(LOG_LEVEL_INFOS, format, args);
+    va_end(args);
+}
+
+void Logging::Debug(const char* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    this->print(LOG_LEVEL_DEBUG, format, args);
+    va_end(args);
+}
+
+void Logging::Verbose(const char* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    this->print(LOG_LEVEL_VERBOSE, format, args);
+    va_end(args);
+}
+
+/**
+ * Print a message, prefixed with the simulated time in ms since power on.
+ * Integers are formatted at their AVR sizes: 16 bits for %d, 32 bits for %l.
+ *
+ * @return void
+ */
+void Logging::print(int level, const char* format, va_list args)
+{
+    uint32_t value;
+    int8_t i;
+
+    if (muted || level > this->level) {
+        return;
+    }
+
+    printf("[%10.3f] ", (double) Simulation::getTime() / SIM_CYCLES_PER_MS);
+
+    for (; *format; format++) {
+        if (*format != '%') {
+            if (*format != '\r') {
+                putchar(*format);
+            }
+
+            continue;
+        }
+
+        switch (*++format) {
+            case '\0':
+                format--;
+
+                break;
+            case '%':
+                putchar('%');
+
+                break;
+            case 's':
+                fputs(va_arg(args, const char*), stdout);
+
+                break;
+            case 'c':
+                putchar(va_arg(args, int));
+
+                break;
+            case 'd':
+                printf("%d", (int16_t) va_arg(args, int));
+
+                break;
+            case 'l':
+                printf("%ld", (long) va_arg(args, int32_t));
+
+                break;
+            case 'x':
+                printf("%x", (uint16_t) va_arg(args, int));
+
+                break;
+            case 'X':
+                printf("0x%x", (uint16_t) va_arg(args, int));
+
+                break;
+            case 'b':
+            case 'B':
+                value = (uint16_t) va_arg(args, int);
+
+                if (*format == 'B') {
+                    fputs("0b", stdout);
+                }
+
+                for (i = 15; i > 0 && !(value >> i); i--);
+
+                for (; i >= 0; i--) {
+                    putchar((value >> i) & 1 ? '1' : '0');
+                }
+
+                break;
+            case 't':
+                putchar(va_arg(args, int) ? 'T' : 'F');
+
+                break;
+            case 'T':
+                fputs(va_arg(args, int) ? "true" : "false", stdout);
+
+                break;
+            default:
+                putchar('%');
+                putchar(*format);
+
+                break;
+        }
+    }
+}
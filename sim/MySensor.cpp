@@ -0,0 +1,397 @@
+#include "MySensor.h"
+
+#include "Simulation.h"
+
+// Node ID handed out when the firmware asks for one automatically.
+#define SIM_AUTO_NODE_ID 1
+
+// Time between polls of the radio while waiting with a receiver set.
+#define SIM_RECEIVE_POLL_CYCLES (100UL * SIM_CYCLES_PER_US)
+
+// Functions sending and receiving messages.
+static MySensor::Transmitter transmitter = MySensor::transmit;
+static MySensor::Receiver receiver = NULL;
+
+// Node ID overriding the one the firmware asks for, or AUTO for none.
+static uint8_t assigned_node_id = AUTO;
+
+// Message trace, or NULL for none.
+static FILE* trace = NULL;
+
+// Amount of messages sent, and of those the next hop didn't receive.
+static uint32_t sent = 0;
+static uint32_t failed = 0;
+
+MyMessage::MyMessage()
+{
+    this->sender = 0;
+    this->destination = GATEWAY_ADDRESS;
+    this->sensor = 0;
+    this->command = C_SET;
+    this->type = 0;
+    this->request_ack = false;
+    this->ack = false;
+    this->data[0] = '\0';
+}
+
+MyMessage::MyMessage(uint8_t sensor, uint8_t type)
+{
+    *this = MyMessage();
+    this->sensor = sensor;
+    this->type = type;
+}
+
+MyMessage& MyMessage::setSensor(uint8_t sensor)
+{
+    this->sensor = sensor;
+
+    return *this;
+}
+
+MyMessage& MyMessage::setType(uint8_t type)
+{
+    this->type = type;
+
+    return *this;
+}
+
+MyMessage& MyMessage::setDestination(uint8_t destination)
+{
+    this->destination = destination;
+
+    return *this;
+}
+
+MyMessage& MyMessage::set(const char* value)
+{
+    strncpy(this->data, value, MAX_PAYLOAD);
+    this->data[MAX_PAYLOAD] = '\0';
+
+    return *this;
+}
+
+MyMessage& MyMessage::set(uint8_t value)
+{
+    snprintf(this->data, sizeof(this->data), "%u", value);
+
+    return *this;
+}
+
+MyMessage& MyMessage::set(float value, uint8_t decimals)
+{
+    snprintf(this->data, sizeof(this->data), "%.*f", decimals, value);
+
+    return *this;
+}
+
+MyMessage& MyMessage::set(unsigned long value)
+{
+    snprintf(this->data, sizeof(this->data), "%lu", value);
+
+    return *this;
+}
+
+MyMessage& MyMessage::set(long value)
+{
+    snprintf(this->data, sizeof(this->data), "%ld", value);
+
+    return *this;
+}
+
+MyMessage& MyMessage::set(unsigned int value)
+{
+    snprintf(this->data, sizeof(this->data), "%u", value);
+
+    return *this;
+}
+
+MyMessage& MyMessage::set(int value)
+{
+    snprintf(this->data, sizeof(this->data), "%d", value);
+
+    return *this;
+}
+
+uint8_t MyMessage::getSensor() const
+{
+    return this->sensor;
+}
+
+uint8_t MyMessage::getType() const
+{
+    return this->type;
+}
+
+uint8_t MyMessage::getCommand() const
+{
+    return this->command;
+}
+
+const char* MyMessage::getString() const
+{
+    return this->data;
+}
+
+int MyMessage::getInt() const
+{
+    return atoi(this->data);
+}
+
+long MyMessage::getLong() const
+{
+    return atol(this->data);
+}
+
+bool MyMessage::isAck() const
+{
+    return this->ack;
+}
+
+MySensor::MySensor()
+{
+    this->node_id = AUTO;
+    this->callback = NULL;
+}
+
+void MySensor::begin(MessageCallback callback, uint8_t node_id, bool repeater, uint8_t parent_id)
+{
+    this->callback = callback;
+
+    if (assigned_node_id != AUTO) {
+        this->node_id = assigned_node_id;
+    } else {
+        this->node_id = node_id == AUTO ? SIM_AUTO_NODE_ID : node_id;
+    }
+}
+
+uint8_t MySensor::getNodeId()
+{
+    return this->node_id;
+}
+
+void MySensor::sendSketchInfo(const char* name, const char* version, bool ack)
+{
+    this->sendInternal(I_SKETCH_NAME, name, ack);
+    this->sendInternal(I_SKETCH_VERSION, version, ack);
+}
+
+void MySensor::present(uint8_t child_id, uint8_t type, bool ack)
+{
+    MyMessage message(child_id, type);
+
+    message.command = C_PRESENTATION;
+    message.set("1.5");
+
+    this->send(message, ack);
+}
+
+bool MySensor::send(MyMessage& message, bool ack)
+{
+    bool delivered;
+
+    message.sender = this->node_id;
+    message.request_ack = ack;
+
+    delivered = transmitter(this, message);
+
+    sent++;
+    failed += !delivered;
+
+    return delivered;
+}
+
+void MySensor::sendBatteryLevel(uint8_t level, bool ack)
+{
+    char buffer[4];
+
+    snprintf(buffer, sizeof(buffer), "%u", level);
+    this->sendInternal(I_BATTERY_LEVEL, buffer, ack);
+}
+
+/**
+ * Take a message that has arrived, if any, and hand it to the callback.
+ *
+ * @return bool Whether a message was received
+ */
+bool MySensor::process()
+{
+    MyMessage message;
+
+    if (receiver == NULL || !receiver(this, message)) {
+        return false;
+    }
+
+    if (this->callback != NULL) {
+        this->callback(message);
+    }
+
+    return true;
+}
+
+/**
+ * Wait for a while. With a receiver set, the radio is polled in the meantime
+ * as MySensors does, so messages are received as they arrive.
+ *
+ * @return void
+ */
+void MySensor::wait(unsigned long ms)
+{
+    uint64_t target = Simulation::getTime() + (uint64_t) ms * SIM_CYCLES_PER_MS;
+
+    if (receiver == NULL) {
+        Simulation::advance(target - Simulation::getTime());
+
+        return;
+    }
+
+    while (true) {
+        while (this->process());
+
+        if (Simulation::getTime() >= target) {
+            break;
+        }
+
+        Simulation::advance(min(target - Simulation::getTime(), (uint64_t) SIM_RECEIVE_POLL_CYCLES));
+    }
+}
+
+void MySensor::sleep(unsigned long ms)
+{
+    Simulation::powerDown(ms, 0, 0, 0);
+}
+
+bool MySensor::sleep(uint8_t interrupt, uint8_t mode, unsigned long ms)
+{
+    return this->sleep(interrupt, mode, 0xFF, 0, ms) >= 0;
+}
+
+/**
+ * Power down until the time runs out or an interrupt fires. As MySensors
+ * does, the interrupts are detached afterwards, replacing any handlers the
+ * firmware attached.
+ *
+ * @return int8_t Interrupt that ended the sleep, or -1 if the time ran out
+ */
+int8_t MySensor::sleep(uint8_t interrupt1, uint8_t mode1, uint8_t interrupt2, uint8_t mode2, unsigned long ms)
+{
+    uint8_t interrupts = 0;
+    uint8_t modes[SIM_EXTERNAL_INTERRUPTS] = {};
+    int8_t woken;
+
+    if (interrupt1 < SIM_EXTERNAL_INTERRUPTS) {
+        interrupts |= _BV(interrupt1);
+        modes[interrupt1] = mode1;
+        detachInterrupt(interrupt1);
+    }
+
+    if (interrupt2 < SIM_EXTERNAL_INTERRUPTS) {
+        interrupts |= _BV(interrupt2);
+        modes[interrupt2] = mode2;
+        detachInterrupt(interrupt2);
+    }
+
+    woken = Simulation::powerDown(ms, interrupts, modes[0], modes[1]);
+
+    return woken;
+}
+
+/**
+ * Replace the function that sends messages, e.g. to route them to a simulated
+ * gateway.
+ *
+ * @return void
+ */
+void MySensor::setTransmitter(Transmitter function)
+{
+    transmitter = function;
+}
+
+/**
+ * Set the function taking messages that have arrived for the node, or NULL to
+ * receive nothing.
+ *
+ * @return void
+ */
+void MySensor::setReceiver(Receiver function)
+{
+    receiver = function;
+}
+
+/**
+ * Assign the node ID, overriding the one the firmware asks for as a
+ * controller would, or AUTO to leave it to the firmware.
+ *
+ * @return void
+ */
+void MySensor::setNodeId(uint8_t node_id)
+{
+    assigned_node_id = node_id;
+}
+
+/**
+ * Set the file every message is written to, or NULL for none.
+ *
+ * @return void
+ */
+void MySensor::setTrace(FILE* file)
+{
+    trace = file;
+}
+
+/**
+ * Return the amount of messages sent so far.
+ *
+ * @return uint32_t
+ */
+uint32_t MySensor::getSentCount()
+{
+    return sent;
+}
+
+/**
+ * Return the amount of messages the next hop didn't receive so far.
+ *
+ * @return uint32_t
+ */
+uint32_t MySensor::getFailedCount()
+{
+    return failed;
+}
+
+/**
+ * Default transmitter: account the time spent on air, and write the message
+ * to the trace as "<ms> <serial protocol message>". The gateway always
+ * receives it.
+ *
+ * @return bool
+ */
+bool MySensor::transmit(MySensor* node, MyMessage& message)
+{
+    Simulation::advance(SIM_TRANSMIT_CYCLES);
+
+    if (trace != NULL) {
+        fprintf(
+            trace,
+            "%.3f %d;%d;%d;%d;%d;%s\n",
+            (double) Simulation::getTime() / SIM_CYCLES_PER_MS,
+            message.sender,
+            message.sensor,
+            message.command,
+            message.request_ack,
+            message.type,
+            message.data
+        );
+    }
+
+    return true;
+}
+
+bool MySensor::sendInternal(uint8_t type, const char* value, bool ack)
+{
+    MyMessage message(NODE_SENSOR_ID, type);
+
+    message.command = C_INTERNAL;
+    message.set(value);
+
+    return this->send(message, ack);
+}
@@ -0,0 +1,111 @@
+#include "Simulation.h"
+#include "Fleet.h"
+
+#include <EEPROMex.h>
+#include <Logging.h>
+#include <MySensor.h>
+
+// Sketch entry points, from src/main.cpp.
+void setup();
+void loop();
+void serialEvent();
+
+// Link to the fleet this copy of the library runs in.
+static FleetLink* fleet_link = NULL;
+
+/**
+ * Send a message through the fleet's radio channel, taking as long as the
+ * default transmitter does.
+ *
+ * @return bool Whether the gateway received the message
+ */
+static bool transmit(MySensor* node, MyMessage& message)
+{
+    FleetMessage outgoing;
+    uint32_t transmission;
+
+    outgoing.sender = message.sender;
+    outgoing.destination = message.destination;
+    outgoing.sensor = message.sensor;
+    outgoing.command = message.command;
+    outgoing.type = message.type;
+    outgoing.request_ack = message.request_ack;
+    outgoing.ack = message.ack;
+    memcpy(outgoing.data, message.data, sizeof(outgoing.data));
+
+    transmission = fleet_link->startTransmission(fleet_link->context, Simulation::getTime(), &outgoing);
+    Simulation::advance(SIM_TRANSMIT_CYCLES);
+
+    return fleet_link->endTransmission(fleet_link->context, transmission, Simulation::getTime());
+}
+
+static bool receive(MySensor* node, MyMessage& message)
+{
+    FleetMessage incoming;
+
+    if (!fleet_link->receive(fleet_link->context, Simulation::getTime(), Simulation::getWakeTime(), &incoming)) {
+        return false;
+    }
+
+    message.sender = incoming.sender;
+    message.destination = incoming.destination;
+    message.sensor = incoming.sensor;
+    message.command = incoming.command;
+    message.type = incoming.type;
+    message.request_ack = incoming.request_ack;
+    message.ack = incoming.ack;
+    memcpy(message.data, incoming.data, sizeof(message.data));
+
+    return true;
+}
+
+/**
+ * Run the firmware as a node of a fleet, until the given duration has passed
+ * or it resets.
+ *
+ * @return bool False if the node can't be started
+ */
+extern "C" __attribute__((visibility("default")))
+bool runFleetNode(const FleetNodeOptions* options, FleetLink* fleet, FleetNodeResult* result)
+{
+    fleet_link = fleet;
+
+    Logging::setMuted(true);
+    EEPROMClassEx::setFile(options->eeprom);
+
+    MySensor::setNodeId(options->id);
+    MySensor::setTransmitter(transmit);
+    MySensor::setReceiver(receive);
+
+    Simulation::powerOn(options->start);
+    Simulation::setSleepSkew(options->sleep_skew);
+
+    if (options->script != NULL && !Simulation::loadScript(options->script)) {
+        return false;
+    }
+
+    *result = FleetNodeResult();
+
+    try {
+        setup();
+
+        while (Simulation::getTime() < options->duration) {
+            loop();
+
+            if (Serial.available()) {
+                serialEvent();
+            }
+
+            result->loops++;
+        }
+    } catch (SimulationReset&) {
+        result->reset = true;
+    }
+
+    result->awake = Simulation::getAwakeTime();
+    result->asleep = Simulation::getSleepTime() - options->start;
+    result->sent = MySensor::getSentCount();
+    result->failed = MySensor::getFailedCount();
+
+    return true;
+}
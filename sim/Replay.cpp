@@ -0,0 +1,428 @@
+#include <unistd.h>
+
+#include "Simulation.h"
+
+#include <EEPROMex.h>
+#include <Logging.h>
+#include <MySensor.h>
+
+#include "ConfigurationManager.h"
+#include "ModuleManager.h"
+#include "TraceManager.h"
+
+#define REPLAY_MAX_VALUES 128
+#define REPLAY_VARINT_MAX_SIZE 5
+
+/**
+ * A raw value read by a module's sensor, as recorded in a trace.
+ */
+struct Reading {
+    uint64_t time;
+    bool interrupt;
+    uint8_t module_index;
+    uint8_t sensor_index;
+    uint8_t value_type;
+    int32_t value;
+};
+
+/**
+ * What became of the readings of a single value.
+ */
+struct Value {
+    uint8_t module_index;
+    uint8_t sensor_index;
+    uint8_t value_type;
+    uint32_t readings;
+    uint32_t replayed;
+    uint32_t sent;
+    uint64_t last_replayed;
+};
+
+static Value values[REPLAY_MAX_VALUES];
+static uint8_t value_count = 0;
+
+/**
+ * Read a trace into memory.
+ *
+ * @return uint8_t* Contents, or NULL if the trace can't be read
+ */
+static uint8_t* readTrace(const char* path, size_t* size)
+{
+    FILE* file = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+    uint8_t* data = NULL;
+    size_t capacity = 0;
+    size_t read;
+
+    if (file == NULL) {
+        fprintf(stderr, "replay: can't open trace; path=%s\n", path);
+
+        return NULL;
+    }
+
+    *size = 0;
+
+    do {
+        if (*size == capacity) {
+            capacity = capacity ? capacity * 2 : 65536;
+            data = (uint8_t*) realloc(data, capacity);
+        }
+
+        read = fread(data + *size, 1, capacity - *size, file);
+        *size += read;
+    } while (read);
+
+    if (file != stdin) {
+        fclose(file);
+    }
+
+    return data;
+}
+
+/**
+ * Decode a value written 7 bits at a time by TraceManager::encode().
+ *
+ * @return bool False if the value runs past the end of the data or is too long
+ */
+static bool decode(const uint8_t* data, size_t size, size_t* offset, uint32_t* value)
+{
+    uint8_t i;
+
+    *value = 0;
+
+    for (i = 0; i < REPLAY_VARINT_MAX_SIZE && *offset < size; i++) {
+        *value |= (uint32_t) (data[*offset] & 0x7F) << (7 * i);
+
+        if (!(data[(*offset)++] & 0x80)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Parse the record starting at an offset, and move the offset past it.
+ *
+ * @return bool False if there's no valid record at the offset
+ */
+static bool parseRecord(const uint8_t* data, size_t size, size_t* offset, uint32_t* delta, Reading* reading)
+{
+    size_t start = *offset;
+    uint8_t checksum = 0;
+    uint32_t time;
+    uint32_t value;
+    size_t i;
+
+    if (data[(*offset)++] != TRACE_RECORD_START || !decode(data, size, offset, &time) || *offset + 2 > size) {
+        return false;
+    }
+
+    reading->module_index = (data[*offset] >> TRACE_SENSOR_BITS) & TRACE_MODULE_MASK;
+    reading->sensor_index = data[(*offset)++] & TRACE_SENSOR_MASK;
+    reading->value_type = data[(*offset)++];
+
+    if (reading->module_index >= MODULE_AVAILABLE_SLOTS || !decode(data, size, offset, &value) || *offset >= size) {
+        return false;
+    }
+
+    for (i = start + 1; i < *offset; i++) {
+        checksum ^= data[i];
+    }
+
+    if (data[(*offset)++] != checksum) {
+        return false;
+    }
+
+    *delta = time >> 1;
+    reading->interrupt = time & TRACE_FLAG_INTERRUPT;
+    reading->value = (int32_t) (value >> 1) ^ -(int32_t) (value & 1);
+
+    return true;
+}
+
+static Value* findValue(const Reading* reading)
+{
+    Value* value;
+    uint8_t i;
+
+    for (i = 0; i < value_count; i++) {
+        value = &values[i];
+
+        if (value->module_index == reading->module_index
+            && value->sensor_index == reading->sensor_index
+            && value->value_type == reading->value_type) {
+            return value;
+        }
+    }
+
+    if (value_count == REPLAY_MAX_VALUES) {
+        return NULL;
+    }
+
+    value = &values[value_count++];
+    *value = Value();
+    value->module_index = reading->module_index;
+    value->sensor_index = reading->sensor_index;
+    value->value_type = reading->value_type;
+
+    return value;
+}
+
+/**
+ * Feed a reading to the firmware, unless it's too soon after the previous
+ * reading of the same value. Readings taken because of an interrupt and
+ * motion events always go through, as they would on the node.
+ *
+ * @return void
+ */
+static void replay(const Reading* reading, uint32_t interval)
+{
+    Value* value = findValue(reading);
+    uint32_t sent = MySensor::getSentCount();
+
+    if (value == NULL) {
+        return;
+    }
+
+    value->readings++;
+
+    if (interval
+        && value->replayed
+        && !reading->interrupt
+        && reading->value_type != V_TRIPPED
+        && reading->time - value->last_replayed < interval) {
+        return;
+    }
+
+    ModuleManager::reportValue(reading->module_index, reading->sensor_index, reading->value_type, reading->value);
+
+    value->replayed++;
+    value->last_replayed = reading->time;
+    value->sent += MySensor::getSentCount() - sent;
+}
+
+/**
+ * Override the filter options of a module slot, given as "slot=options".
+ *
+ * @return bool False if the argument can't be parsed
+ */
+static bool setFilter(const char* argument)
+{
+    char* end;
+    long slot;
+    long options;
+
+    slot = strtol(argument, &end, 10);
+
+    if (*end != '=' || slot < 1 || slot > MODULE_AVAILABLE_SLOTS) {
+        return false;
+    }
+
+    options = strtol(end + 1, &end, 0);
+
+    if (*end || options < 0 || options > 0xFFFF) {
+        return false;
+    }
+
+    // Set in memory only, so the EEPROM image is left alone
+    ConfigurationManager::data.integers[CFG_MODULE_1_FILTER + slot - 1 - CONFIG_INTEGERS_OFFSET] = options;
+
+    return true;
+}
+
+static void usage(const char* name)
+{
+    fprintf(
+        stderr,
+        "usage: %s [-e eeprom] [-f slot=options]... [-i seconds] [-a readings] [-m messages] trace\n"
+        "  -e  EEPROM image holding the configuration to replay against; it isn't written to\n"
+        "  -f  filter options for a module slot from 1 to %d, overriding the configuration\n"
+        "  -i  minimum time between readings of a value in seconds, to try a longer update interval\n"
+        "  -a  readings to aggregate before submitting a summary, overriding the configuration\n"
+        "  -m  file to write every message to, or - for stdout\n"
+        "trace is a capture of the serial output of a node with SENSOR_TRACE enabled, or - for stdin\n",
+        name, MODULE_AVAILABLE_SLOTS
+    );
+}
+
+/**
+ * Replay a trace of raw sensor readings through the firmware's filtering and
+ * reporting, and count the messages that come out of it.
+ *
+ * @return int
+ */
+int main(int argc, char** argv)
+{
+    const char* eeprom = NULL;
+    const char* filters[MODULE_AVAILABLE_SLOTS];
+    uint8_t filter_count = 0;
+    uint32_t interval = 0;
+    int32_t aggregation = -1;
+    FILE* messages = NULL;
+    Reading reading = {};
+    uint8_t* data;
+    size_t size;
+    size_t offset = 0;
+    size_t next;
+    uint32_t delta;
+    uint32_t readings = 0;
+    uint32_t replayed = 0;
+    uint32_t corrupt = 0;
+    uint64_t first = 0;
+    double hours;
+    int option;
+    uint8_t i;
+
+    while ((option = getopt(argc, argv, "e:f:i:a:m:")) != -1) {
+        switch (option) {
+            case 'e':
+                eeprom = optarg;
+
+                break;
+            case 'f':
+                if (filter_count == MODULE_AVAILABLE_SLOTS) {
+                    usage(argv[0]);
+
+                    return 1;
+                }
+
+                filters[filter_count++] = optarg;
+
+                break;
+            case 'i':
+                interval = (uint32_t) (atof(optarg) * 1000);
+
+                break;
+            case 'a':
+                aggregation = atoi(optarg);
+
+                if (aggregation < 0 || aggregation > AGGREGATE_MAX_COUNT) {
+                    usage(argv[0]);
+
+                    return 1;
+                }
+
+                break;
+            case 'm':
+                messages = strcmp(optarg, "-") ? fopen(optarg, "w") : stdout;
+
+                if (messages == NULL) {
+                    fprintf(stderr, "replay: can't open messages; path=%s\n", optarg);
+
+                    return 1;
+                }
+
+                break;
+            default:
+                usage(argv[0]);
+
+                return 1;
+        }
+    }
+
+    if (optind != argc - 1) {
+        usage(argv[0]);
+
+        return 1;
+    }
+
+    if ((data = readTrace(argv[optind], &size)) == NULL) {
+        return 1;
+    }
+
+    Logging::setMuted(true);
+    MySensor::setTrace(messages);
+
+    // Load the node's configuration, then detach the image, so child IDs
+    // allocated while replaying stay in memory
+    EEPROMClassEx::setFile(eeprom);
+    ConfigurationManager::initialize();
+    ConfigurationManager::load();
+    EEPROMClassEx::setFile(NULL);
+
+    ConfigurationManager::data.booleans[CFG_SENSOR_TRACE - CONFIG_BOOLEANS_OFFSET] = false;
+
+    if (aggregation >= 0) {
+        ConfigurationManager::data.integers[CFG_AGGREGATION_INTERVALS - CONFIG_INTEGERS_OFFSET] = aggregation;
+    }
+
+    for (i = 0; i < filter_count; i++) {
+        if (!setFilter(filters[i])) {
+            fprintf(stderr, "replay: invalid filter; filter=%s\n", filters[i]);
+
+            return 1;
+        }
+    }
+
+    // Records are found by their start byte; anything in between is log
+    // output, and a record that doesn't check out is skipped a byte at a time
+    while (offset < size) {
+        next = offset;
+
+        if (data[offset] != TRACE_RECORD_START) {
+            offset++;
+
+            continue;
+        }
+
+        if (!parseRecord(data, size, &next, &delta, &reading)) {
+            corrupt++;
+            offset++;
+
+            continue;
+        }
+
+        offset = next;
+        reading.time += delta;
+
+        if (!readings++) {
+            first = reading.time;
+        }
+
+        replay(&reading, interval);
+    }
+
+    free(data);
+
+    for (i = 0; i < value_count; i++) {
+        replayed += values[i].replayed;
+    }
+
+    hours = readings ? (double) (reading.time - first) / 3600000 : 0;
+
+    if (messages != NULL && messages != stdout) {
+        fclose(messages);
+    }
+
+    fflush(stdout);
+
+    printf("\n# kalmon-replay\n");
+    printf("trace:       %u readings of %u values over %.3fs, %u corrupt records\n",
+        readings, value_count, hours * 3600, corrupt);
+    printf("interval:    %.3fs\n", (double) interval / 1000);
+    printf("aggregation: %u readings\n", ConfigurationManager::getInteger(CFG_AGGREGATION_INTERVALS));
+    printf("replayed:    %u readings, %u skipped for the interval\n", replayed, readings - replayed);
+    printf("messages:    %u sent, %.1f per hour\n",
+        MySensor::getSentCount(), hours > 0 ? MySensor::getSentCount() / hours : 0);
+
+    printf(
+        "\n%6s %6s %6s %8s %10s %10s %10s %10s\n",
+        "slot", "sensor", "type", "filter", "readings", "replayed", "sent", "dropped"
+    );
+
+    for (i = 0; i < value_count; i++) {
+        printf(
+            "%6u %6u %6u %8u %10u %10u %10u %10u\n",
+            values[i].module_index + 1,
+            values[i].sensor_index,
+            values[i].value_type,
+            ConfigurationManager::getInteger(CFG_MODULE_1_FILTER + values[i].module_index),
+            values[i].readings,
+            values[i].replayed,
+            values[i].sent,
+            values[i].replayed > values[i].sent ? values[i].replayed - values[i].sent : 0
+        );
+    }
+
+    return 0;
+}
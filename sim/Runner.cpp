@@ -0,0 +1,311 @@
+#include <time.h>
+#include <unistd.h>
+
+#include "Simulation.h"
+
+#include <EEPROMex.h>
+#include <Logging.h>
+#include <MySensor.h>
+
+#include "ConfigurationManager.h"
+#include "ModuleManager.h"
+#include "AdcManager.h"
+#include "I2CManager.h"
+#include "BatteryManager.h"
+
+#define RUNNER_DEFAULT_DURATION 3600
+#define RUNNER_DEFAULT_ITERATIONS 100
+
+// Sketch entry points, from src/main.cpp.
+void setup();
+void loop();
+void serialEvent();
+void handleConnection();
+
+/**
+ * Durations of a repeated operation, in simulated cycles spent awake and in
+ * host nanoseconds.
+ */
+struct Samples {
+    uint64_t* cycles;
+    uint64_t host;
+    uint32_t count;
+    uint32_t capacity;
+};
+
+/**
+ * Return the host time in nanoseconds.
+ *
+ * @return uint64_t
+ */
+static uint64_t getHostTime()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t) now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+static void addSample(Samples* samples, uint64_t cycles, uint64_t host)
+{
+    if (samples->count >= samples->capacity) {
+        samples->capacity = samples->capacity ? samples->capacity * 2 : 1024;
+        samples->cycles = (uint64_t*) realloc(samples->cycles, samples->capacity * sizeof(uint64_t));
+    }
+
+    samples->cycles[samples->count++] = cycles;
+    samples->host += host;
+}
+
+static int compareCycles(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*) a;
+    uint64_t y = *(const uint64_t*) b;
+
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Print a row of statistics: the simulated time per call in microseconds as
+ * mean, median, 99th percentile and maximum, then the host time per call.
+ *
+ * @return void
+ */
+static void printSamples(const char* name, Samples* samples)
+{
+    uint64_t sum = 0;
+    uint32_t i;
+
+    if (!samples->count) {
+        printf("%-16s %10s\n", name, "-");
+
+        return;
+    }
+
+    for (i = 0; i < samples->count; i++) {
+        sum += samples->cycles[i];
+    }
+
+    qsort(samples->cycles, samples->count, sizeof(uint64_t), compareCycles);
+
+    printf(
+        "%-16s %10u %12.1f %12.1f %12.1f %12.1f %12.2f\n",
+        name,
+        samples->count,
+        (double) sum / samples->count / SIM_CYCLES_PER_US,
+        (double) samples->cycles[samples->count / 2] / SIM_CYCLES_PER_US,
+        (double) samples->cycles[(samples->count * 99) / 100] / SIM_CYCLES_PER_US,
+        (double) samples->cycles[samples->count - 1] / SIM_CYCLES_PER_US,
+        (double) samples->host / samples->count / 1000
+    );
+}
+
+static void printHeader(const char* title)
+{
+    printf(
+        "\n%-16s %10s %12s %12s %12s %12s %12s\n",
+        title, "calls", "mean us", "p50 us", "p99 us", "max us", "host us"
+    );
+}
+
+/**
+ * Time a subsystem over a number of calls.
+ *
+ * @return void
+ */
+static void benchmark(const char* name, void (*function)(), uint32_t iterations)
+{
+    Samples samples = {};
+    uint64_t awake;
+    uint64_t host;
+    uint32_t i;
+
+    for (i = 0; i < iterations; i++) {
+        awake = Simulation::getAwakeTime();
+        host = getHostTime();
+
+        function();
+
+        addSample(&samples, Simulation::getAwakeTime() - awake, getHostTime() - host);
+    }
+
+    printSamples(name, &samples);
+    free(samples.cycles);
+}
+
+static void pollI2C()
+{
+    I2CManager::poll();
+}
+
+static void pollModules()
+{
+    ModuleManager::pollModules();
+}
+
+static void updateModules()
+{
+    ModuleManager::updateModules();
+}
+
+static void measureBattery()
+{
+    BatteryManager::measure();
+}
+
+static void sweepAdc()
+{
+    AdcManager::sweep();
+}
+
+static void loadConfiguration()
+{
+    ConfigurationManager::load();
+}
+
+static void usage(const char* name)
+{
+    fprintf(
+        stderr,
+        "usage: %s [-s script] [-e eeprom] [-t seconds] [-m trace] [-n iterations] [-q]\n"
+        "  -s  script of timed events\n"
+        "  -e  file backing the EEPROM, created on the first write\n"
+        "  -t  simulated time to run for in seconds (default %d)\n"
+        "  -m  file to write every message to, or - for stdout\n"
+        "  -n  calls per subsystem benchmark, or 0 to skip them (default %d)\n"
+        "  -q  silence the firmware's log output\n",
+        name, RUNNER_DEFAULT_DURATION, RUNNER_DEFAULT_ITERATIONS
+    );
+}
+
+/**
+ * Run the firmware for a stretch of simulated time, then benchmark its
+ * subsystems one by one.
+ *
+ * @return int
+ */
+int main(int argc, char** argv)
+{
+    Samples loops = {};
+    uint64_t duration = (uint64_t) RUNNER_DEFAULT_DURATION * 1000 * SIM_CYCLES_PER_MS;
+    uint32_t iterations = RUNNER_DEFAULT_ITERATIONS;
+    uint64_t setup_awake;
+    uint64_t setup_host;
+    uint64_t awake;
+    uint64_t host;
+    bool reset = false;
+    FILE* trace = NULL;
+    int option;
+
+    while ((option = getopt(argc, argv, "s:e:t:m:n:q")) != -1) {
+        switch (option) {
+            case 's':
+                if (!Simulation::loadScript(optarg)) {
+                    return 1;
+                }
+
+                break;
+            case 'e':
+                EEPROMClassEx::setFile(optarg);
+
+                break;
+            case 't':
+                duration = (uint64_t) (atof(optarg) * 1000 * SIM_CYCLES_PER_MS);
+
+                break;
+            case 'm':
+                trace = strcmp(optarg, "-") ? fopen(optarg, "w") : stdout;
+
+                if (trace == NULL) {
+                    fprintf(stderr, "sim: can't open trace; path=%s\n", optarg);
+
+                    return 1;
+                }
+
+                break;
+            case 'n':
+                iterations = atoi(optarg);
+
+                break;
+            case 'q':
+                Logging::setMuted(true);
+
+                break;
+            default:
+                usage(argv[0]);
+
+                return 1;
+        }
+    }
+
+    MySensor::setTrace(trace);
+
+    setup_host = getHostTime();
+    setup();
+    setup_awake = Simulation::getAwakeTime();
+    setup_host = getHostTime() - setup_host;
+
+    while (Simulation::getTime() < duration) {
+        awake = Simulation::getAwakeTime();
+        host = getHostTime();
+
+        try {
+            loop();
+
+            // The core checks for serial input between loops
+            if (Serial.available()) {
+                serialEvent();
+            }
+        } catch (SimulationReset&) {
+            reset = true;
+        }
+
+        addSample(&loops, Simulation::getAwakeTime() - awake, getHostTime() - host);
+
+        if (reset) {
+            break;
+        }
+    }
+
+    fflush(stdout);
+
+    printf("\n# kalmon-sim\n");
+    printf("simulated:   %.3fs, awake %.3fs, asleep %.3fs%s\n",
+        (double) Simulation::getTime() / F_CPU,
+        (double) Simulation::getAwakeTime() / F_CPU,
+        (double) Simulation::getSleepTime() / F_CPU,
+        reset ? " (ended by a reset)" : "");
+    printf("setup:       %.1fms awake, %.1fus host\n",
+        (double) setup_awake / SIM_CYCLES_PER_MS, (double) setup_host / 1000);
+    printf("throughput:  %.2f loops/s, %.3f messages/s awake\n",
+        Simulation::getAwakeTime() ? (double) loops.count * F_CPU / Simulation::getAwakeTime() : 0,
+        Simulation::getAwakeTime() ? (double) MySensor::getSentCount() * F_CPU / Simulation::getAwakeTime() : 0);
+    printf("messages:    %u sent, %u failed\n", MySensor::getSentCount(), MySensor::getFailedCount());
+    printf("interrupts:  %u\n", Simulation::getInterruptCount());
+    printf("eeprom:      %u bytes written\n", EEPROMClassEx::getWriteCount());
+
+    // Time awake per loop; time spent asleep is left out
+    printHeader("loop");
+    printSamples("loop()", &loops);
+    free(loops.cycles);
+
+    if (iterations && !reset) {
+        Logging::setMuted(true);
+
+        printHeader("subsystem");
+        benchmark("connection", handleConnection, iterations);
+        benchmark("i2c::poll", pollI2C, iterations);
+        benchmark("mod::poll", pollModules, iterations);
+        benchmark("mod::update", updateModules, iterations);
+        benchmark("bat::measure", measureBattery, iterations);
+        benchmark("adc::sweep", sweepAdc, iterations);
+        benchmark("cfg::load", loadConfiguration, iterations);
+    }
+
+    if (trace != NULL && trace != stdout) {
+        fclose(trace);
+    }
+
+    return 0;
+}
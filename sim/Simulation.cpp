@@ -0,0 +1,1088 @@
+#include "Simulation.h"
+
+#include <util/twi.h>
+#include <util/crc16.h>
+
+#define SIM_EVENT_SUPPLY 0
+#define SIM_EVENT_ANALOG 1
+#define SIM_EVENT_PIN 2
+#define SIM_EVENT_SERIAL 3
+#define SIM_EVENT_FRAME 4
+
+#define SIM_TWI_NONE 0
+#define SIM_TWI_START 1
+#define SIM_TWI_STOP 2
+#define SIM_TWI_BYTE 3
+
+#define SIM_SCRIPT_LINE_SIZE 256
+
+// Time since power on, and the part of it spent asleep with the clock halted,
+// in cycles.
+uint64_t Simulation::now = 0;
+uint64_t Simulation::slept = 0;
+
+// Time of power on, which script times are relative to, and of the end of the
+// last power down.
+uint64_t Simulation::powered_on = 0;
+uint64_t Simulation::woke_at = 0;
+
+// Nesting of clock advances, e.g. by an interrupt reading the clock.
+uint8_t Simulation::depth = 0;
+
+// Deviation of the sleep timer from its nominal period, in parts per million.
+int32_t Simulation::sleep_skew = 0;
+
+// Scripted events, ordered by time.
+Simulation::Event* Simulation::events = NULL;
+uint16_t Simulation::event_count = 0;
+uint16_t Simulation::event_capacity = 0;
+uint16_t Simulation::next_event = 0;
+
+// Global interrupt flag, and interrupts waiting for it.
+bool Simulation::interrupts_enabled = true;
+uint8_t Simulation::pending = 0;
+uint32_t Simulation::interrupt_count = 0;
+
+// External interrupt handlers and their trigger modes.
+void (*Simulation::handlers[SIM_EXTERNAL_INTERRUPTS])(void) = {};
+int Simulation::handler_modes[SIM_EXTERNAL_INTERRUPTS] = {};
+
+// Power down state, and the external interrupts that end it.
+bool Simulation::powered_down = false;
+uint8_t Simulation::wake_interrupts = 0;
+int Simulation::wake_modes[SIM_EXTERNAL_INTERRUPTS] = {};
+int8_t Simulation::woken_by = -1;
+
+// Digital pins.
+Simulation::Pin Simulation::pins[SIM_PINS] = {};
+
+// Analog inputs, as 10-bit readings with an amount of noise.
+uint16_t Simulation::analog[SIM_ADC_CHANNELS] = {};
+uint16_t Simulation::noise[SIM_ADC_CHANNELS] = {};
+uint16_t Simulation::supply_voltage = SIM_DEFAULT_SUPPLY_VOLTAGE;
+uint32_t Simulation::noise_state = 1;
+
+// ADC state.
+uint8_t Simulation::adc_control = 0;
+bool Simulation::adc_converting = false;
+uint8_t Simulation::adc_mux = 0;
+uint64_t Simulation::adc_done_at = 0;
+
+// TWI state. No devices are attached, so every address goes unacknowledged.
+uint8_t Simulation::twi_control = 0;
+uint8_t Simulation::twi_operation = SIM_TWI_NONE;
+bool Simulation::twi_flag = false;
+bool Simulation::twi_owned = false;
+uint64_t Simulation::twi_done_at = 0;
+
+// Serial input, as a ring buffer.
+char Simulation::serial[SIM_SERIAL_BUFFER_SIZE] = {};
+uint16_t Simulation::serial_head = 0;
+uint16_t Simulation::serial_count = 0;
+
+/**
+ * Power on at the given time rather than at 0, counting the time before as
+ * asleep. Must be called before loading a script.
+ *
+ * @param uint64_t time Time in cycles.
+ *
+ * @return void
+ */
+void Simulation::powerOn(uint64_t time)
+{
+    now = time;
+    slept = time;
+    powered_on = time;
+    woke_at = time;
+}
+
+/**
+ * Set the deviation of the timer ending a power down from its nominal period.
+ * The watchdog oscillator is off by a few % from one chip to the next.
+ *
+ * @param int32_t ppm Deviation in parts per million.
+ *
+ * @return void
+ */
+void Simulation::setSleepSkew(int32_t ppm)
+{
+    sleep_skew = ppm;
+}
+
+/**
+ * Load a script of timed events. Every line holds the time in milliseconds
+ * since power on, an action and its arguments:
+ *
+ *   <ms> vcc <mV>                  Set the supply voltage.
+ *   <ms> adc <channel> <value> [n] Set an analog input, with +/- n of noise.
+ *   <ms> pin <pin> <0|1|->         Drive a pin externally, or release it.
+ *   <ms> serial <text>             Send a line over the serial port.
+ *   <ms> frame <hex bytes>         Send a binary frame with the given payload,
+ *                                  adding the CRC and COBS encoding.
+ *
+ * Empty lines and lines starting with # are ignored.
+ *
+ * @param const char* path Script file.
+ *
+ * @return bool False if the script can't be read or holds an invalid line
+ */
+bool Simulation::loadScript(const char* path)
+{
+    char line[SIM_SCRIPT_LINE_SIZE];
+    uint16_t number = 0;
+    FILE* file;
+    bool ok = true;
+
+    file = fopen(path, "r");
+
+    if (file == NULL) {
+        fprintf(stderr, "sim: can't open script; path=%s\n", path);
+
+        return false;
+    }
+
+    while (ok && fgets(line, sizeof(line), file) != NULL) {
+        number++;
+        line[strcspn(line, "\r\n")] = '\0';
+
+        if (!addEvent(line)) {
+            fprintf(stderr, "sim: invalid script line; path=%s, line=%d\n", path, number);
+            ok = false;
+        }
+    }
+
+    fclose(file);
+
+    return ok;
+}
+
+/**
+ * Add a single event, in script syntax.
+ *
+ * @param const char* line Script line.
+ *
+ * @return bool False if the line is invalid
+ */
+bool Simulation::addEvent(const char* line)
+{
+    Event event = {};
+    char action[8];
+    int offset = 0;
+    double time;
+    int target;
+    int value;
+    int extra = 0;
+    unsigned int byte;
+    uint16_t i;
+
+    while (*line == ' ' || *line == '\t') {
+        line++;
+    }
+
+    if (*line == '\0' || *line == '#') {
+        return true;
+    }
+
+    if (sscanf(line, "%lf %7s %n", &time, action, &offset) < 2 || time < 0) {
+        return false;
+    }
+
+    event.time = powered_on + (uint64_t) (time * SIM_CYCLES_PER_MS);
+    line += offset;
+
+    if (!strcmp(action, "vcc")) {
+        if (sscanf(line, "%d", &value) != 1 || value <= 0) {
+            return false;
+        }
+
+        event.action = SIM_EVENT_SUPPLY;
+        event.value = value;
+    } else if (!strcmp(action, "adc")) {
+        if (sscanf(line, "%d %d %d", &target, &value, &extra) < 2
+            || target < 0 || target >= SIM_ADC_CHANNELS || value < 0 || value > SIM_ADC_MAX || extra < 0) {
+            return false;
+        }
+
+        event.action = SIM_EVENT_ANALOG;
+        event.target = target;
+        event.value = value;
+        event.extra = extra;
+    } else if (!strcmp(action, "pin")) {
+        if (sscanf(line, "%d %n", &target, &offset) < 1 || target < 0 || target >= SIM_PINS) {
+            return false;
+        }
+
+        event.action = SIM_EVENT_PIN;
+        event.target = target;
+        line += offset;
+
+        if (*line == '-') {
+            event.value = SIM_PIN_RELEASED;
+        } else if (*line == '0' || *line == '1') {
+            event.value = *line - '0';
+        } else {
+            return false;
+        }
+    } else if (!strcmp(action, "serial")) {
+        event.action = SIM_EVENT_SERIAL;
+        event.data = strdup(line);
+    } else if (!strcmp(action, "frame")) {
+        event.action = SIM_EVENT_FRAME;
+        event.data = (char*) malloc(SIM_FRAME_MAX_SIZE);
+
+        while (sscanf(line, "%2x %n", &byte, &offset) == 1) {
+            if (event.extra == SIM_FRAME_MAX_SIZE) {
+                free(event.data);
+
+                return false;
+            }
+
+            event.data[event.extra++] = byte;
+            line += offset;
+        }
+
+        if (*line != '\0' || !event.extra) {
+            free(event.data);
+
+            return false;
+        }
+    } else {
+        return false;
+    }
+
+    if (event_count >= event_capacity) {
+        event_capacity = event_capacity ? event_capacity * 2 : 16;
+        events = (Event*) realloc(events, event_capacity * sizeof(Event));
+    }
+
+    // Keep events in order, leaving events at the same time in script order
+    for (i = event_count; i > next_event && events[i - 1].time > event.time; i--) {
+        events[i] = events[i - 1];
+    }
+
+    events[i] = event;
+    event_count++;
+
+    return true;
+}
+
+/**
+ * Return the time since power on in cycles.
+ *
+ * @return uint64_t
+ */
+uint64_t Simulation::getTime()
+{
+    return now;
+}
+
+/**
+ * Return the time spent awake in cycles. This is what millis() and micros()
+ * count.
+ *
+ * @return uint64_t
+ */
+uint64_t Simulation::getAwakeTime()
+{
+    return now - slept;
+}
+
+/**
+ * Return the time spent asleep with the clock halted in cycles.
+ *
+ * @return uint64_t
+ */
+uint64_t Simulation::getSleepTime()
+{
+    return slept;
+}
+
+/**
+ * Return the time the last power down ended, or of power on, in cycles.
+ *
+ * @return uint64_t
+ */
+uint64_t Simulation::getWakeTime()
+{
+    return woke_at;
+}
+
+/**
+ * Return the amount of interrupts serviced so far.
+ *
+ * @return uint32_t
+ */
+uint32_t Simulation::getInterruptCount()
+{
+    return interrupt_count;
+}
+
+/**
+ * Let time pass while awake, running the hardware and the script, and
+ * servicing interrupts as they occur.
+ *
+ * @param uint64_t cycles Amount of cycles.
+ *
+ * @return void
+ */
+void Simulation::advance(uint64_t cycles)
+{
+    uint64_t target = now + cycles;
+    uint64_t next;
+
+    // Time taken by an interrupt, or by the hardware itself, simply passes
+    if (depth) {
+        now = target;
+
+        return;
+    }
+
+    depth++;
+
+    while ((next = nextEventTime()) <= target) {
+        now = max(now, next);
+        runEvents();
+
+        depth--;
+        deliverInterrupts();
+        depth++;
+    }
+
+    now = max(now, target);
+
+    depth--;
+    deliverInterrupts();
+}
+
+/**
+ * Sleep in idle or ADC noise reduction mode until an interrupt is serviced.
+ * Entering ADC noise reduction mode starts a conversion, and halts the timer
+ * millis() is based on.
+ *
+ * @param bool noise_reduction Whether to sleep in ADC noise reduction mode.
+ *
+ * @return void
+ */
+void Simulation::idle(bool noise_reduction)
+{
+    uint32_t count = interrupt_count;
+    uint64_t started = now;
+    uint64_t target;
+
+    if (noise_reduction && (adc_control & _BV(ADEN)) && !adc_converting) {
+        startConversion();
+    }
+
+    while (count == interrupt_count && (now - started) < SIM_MAX_IDLE_SLEEP) {
+        target = min(nextEventTime(), started + SIM_MAX_IDLE_SLEEP);
+        advance(target > now ? target - now : 0);
+    }
+
+    if (noise_reduction) {
+        slept += now - started;
+    }
+}
+
+/**
+ * Power down for a while, or until one of the given external interrupts
+ * fires. The ADC and TWI are expected to be idle, and millis() stops counting.
+ *
+ * @param uint32_t duration   Duration in milliseconds, or 0 to sleep until
+ *                            woken by an interrupt.
+ * @param uint8_t  interrupts Bit mask of external interrupts to wake up on.
+ * @param uint8_t  mode0      Trigger mode of INT0.
+ * @param uint8_t  mode1      Trigger mode of INT1.
+ *
+ * @return int8_t Interrupt that ended the sleep, or -1 if the time ran out
+ */
+int8_t Simulation::powerDown(uint32_t duration, uint8_t interrupts, uint8_t mode0, uint8_t mode1)
+{
+    uint64_t started = now;
+    uint64_t target;
+
+    target = (uint64_t) (duration ? duration : SIM_MAX_POWER_DOWN) * SIM_CYCLES_PER_MS;
+    target = now + target + (int64_t) target * sleep_skew / 1000000;
+
+    powered_down = true;
+    wake_interrupts = interrupts;
+    wake_modes[0] = mode0;
+    wake_modes[1] = mode1;
+    woken_by = -1;
+
+    depth++;
+
+    while (woken_by < 0 && next_event < event_count && events[next_event].time <= target) {
+        now = max(now, events[next_event].time);
+        runEvents();
+    }
+
+    depth--;
+
+    if (woken_by < 0) {
+        now = max(now, target);
+    }
+
+    slept += now - started;
+    woke_at = now;
+    powered_down = false;
+    wake_interrupts = 0;
+
+    return woken_by;
+}
+
+/**
+ * Enable interrupts, servicing those that are pending.
+ *
+ * @return void
+ */
+void Simulation::enableInterrupts()
+{
+    interrupts_enabled = true;
+    deliverInterrupts();
+}
+
+/**
+ * Disable interrupts.
+ *
+ * @return void
+ */
+void Simulation::disableInterrupts()
+{
+    interrupts_enabled = false;
+}
+
+/**
+ * Return whether interrupts are enabled.
+ *
+ * @return bool
+ */
+bool Simulation::areInterruptsEnabled()
+{
+    return interrupts_enabled;
+}
+
+/**
+ * Attach a handler to an external interrupt.
+ *
+ * @return void
+ */
+void Simulation::attachInterrupt(uint8_t interrupt, void (*callback)(void), int mode)
+{
+    if (interrupt < SIM_EXTERNAL_INTERRUPTS) {
+        handlers[interrupt] = callback;
+        handler_modes[interrupt] = mode;
+    }
+}
+
+/**
+ * Detach the handler from an external interrupt.
+ *
+ * @return void
+ */
+void Simulation::detachInterrupt(uint8_t interrupt)
+{
+    if (interrupt < SIM_EXTERNAL_INTERRUPTS) {
+        handlers[interrupt] = NULL;
+        pending &= ~(SIM_INT_INT0 << interrupt);
+    }
+}
+
+/**
+ * Set a pin's mode. As on the AVR, the pull-up of an input is controlled by
+ * its output value.
+ *
+ * @return void
+ */
+void Simulation::setPinMode(uint8_t pin, uint8_t mode)
+{
+    if (pin >= SIM_PINS) {
+        return;
+    }
+
+    pins[pin].mode = mode == OUTPUT ? OUTPUT : INPUT;
+
+    if (mode != OUTPUT) {
+        pins[pin].output = mode == INPUT_PULLUP;
+    }
+
+    updatePin(pin);
+}
+
+/**
+ * Set a pin's output value.
+ *
+ * @return void
+ */
+void Simulation::writePin(uint8_t pin, uint8_t value)
+{
+    if (pin >= SIM_PINS) {
+        return;
+    }
+
+    pins[pin].output = value != LOW;
+    updatePin(pin);
+}
+
+/**
+ * Return a pin's level.
+ *
+ * @return uint8_t
+ */
+uint8_t Simulation::readPin(uint8_t pin)
+{
+    return pin < SIM_PINS ? pins[pin].level : LOW;
+}
+
+/**
+ * Drive a pin from outside, overriding pull-ups but not outputs.
+ *
+ * @param uint8_t pin   Pin.
+ * @param int8_t  level Level, or SIM_PIN_RELEASED to stop driving the pin.
+ *
+ * @return void
+ */
+void Simulation::drivePin(uint8_t pin, int8_t level)
+{
+    if (pin >= SIM_PINS) {
+        return;
+    }
+
+    pins[pin].external = level;
+    updatePin(pin);
+}
+
+/**
+ * Set an analog input.
+ *
+ * @param uint8_t  channel Channel.
+ * @param uint16_t value   10-bit reading.
+ * @param uint16_t amount  Noise added to every reading, up to +/- amount.
+ *
+ * @return void
+ */
+void Simulation::setAnalog(uint8_t channel, uint16_t value, uint16_t amount)
+{
+    if (channel < SIM_ADC_CHANNELS) {
+        analog[channel] = min(value, SIM_ADC_MAX);
+        noise[channel] = amount;
+    }
+}
+
+/**
+ * Set the supply voltage in mV, which is what the bandgap is measured against.
+ *
+ * @return void
+ */
+void Simulation::setSupplyVoltage(uint16_t voltage)
+{
+    supply_voltage = voltage;
+}
+
+/**
+ * Return a reading of a multiplexer channel.
+ *
+ * @return uint16_t
+ */
+uint16_t Simulation::sample(uint8_t mux)
+{
+    int32_t value;
+
+    if (mux == 0x0E) {
+        value = ((uint32_t) SIM_BANDGAP_VOLTAGE * 1024 + (supply_voltage / 2)) / supply_voltage;
+    } else if (mux < SIM_ADC_CHANNELS) {
+        value = analog[mux];
+
+        if (noise[mux]) {
+            // A fixed generator keeps every run the same
+            noise_state = (noise_state * 1103515245UL) + 12345;
+            value += (int32_t) ((noise_state >> 16) % ((2 * noise[mux]) + 1)) - noise[mux];
+        }
+    } else {
+        value = 0;
+    }
+
+    return constrain(value, 0, SIM_ADC_MAX);
+}
+
+/**
+ * Read ADCSRA. ADSC reads as one for as long as conversions are running.
+ *
+ * @return uint8_t
+ */
+uint8_t Simulation::readAdcControl()
+{
+    advance(SIM_REGISTER_READ_CYCLES);
+
+    return adc_control | (adc_converting ? _BV(ADSC) : 0);
+}
+
+/**
+ * Write ADCSRA. Writing a one to ADIF clears it, and writing a one to ADSC
+ * starts a conversion.
+ *
+ * @return void
+ */
+void Simulation::writeAdcControl(uint8_t value)
+{
+    uint8_t flag = (value & _BV(ADIF)) ? 0 : (adc_control & _BV(ADIF));
+
+    adc_control = (value & ~(_BV(ADSC) | _BV(ADIF))) | flag;
+
+    if (!(adc_control & _BV(ADEN))) {
+        adc_converting = false;
+    } else if ((value & _BV(ADSC)) && !adc_converting) {
+        startConversion();
+    }
+}
+
+/**
+ * Read TWCR. TWSTO reads as one until the stop condition has been sent.
+ *
+ * @return uint8_t
+ */
+uint8_t Simulation::readTwiControl()
+{
+    advance(SIM_REGISTER_READ_CYCLES);
+
+    return twi_control | (twi_flag ? _BV(TWINT) : 0) | (twi_operation == SIM_TWI_STOP ? _BV(TWSTO) : 0);
+}
+
+/**
+ * Write TWCR. Writing a one to TWINT clears it and starts whatever the other
+ * bits ask for: a stop condition, a start condition or a byte transfer.
+ *
+ * @return void
+ */
+void Simulation::writeTwiControl(uint8_t value)
+{
+    twi_control = value & ~(_BV(TWINT) | _BV(TWSTO));
+
+    if (!(value & _BV(TWEN))) {
+        twi_flag = false;
+        twi_owned = false;
+        twi_operation = SIM_TWI_NONE;
+
+        return;
+    }
+
+    if (!(value & _BV(TWINT))) {
+        return;
+    }
+
+    twi_flag = false;
+
+    if (value & _BV(TWSTO)) {
+        scheduleTwi(SIM_TWI_STOP, getTwiBitCycles());
+    } else if (value & _BV(TWSTA)) {
+        scheduleTwi(SIM_TWI_START, getTwiBitCycles());
+    } else if (twi_owned) {
+        // Eight bits and the acknowledge
+        scheduleTwi(SIM_TWI_BYTE, getTwiBitCycles() * 9);
+    }
+}
+
+/**
+ * Queue serial input.
+ *
+ * @return void
+ */
+void Simulation::feedSerial(const char* data)
+{
+    while (*data && serial_count < SIM_SERIAL_BUFFER_SIZE) {
+        serial[(serial_head + serial_count) % SIM_SERIAL_BUFFER_SIZE] = *data++;
+        serial_count++;
+    }
+}
+
+/**
+ * Queue serial input holding a binary frame: the payload and its CRC, COBS
+ * encoded and put between zero bytes, as src/FrameManager.h describes.
+ *
+ * @return void
+ */
+void Simulation::feedFrame(const uint8_t* payload, uint16_t size)
+{
+    uint8_t frame[SIM_FRAME_MAX_SIZE + 5];
+    uint16_t crc = 0xFFFF;
+    uint16_t code_index = 1;
+    uint16_t written = 2;
+    uint16_t i;
+    uint8_t ch;
+
+    for (i = 0; i < size; i++) {
+        crc = _crc_ccitt_update(crc, payload[i]);
+    }
+
+    frame[0] = 0;
+
+    for (i = 0; i < size + 2; i++) {
+        ch = i < size ? payload[i] : (i == size ? crc & 0xFF : crc >> 8);
+
+        if (!ch) {
+            frame[code_index] = written - code_index;
+            code_index = written++;
+        } else {
+            frame[written++] = ch;
+        }
+    }
+
+    frame[code_index] = written - code_index;
+    frame[written++] = 0;
+
+    for (i = 0; i < written && serial_count < SIM_SERIAL_BUFFER_SIZE; i++) {
+        serial[(serial_head + serial_count) % SIM_SERIAL_BUFFER_SIZE] = frame[i];
+        serial_count++;
+    }
+}
+
+/**
+ * Return the amount of serial input available.
+ *
+ * @return int
+ */
+int Simulation::availableSerial()
+{
+    return serial_count;
+}
+
+/**
+ * Return the next byte of serial input without consuming it.
+ *
+ * @return int Byte, or -1 if none is available
+ */
+int Simulation::peekSerial()
+{
+    return serial_count ? (uint8_t) serial[serial_head] : -1;
+}
+
+/**
+ * Consume the next byte of serial input.
+ *
+ * @return int Byte, or -1 if none is available
+ */
+int Simulation::readSerial()
+{
+    int ch = peekSerial();
+
+    if (serial_count) {
+        serial_head = (serial_head + 1) % SIM_SERIAL_BUFFER_SIZE;
+        serial_count--;
+    }
+
+    return ch;
+}
+
+/**
+ * Return the time of the next thing to happen, be it the hardware completing
+ * an operation or a scripted event.
+ *
+ * @return uint64_t
+ */
+uint64_t Simulation::nextEventTime()
+{
+    uint64_t next = UINT64_MAX;
+
+    if (adc_converting) {
+        next = min(next, adc_done_at);
+    }
+
+    if (twi_operation != SIM_TWI_NONE) {
+        next = min(next, twi_done_at);
+    }
+
+    if (next_event < event_count) {
+        next = min(next, events[next_event].time);
+    }
+
+    return next;
+}
+
+/**
+ * Run everything that is due.
+ *
+ * @return void
+ */
+void Simulation::runEvents()
+{
+    if (adc_converting && adc_done_at <= now) {
+        completeConversion();
+    }
+
+    if (twi_operation != SIM_TWI_NONE && twi_done_at <= now) {
+        completeTwi();
+    }
+
+    while (next_event < event_count && events[next_event].time <= now) {
+        runEvent(&events[next_event++]);
+    }
+}
+
+/**
+ * Run a scripted event.
+ *
+ * @return void
+ */
+void Simulation::runEvent(Event* event)
+{
+    switch (event->action) {
+        case SIM_EVENT_SUPPLY:
+            setSupplyVoltage(event->value);
+
+            break;
+        case SIM_EVENT_ANALOG:
+            setAnalog(event->target, event->value, event->extra);
+
+            break;
+        case SIM_EVENT_PIN:
+            drivePin(event->target, event->value);
+
+            break;
+        case SIM_EVENT_SERIAL:
+            feedSerial(event->data);
+            feedSerial("\n");
+
+            break;
+        case SIM_EVENT_FRAME:
+            feedFrame((const uint8_t*) event->data, event->extra);
+
+            break;
+    }
+}
+
+/**
+ * Service pending interrupts, if enabled. Interrupts are disabled while a
+ * handler runs, as on the AVR.
+ *
+ * @return void
+ */
+void Simulation::deliverInterrupts()
+{
+    uint8_t interrupt;
+
+    if (depth || !interrupts_enabled) {
+        return;
+    }
+
+    depth++;
+
+    while (pending && interrupts_enabled) {
+        // The lowest bit has the highest priority
+        interrupt = pending & -pending;
+        pending &= ~interrupt;
+        interrupts_enabled = false;
+        interrupt_count++;
+
+        switch (interrupt) {
+            case SIM_INT_INT0:
+            case SIM_INT_INT1:
+                if (handlers[interrupt >> 1] != NULL) {
+                    handlers[interrupt >> 1]();
+                }
+
+                break;
+            case SIM_INT_PCINT0:
+                PCINT0_vect();
+
+                break;
+            case SIM_INT_PCINT1:
+                PCINT1_vect();
+
+                break;
+            case SIM_INT_PCINT2:
+                PCINT2_vect();
+
+                break;
+            case SIM_INT_ADC:
+                // Executing the handler clears the flag
+                adc_control &= ~_BV(ADIF);
+                ADC_vect();
+
+                break;
+            case SIM_INT_TWI:
+                TWI_vect();
+
+                break;
+        }
+
+        interrupts_enabled = true;
+    }
+
+    depth--;
+}
+
+/**
+ * Recalculate a pin's level, raising the interrupts a change triggers.
+ *
+ * @return void
+ */
+void Simulation::updatePin(uint8_t pin)
+{
+    Pin* state = &pins[pin];
+    volatile uint8_t* input;
+    uint8_t level;
+    uint8_t bit;
+    uint8_t port;
+    uint8_t interrupt;
+
+    if (state->mode == OUTPUT) {
+        level = state->output;
+    } else if (state->external != SIM_PIN_RELEASED) {
+        level = state->external;
+    } else {
+        level = state->output;
+    }
+
+    if (level == state->level) {
+        return;
+    }
+
+    state->level = level;
+
+    port = digitalPinToPCICRbit(pin);
+    bit = digitalPinToPCMSKbit(pin);
+    input = portInputRegister(digitalPinToPort(pin));
+
+    if (pin >= NUM_DIGITAL_PINS) {
+        return;
+    }
+
+    *input = level ? (*input | _BV(bit)) : (*input & ~_BV(bit));
+
+    if ((PCICR & _BV(port)) && (*digitalPinToPCMSK(pin) & _BV(bit))) {
+        pending |= SIM_INT_PCINT0 << port;
+    }
+
+    interrupt = digitalPinToInterrupt(pin);
+
+    if (interrupt == (uint8_t) NOT_AN_INTERRUPT) {
+        return;
+    }
+
+    if (powered_down) {
+        if ((wake_interrupts & _BV(interrupt)) && woken_by < 0 && matchesMode(wake_modes[interrupt], level)) {
+            woken_by = interrupt;
+        }
+    } else if (handlers[interrupt] != NULL && matchesMode(handler_modes[interrupt], level)) {
+        pending |= SIM_INT_INT0 << interrupt;
+    }
+}
+
+/**
+ * Return whether a change to a level triggers an interrupt in a mode. A low
+ * level interrupt is treated as firing once per falling edge.
+ *
+ * @return bool
+ */
+bool Simulation::matchesMode(int mode, uint8_t level)
+{
+    switch (mode) {
+        case CHANGE:
+            return true;
+        case RISING:
+            return level;
+        default:
+            return !level;
+    }
+}
+
+/**
+ * Start a conversion, latching the multiplexer.
+ *
+ * @return void
+ */
+void Simulation::startConversion()
+{
+    adc_converting = true;
+    adc_mux = ADMUX & 0x0F;
+    adc_done_at = now + SIM_ADC_CONVERSION_CYCLES;
+}
+
+/**
+ * Complete a conversion.
+ *
+ * @return void
+ */
+void Simulation::completeConversion()
+{
+    ADC = sample(adc_mux);
+    adc_control |= _BV(ADIF);
+    adc_converting = false;
+
+    // In free running mode, the next conversion starts right away
+    if ((adc_control & _BV(ADATE)) && !(ADCSRB & 0x07)) {
+        adc_converting = true;
+        adc_mux = ADMUX & 0x0F;
+        adc_done_at += SIM_ADC_CONVERSION_CYCLES;
+    }
+
+    if (adc_control & _BV(ADIE)) {
+        pending |= SIM_INT_ADC;
+    }
+}
+
+/**
+ * Return the duration of an SCL period in cycles.
+ *
+ * @return uint32_t
+ */
+uint32_t Simulation::getTwiBitCycles()
+{
+    return 16 + (2 * (uint32_t) TWBR * (1 << (2 * (TWSR & 0x03))));
+}
+
+/**
+ * Start a bus operation.
+ *
+ * @return void
+ */
+void Simulation::scheduleTwi(uint8_t operation, uint32_t cycles)
+{
+    twi_operation = operation;
+    twi_done_at = now + cycles;
+}
+
+/**
+ * Complete a bus operation, raising the flag for everything but a stop.
+ *
+ * @return void
+ */
+void Simulation::completeTwi()
+{
+    uint8_t operation = twi_operation;
+    uint8_t status = TW_NO_INFO;
+
+    twi_operation = SIM_TWI_NONE;
+
+    switch (operation) {
+        case SIM_TWI_STOP:
+            twi_owned = false;
+
+            // A start requested along with the stop follows it
+            if (twi_control & _BV(TWSTA)) {
+                scheduleTwi(SIM_TWI_START, getTwiBitCycles());
+            }
+
+            return;
+        case SIM_TWI_START:
+            status = twi_owned ? TW_REP_START : TW_START;
+            twi_owned = true;
+
+            break;
+        case SIM_TWI_BYTE:
+            // Only an address follows a start; nobody acknowledges it
+            if ((TWSR & TW_STATUS_MASK) == TW_START || (TWSR & TW_STATUS_MASK) == TW_REP_START) {
+                status = (TWDR & TW_READ) ? TW_MR_SLA_NACK : TW_MT_SLA_NACK;
+            } else {
+                status = TW_BUS_ERROR;
+            }
+
+            break;
+    }
+
+    TWSR = status | (TWSR & 0x03);
+    twi_flag = true;
+
+    if (twi_control & _BV(TWIE)) {
+        pending |= SIM_INT_TWI;
+    }
+}
@@ -0,0 +1,186 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "Arduino.h"
+
+// Time is kept in CPU cycles, so every figure is exact and reproducible.
+#define SIM_CYCLES_PER_US (F_CPU / 1000000UL)
+#define SIM_CYCLES_PER_MS (F_CPU / 1000UL)
+
+// Cost of the operations that busy waits are made of. Everything else the
+// firmware does takes no simulated time at all.
+#define SIM_CLOCK_READ_CYCLES 64
+#define SIM_REGISTER_READ_CYCLES 2
+
+// A conversion takes 13 ADC clocks at F_CPU / 128.
+#define SIM_ADC_CONVERSION_CYCLES (13 * 128)
+#define SIM_ADC_CHANNELS 8
+#define SIM_ADC_MAX 1023
+
+#define SIM_BANDGAP_VOLTAGE 1100
+#define SIM_DEFAULT_SUPPLY_VOLTAGE 3000
+
+// ADC noise reduction sleep gives up after this long without an interrupt.
+#define SIM_MAX_IDLE_SLEEP (SIM_CYCLES_PER_MS * 1000)
+
+// Power down without a timer and nothing left to wake us up.
+#define SIM_MAX_POWER_DOWN (3600UL * 1000)
+
+// Free memory as reported to the firmware, as the host's isn't comparable.
+#define SIM_FREE_MEMORY 1024
+
+#define SIM_PINS 22
+#define SIM_EXTERNAL_INTERRUPTS 2
+#define SIM_SERIAL_BUFFER_SIZE 256
+
+// Largest payload of a scripted binary frame.
+#define SIM_FRAME_MAX_SIZE 64
+
+// Radio time per message, including the hardware ack of the next hop.
+#define SIM_TRANSMIT_CYCLES (1500UL * SIM_CYCLES_PER_US)
+
+// Interrupts, in order of priority.
+#define SIM_INT_INT0 0x01
+#define SIM_INT_INT1 0x02
+#define SIM_INT_PCINT0 0x04
+#define SIM_INT_PCINT1 0x08
+#define SIM_INT_PCINT2 0x10
+#define SIM_INT_ADC 0x20
+#define SIM_INT_TWI 0x40
+
+#define SIM_PIN_RELEASED -1
+
+/**
+ * Simulated ATmega328, driven by a script of timed events: supply voltage,
+ * analog inputs, externally driven pins and serial input.
+ *
+ * Time only passes when the firmware waits for it, i.e. when it reads the
+ * clock, delays, polls a busy register, converts, transmits or sleeps. As
+ * millis() doesn't advance in power down, time spent awake is tracked apart
+ * from the total.
+ */
+class Simulation {
+    public:
+        static void powerOn(uint64_t time);
+        static void setSleepSkew(int32_t ppm);
+
+        static bool loadScript(const char* path);
+        static bool addEvent(const char* line);
+
+        static uint64_t getTime();
+        static uint64_t getAwakeTime();
+        static uint64_t getSleepTime();
+        static uint64_t getWakeTime();
+        static uint32_t getInterruptCount();
+
+        static void advance(uint64_t cycles);
+        static void idle(bool noise_reduction);
+        static int8_t powerDown(uint32_t duration, uint8_t interrupts, uint8_t mode0, uint8_t mode1);
+
+        static void enableInterrupts();
+        static void disableInterrupts();
+        static bool areInterruptsEnabled();
+
+        static void attachInterrupt(uint8_t interrupt, void (*callback)(void), int mode);
+        static void detachInterrupt(uint8_t interrupt);
+
+        static void setPinMode(uint8_t pin, uint8_t mode);
+        static void writePin(uint8_t pin, uint8_t value);
+        static uint8_t readPin(uint8_t pin);
+        static void drivePin(uint8_t pin, int8_t level);
+
+        static void setAnalog(uint8_t channel, uint16_t value, uint16_t noise);
+        static void setSupplyVoltage(uint16_t voltage);
+        static uint16_t sample(uint8_t mux);
+
+        static uint8_t readAdcControl();
+        static void writeAdcControl(uint8_t value);
+        static uint8_t readTwiControl();
+        static void writeTwiControl(uint8_t value);
+
+        static void feedSerial(const char* data);
+        static void feedFrame(const uint8_t* payload, uint16_t size);
+        static int availableSerial();
+        static int peekSerial();
+        static int readSerial();
+
+    private:
+        struct Event {
+            uint64_t time;
+            uint8_t action;
+            uint8_t target;
+            int16_t value;
+            uint16_t extra;
+            char* data;
+        };
+
+        struct Pin {
+            uint8_t mode;
+            uint8_t output;
+            int8_t external;
+            uint8_t level;
+        };
+
+        static uint64_t now;
+        static uint64_t slept;
+        static uint64_t powered_on;
+        static uint64_t woke_at;
+        static uint8_t depth;
+        static int32_t sleep_skew;
+
+        static Event* events;
+        static uint16_t event_count;
+        static uint16_t event_capacity;
+        static uint16_t next_event;
+
+        static bool interrupts_enabled;
+        static uint8_t pending;
+        static uint32_t interrupt_count;
+
+        static void (*handlers[SIM_EXTERNAL_INTERRUPTS])(void);
+        static int handler_modes[SIM_EXTERNAL_INTERRUPTS];
+
+        static bool powered_down;
+        static uint8_t wake_interrupts;
+        static int wake_modes[SIM_EXTERNAL_INTERRUPTS];
+        static int8_t woken_by;
+
+        static Pin pins[SIM_PINS];
+
+        static uint16_t analog[SIM_ADC_CHANNELS];
+        static uint16_t noise[SIM_ADC_CHANNELS];
+        static uint16_t supply_voltage;
+        static uint32_t noise_state;
+
+        static uint8_t adc_control;
+        static bool adc_converting;
+        static uint8_t adc_mux;
+        static uint64_t adc_done_at;
+
+        static uint8_t twi_control;
+        static uint8_t twi_operation;
+        static bool twi_flag;
+        static bool twi_owned;
+        static uint64_t twi_done_at;
+
+        static char serial[SIM_SERIAL_BUFFER_SIZE];
+        static uint16_t serial_head;
+        static uint16_t serial_count;
+
+        static uint64_t nextEventTime();
+        static void runEvents();
+        static void runEvent(Event* event);
+        static void deliverInterrupts();
+
+        static void updatePin(uint8_t pin);
+        static bool matchesMode(int mode, uint8_t level);
+
+        static void startConversion();
+        static void completeConversion();
+
+        static uint32_t getTwiBitCycles();
+        static void scheduleTwi(uint8_t operation, uint32_t cycles);
+        static void completeTwi();
+};
+
+#endif
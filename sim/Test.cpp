@@ -0,0 +1,223 @@
+#include <math.h>
+
+#include "Simulation.h"
+
+#include <Logging.h>
+
+#include "FixedPoint.h"
+#include "ModuleManager.h"
+#include "Sensor/GenericVoltage.h"
+#include "Sensor/HCSR04.h"
+
+// Largest difference tolerated between an HCSR04 distance and the floating
+// point formula it replaced, in centimeters.
+#define TEST_DISTANCE_TOLERANCE 1
+
+// Longest echo duration converted, in microseconds: the longest pulse a
+// single ping can measure.
+#define TEST_MAX_DURATION 65535UL
+
+// Sketch entry point, from src/main.cpp.
+void setup();
+
+// Checks run and failed so far.
+static uint32_t checks = 0;
+static uint32_t failures = 0;
+
+/**
+ * Count a check, and report it if it failed. Only the first few failures of
+ * a run are reported.
+ *
+ * @return bool Whether the check passed
+ */
+static bool check(bool passed, const char* format, ...)
+{
+    va_list args;
+
+    checks++;
+
+    if (passed) {
+        return true;
+    }
+
+    if (failures++ < 10) {
+        va_start(args, format);
+        printf("FAIL ");
+        vprintf(format, args);
+        printf("\n");
+        va_end(args);
+    }
+
+    return false;
+}
+
+/**
+ * Compare GenericVoltage::toMillivolts() against the floating point formula it
+ * replaced, (level / samples / 1024 * 5) / coefficient, for every level the
+ * ADC can produce at a number of sample counts and coefficients.
+ *
+ * @return void
+ */
+static void testMillivolts()
+{
+    static const uint16_t sample_counts[] = { 1, 4, 16, 20, 64, 256 };
+    static const uint32_t coefficients[] = { 250, 500, 1000, 2000, 3300, 11000, 65536, 100000, GENERIC_VOLTAGE_MAX_COEFFICIENT };
+    GenericVoltage* voltage;
+    double expected;
+    double tolerance;
+    int32_t actual;
+    uint32_t level;
+    uint8_t i;
+    uint8_t j;
+
+    for (i = 0; i < sizeof(sample_counts) / sizeof(sample_counts[0]); i++) {
+        for (j = 0; j < sizeof(coefficients) / sizeof(coefficients[0]); j++) {
+            voltage = new GenericVoltage(A0, sample_counts[i], coefficients[j]);
+            tolerance = 0.5 + (0.16 * GENERIC_VOLTAGE_COEFFICIENT_ONE / coefficients[j]);
+
+            for (level = 0; level <= 1023UL * sample_counts[i]; level++) {
+                expected = ((double) level / sample_counts[i] / 1024.0 * 5.0) / ((double) coefficients[j] / GENERIC_VOLTAGE_COEFFICIENT_ONE) * 1000;
+                actual = voltage->toMillivolts(level);
+
+                check(
+                    fabs(actual - expected) <= tolerance,
+                    "millivolts; samples=%u, coefficient=%u, level=%u, actual=%d, expected=%.3f",
+                    sample_counts[i], coefficients[j], level, actual, expected
+                );
+            }
+
+            delete voltage;
+        }
+    }
+}
+
+/**
+ * Compare HCSR04::toDistance() against the floating point formulas it
+ * replaced: duration / 58.2 at an unknown temperature, and the temperature
+ * compensated speed of sound otherwise. Both truncated to whole centimeters.
+ *
+ * @return void
+ */
+static void testDistance()
+{
+    static const int8_t temperatures[] = { HCSR04_TEMPERATURE_UNKNOWN, -20, 0, 20, 45 };
+    uint32_t duration;
+    uint32_t actual;
+    uint32_t expected;
+    uint8_t i;
+
+    for (i = 0; i < sizeof(temperatures) / sizeof(temperatures[0]); i++) {
+        for (duration = 0; duration <= TEST_MAX_DURATION; duration++) {
+            if (temperatures[i] == HCSR04_TEMPERATURE_UNKNOWN) {
+                expected = duration / 58.2;
+            } else {
+                expected = duration * ((331.3 + 0.606 * temperatures[i]) / 2 / 10000);
+            }
+
+            actual = HCSR04::toDistance(duration, temperatures[i]);
+
+            check(
+                labs((long) actual - (long) expected) <= TEST_DISTANCE_TOLERANCE,
+                "distance; temperature=%d, duration=%u, actual=%u, expected=%u",
+                temperatures[i], duration, actual, expected
+            );
+        }
+    }
+}
+
+/**
+ * Format fixed-point values and parse them back, for every amount of decimals
+ * used by the firmware, over a range of values around zero and at the limits
+ * of 32 bits. Parsing the output of printf() must give the same values.
+ *
+ * @return void
+ */
+static void testFixedPoint()
+{
+    static const int32_t limits[] = { INT32_MAX, INT32_MIN + 1, 999999999, -999999999 };
+    static const int32_t scales[] = { 1, 10, 100, 1000, 10000 };
+    char buffer[FIXED_POINT_MAX_SIZE];
+    char expected[FIXED_POINT_MAX_SIZE * 2];
+    int32_t value;
+    uint8_t decimals;
+    uint8_t i;
+
+    for (decimals = 0; decimals <= 4; decimals++) {
+        for (value = -100000; value <= 100000; value++) {
+            formatFixedPoint(buffer, value, decimals);
+
+            if (decimals) {
+                snprintf(expected, sizeof(expected), "%s%d.%0*d", value < 0 ? "-" : "", abs(value) / scales[decimals], decimals, abs(value) % scales[decimals]);
+            } else {
+                snprintf(expected, sizeof(expected), "%d", value);
+            }
+
+            check(!strcmp(buffer, expected), "format; value=%d, decimals=%u, actual=%s, expected=%s", value, decimals, buffer, expected);
+            check(parseFixedPoint(buffer, decimals) == value, "parse; value=%d, decimals=%u, string=%s", value, decimals, buffer);
+        }
+
+        for (i = 0; i < sizeof(limits) / sizeof(limits[0]); i++) {
+            formatFixedPoint(buffer, limits[i], decimals);
+
+            check(
+                strlen(buffer) < FIXED_POINT_MAX_SIZE && parseFixedPoint(buffer, decimals) == limits[i],
+                "round trip; value=%d, decimals=%u, string=%s", limits[i], decimals, buffer
+            );
+        }
+    }
+
+    // Surplus decimals are truncated, and parsing stops at anything else
+    check(parseFixedPoint("2.5", 3) == 2500, "parse; string=2.5");
+    check(parseFixedPoint("-0.0509", 3) == -50, "parse; string=-0.0509");
+    check(parseFixedPoint("1.2345", 0) == 1, "parse; string=1.2345");
+    check(parseFixedPoint("12,5", 1) == 120, "parse; string=12,5");
+    check(parseFixedPoint(NULL, 3) == 0, "parse; string=NULL");
+
+    // Generic voltage coefficients above 65.535 need more than 16 bits
+    check(parseFixedPoint("100", 3) == 100000, "parse; string=100");
+    check(parseFixedPoint("16777.215", 3) == (int32_t) GENERIC_VOLTAGE_MAX_COEFFICIENT, "parse; string=16777.215");
+}
+
+/**
+ * Register modules from configurations written before they gained their
+ * optional parameters, and check every one of them is presented.
+ *
+ * @return void
+ */
+static void testModuleConfigurations()
+{
+    static const char* const configurations[] = { "1,2", "2,3,4", "3,1", "3,1,200", "4,1", "6,1", "6,1,16" };
+    char configuration[CONFIG_STRINGS_MAX_SIZE];
+    uint32_t sent;
+    uint8_t i;
+
+    for (i = 0; i < sizeof(configurations) / sizeof(configurations[0]); i++) {
+        snprintf(configuration, sizeof(configuration), "%s", configurations[i]);
+        sent = MySensor::getSentCount();
+
+        ModuleManager::registerModule(i, configuration);
+
+        check(MySensor::getSentCount() > sent, "module; configuration=%s", configurations[i]);
+    }
+}
+
+/**
+ * Check the firmware's fixed-point conversions against the floating point
+ * formulas they replaced.
+ *
+ * @return int 1 if any check failed
+ */
+int main(int argc, char** argv)
+{
+    Logging::setMuted(true);
+    setup();
+
+    testMillivolts();
+    testDistance();
+    testFixedPoint();
+    testModuleConfigurations();
+
+    printf("%u checks, %u failed\n", checks, failures);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,170 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+/**
+ * Host stand-in for the Arduino core, covering what the firmware uses on an
+ * ATmega328. Timing and I/O are backed by the simulation in sim/Simulation.h.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define NOT_AN_INTERRUPT -1
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+
+#define SDA A4
+#define SCL A5
+
+#define NUM_DIGITAL_PINS 20
+#define NUM_ANALOG_INPUTS 8
+
+#define CR "\r\n"
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#define bit(b) (1UL << (b))
+#define bitRead(value, b) (((value) >> (b)) & 0x01)
+
+// Flash strings live in regular memory on the host.
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper*>(string_literal))
+
+// Ports, as numbered by the Arduino core.
+#define NOT_A_PORT 0
+#define PB 2
+#define PC 3
+#define PD 4
+
+#define digitalPinToPort(p) (((p) <= 7) ? PD : (((p) <= 13) ? PB : PC))
+#define digitalPinToBitMask(p) ((uint8_t) (1 << (((p) <= 7) ? (p) : (((p) <= 13) ? ((p) - 8) : ((p) - 14)))))
+#define portInputRegister(port) ((port) == PB ? &PINB : ((port) == PC ? &PINC : &PIND))
+
+#define digitalPinToPCICR(p) (((p) >= 0 && (p) <= 21) ? (&PCICR) : ((volatile uint8_t*) 0))
+#define digitalPinToPCICRbit(p) (((p) <= 7) ? 2 : (((p) <= 13) ? 0 : 1))
+#define digitalPinToPCMSK(p) (((p) <= 7) ? (&PCMSK2) : (((p) <= 13) ? (&PCMSK0) : (((p) <= 21) ? (&PCMSK1) : ((volatile uint8_t*) 0))))
+#define digitalPinToPCMSKbit(p) (((p) <= 7) ? (p) : (((p) <= 13) ? ((p) - 8) : ((p) - 14)))
+
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : NOT_AN_INTERRUPT))
+
+// Time, in the 32 bits of an unsigned long on the AVR, so it wraps the same.
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogReference(uint8_t mode);
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout = 1000000L);
+
+void attachInterrupt(uint8_t interrupt, void (*callback)(void), int mode);
+void detachInterrupt(uint8_t interrupt);
+
+void interrupts();
+void noInterrupts();
+
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+
+// What can't be done on the host: a reset ends the simulation run by throwing
+// SimulationReset, and free memory is reported as a fixed amount.
+struct SimulationReset {};
+
+void simulateReset();
+int simulateFreeMemory();
+
+/**
+ * Arduino String, limited to what the firmware uses.
+ */
+class String {
+    public:
+        String(const char* value = "");
+        String(const String& other);
+        ~String();
+
+        String& operator=(const String& other);
+        String& operator=(const char* value);
+        String& operator+=(char ch);
+        String& operator+=(const char* value);
+
+        unsigned int length() const;
+        const char* c_str() const;
+
+        int indexOf(char ch) const;
+        String substring(unsigned int from) const;
+        String substring(unsigned int from, unsigned int to) const;
+        long toInt() const;
+        void toCharArray(char* buffer, unsigned int size) const;
+
+    private:
+        char* buffer;
+        unsigned int size;
+
+        void assign(const char* value, unsigned int length);
+};
+
+// Size of the serial transmit buffer, as in the Arduino core.
+#define SERIAL_TX_BUFFER_SIZE 64
+
+/**
+ * Serial port. Input is fed by the simulation script, output goes to stdout,
+ * which never makes a write wait.
+ */
+class HardwareSerial {
+    public:
+        void begin(unsigned long baud);
+        void end();
+
+        int available();
+        int read();
+        int peek();
+
+        int availableForWrite();
+        size_t write(uint8_t ch);
+        size_t write(const uint8_t* buffer, size_t size);
+        size_t print(const char* value);
+        size_t print(char ch);
+        void flush();
+
+        operator bool();
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef EEPROMEX_H
+#define EEPROMEX_H
+
+/**
+ * EEPROMex stand-in, backed by a file so configuration survives between runs.
+ */
+
+#include "Arduino.h"
+
+#define EEPROMSizeATmega328 1024
+
+class EEPROMClassEx {
+    public:
+        EEPROMClassEx();
+
+        void setMemPool(int base, int size);
+        int getAddress(int bytes);
+
+        uint8_t read(int address);
+        bool write(int address, uint8_t value);
+        bool update(int address, uint8_t value);
+
+        template <class T> int readBlock(int address, T& value) {
+            return this->readBytes(address, (uint8_t*) &value, sizeof(value));
+        }
+
+        template <class T> int writeBlock(int address, const T& value) {
+            return this->writeBytes(address, (const uint8_t*) &value, sizeof(value), false);
+        }
+
+        template <class T> int updateBlock(int address, const T& value) {
+            return this->writeBytes(address, (const uint8_t*) &value, sizeof(value), true);
+        }
+
+        static void setFile(const char* path);
+        static uint32_t getWriteCount();
+
+    private:
+        int base;
+        int size;
+        int next;
+
+        int readBytes(int address, uint8_t* buffer, int length);
+        int writeBytes(int address, const uint8_t* buffer, int length, bool update);
+};
+
+extern EEPROMClassEx EEPROM;
+
+#endif
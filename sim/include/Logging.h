@@ -0,0 +1,44 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+/**
+ * Logging library stand-in, printing to stdout with the same format
+ * specifiers: %s, %c, %d, %l, %x, %X, %b, %B, %t and %T.
+ */
+
+#include <stdarg.h>
+
+#include "Arduino.h"
+
+#define LOG_LEVEL_NOOUTPUT 0
+#define LOG_LEVEL_ERRORS 1
+#define LOG_LEVEL_INFOS 2
+#define LOG_LEVEL_DEBUG 3
+#define LOG_LEVEL_VERBOSE 4
+
+class Logging {
+    public:
+        void Init(int level, long baud);
+
+        void Error(const __FlashStringHelper* format, ...);
+        void Info(const __FlashStringHelper* format, ...);
+        void Debug(const __FlashStringHelper* format, ...);
+        void Verbose(const __FlashStringHelper* format, ...);
+
+        void Error(const char* format, ...);
+        void Info(const char* format, ...);
+        void Debug(const char* format, ...);
+        void Verbose(const char* format, ...);
+
+        // Silences all output, whatever the firmware initializes the level to.
+        static void setMuted(bool muted);
+
+    private:
+        int level;
+
+        void print(int level, const char* format, va_list args);
+};
+
+extern Logging Log;
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef MYSENSOR_H
+#define MYSENSOR_H
+
+/**
+ * MySensors 1.x stand-in. Messages are handed to a transmitter, which by
+ * default accounts the time spent on air and writes every message to the
+ * message trace in serial protocol format. Incoming messages are taken from a
+ * receiver, if one is set.
+ */
+
+#include "Arduino.h"
+
+#define AUTO 0xFF
+#define BROADCAST_ADDRESS 0xFF
+#define GATEWAY_ADDRESS 0
+#define NODE_SENSOR_ID 0xFF
+
+#define MAX_PAYLOAD 25
+
+// Commands
+#define C_PRESENTATION 0
+#define C_SET 1
+#define C_REQ 2
+#define C_INTERNAL 3
+#define C_STREAM 4
+
+// Internal messages
+#define I_BATTERY_LEVEL 0
+#define I_TIME 1
+#define I_VERSION 2
+#define I_ID_REQUEST 3
+#define I_ID_RESPONSE 4
+#define I_INCLUSION_MODE 5
+#define I_CONFIG 6
+#define I_FIND_PARENT 7
+#define I_FIND_PARENT_RESPONSE 8
+#define I_LOG_MESSAGE 9
+#define I_CHILDREN 10
+#define I_SKETCH_NAME 11
+#define I_SKETCH_VERSION 12
+
+enum {
+    S_DOOR, S_MOTION, S_SMOKE, S_LIGHT, S_DIMMER, S_COVER, S_TEMP, S_HUM, S_BARO,
+    S_WIND, S_RAIN, S_UV, S_WEIGHT, S_POWER, S_HEATER, S_DISTANCE, S_LIGHT_LEVEL,
+    S_ARDUINO_NODE, S_ARDUINO_REPEATER_NODE, S_LOCK, S_IR, S_WATER,
+    S_AIR_QUALITY, S_CUSTOM, S_DUST, S_SCENE_CONTROLLER
+};
+
+enum {
+    V_TEMP, V_HUM, V_LIGHT, V_DIMMER, V_PRESSURE, V_FORECAST, V_RAIN, V_RAINRATE,
+    V_WIND, V_GUST, V_DIRECTION, V_UV, V_WEIGHT, V_DISTANCE, V_IMPEDANCE, V_ARMED,
+    V_TRIPPED, V_WATT, V_KWH, V_SCENE_ON, V_SCENE_OFF, V_HEATER, V_HEATER_SW,
+    V_LIGHT_LEVEL, V_VAR1, V_VAR2, V_VAR3, V_VAR4, V_VAR5, V_UP, V_DOWN, V_STOP,
+    V_IR_SEND, V_IR_RECEIVE, V_FLOW, V_VOLUME, V_LOCK_STATUS, V_DUST_LEVEL,
+    V_VOLTAGE, V_CURRENT
+};
+
+class MyMessage {
+    public:
+        MyMessage();
+        MyMessage(uint8_t sensor, uint8_t type);
+
+        uint8_t sender;
+        uint8_t destination;
+        uint8_t sensor;
+        uint8_t command;
+        uint8_t type;
+        bool request_ack;
+        bool ack;
+        char data[MAX_PAYLOAD + 1];
+
+        MyMessage& setSensor(uint8_t sensor);
+        MyMessage& setType(uint8_t type);
+        MyMessage& setDestination(uint8_t destination);
+
+        MyMessage& set(const char* value);
+        MyMessage& set(uint8_t value);
+        MyMessage& set(float value, uint8_t decimals);
+        MyMessage& set(unsigned long value);
+        MyMessage& set(long value);
+        MyMessage& set(unsigned int value);
+        MyMessage& set(int value);
+
+        uint8_t getSensor() const;
+        uint8_t getType() const;
+        uint8_t getCommand() const;
+        const char* getString() const;
+        int getInt() const;
+        long getLong() const;
+        bool isAck() const;
+};
+
+class MySensor {
+    public:
+        typedef void (*MessageCallback)(const MyMessage&);
+
+        // Sends a message, returning whether the next hop received it.
+        typedef bool (*Transmitter)(MySensor* node, MyMessage& message);
+
+        // Takes a message that has arrived for the node, returning whether
+        // there was one.
+        typedef bool (*Receiver)(MySensor* node, MyMessage& message);
+
+        MySensor();
+
+        void begin(MessageCallback callback = NULL, uint8_t node_id = AUTO, bool repeater = false, uint8_t parent_id = AUTO);
+        uint8_t getNodeId();
+
+        void sendSketchInfo(const char* name, const char* version, bool ack = false);
+        void present(uint8_t child_id, uint8_t type, bool ack = false);
+        bool send(MyMessage& message, bool ack = false);
+        void sendBatteryLevel(uint8_t level, bool ack = false);
+
+        bool process();
+        void wait(unsigned long ms);
+
+        void sleep(unsigned long ms);
+        bool sleep(uint8_t interrupt, uint8_t mode, unsigned long ms = 0);
+        int8_t sleep(uint8_t interrupt1, uint8_t mode1, uint8_t interrupt2, uint8_t mode2, unsigned long ms = 0);
+
+        static void setTransmitter(Transmitter transmitter);
+        static void setReceiver(Receiver receiver);
+        static void setNodeId(uint8_t node_id);
+        static void setTrace(FILE* trace);
+        static uint32_t getSentCount();
+        static uint32_t getFailedCount();
+
+        static bool transmit(MySensor* node, MyMessage& message);
+
+    private:
+        uint8_t node_id;
+        MessageCallback callback;
+
+        bool sendInternal(uint8_t type, const char* value, bool ack);
+};
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef SIM_AVR_INTERRUPT_H
+#define SIM_AVR_INTERRUPT_H
+
+/**
+ * Interrupt vectors are plain functions, called by the simulation whenever
+ * the corresponding interrupt fires while interrupts are enabled.
+ */
+
+#include <avr/io.h>
+
+#define ISR(vector, ...) extern "C" void vector(void)
+
+extern "C" {
+    void ADC_vect(void);
+    void TWI_vect(void);
+    void PCINT0_vect(void);
+    void PCINT1_vect(void);
+    void PCINT2_vect(void);
+}
+
+void sei();
+void cli();
+
+#endif
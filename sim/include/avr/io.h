@@ -0,0 +1,94 @@
+#ifndef SIM_AVR_IO_H
+#define SIM_AVR_IO_H
+
+/**
+ * ATmega328 registers used by the firmware. Registers the firmware busy waits
+ * on, or whose writes start the hardware, are backed by the simulation; the
+ * others are plain memory.
+ */
+
+#include <stdint.h>
+
+#ifndef _BV
+#define _BV(bit) (1 << (bit))
+#endif
+
+/**
+ * A register with side effects on reads and writes.
+ */
+class SimRegister {
+    public:
+        typedef uint8_t (*Reader)();
+        typedef void (*Writer)(uint8_t);
+
+        SimRegister(Reader reader, Writer writer) : reader(reader), writer(writer) {}
+
+        operator uint8_t() const { return this->reader(); }
+
+        SimRegister& operator=(uint8_t value) { this->writer(value); return *this; }
+        SimRegister& operator|=(uint8_t value) { this->writer(this->reader() | value); return *this; }
+        SimRegister& operator&=(uint8_t value) { this->writer(this->reader() & value); return *this; }
+        SimRegister& operator^=(uint8_t value) { this->writer(this->reader() ^ value); return *this; }
+
+    private:
+        Reader reader;
+        Writer writer;
+};
+
+// ADC
+extern SimRegister ADCSRA;
+extern volatile uint8_t ADMUX;
+extern volatile uint8_t ADCSRB;
+extern volatile uint8_t DIDR0;
+extern volatile uint16_t ADC;
+
+#define REFS1 7
+#define REFS0 6
+#define ADLAR 5
+
+#define ADEN 7
+#define ADSC 6
+#define ADATE 5
+#define ADIF 4
+#define ADIE 3
+#define ADPS2 2
+#define ADPS1 1
+#define ADPS0 0
+
+#define ADTS2 2
+#define ADTS1 1
+#define ADTS0 0
+
+// TWI
+extern SimRegister TWCR;
+extern volatile uint8_t TWBR;
+extern volatile uint8_t TWSR;
+extern volatile uint8_t TWDR;
+extern volatile uint8_t TWAR;
+
+#define TWINT 7
+#define TWEA 6
+#define TWSTA 5
+#define TWSTO 4
+#define TWWC 3
+#define TWEN 2
+#define TWIE 0
+
+#define TWPS1 1
+#define TWPS0 0
+
+// Ports and pin change interrupts
+extern volatile uint8_t PINB;
+extern volatile uint8_t PINC;
+extern volatile uint8_t PIND;
+
+extern volatile uint8_t PCICR;
+extern volatile uint8_t PCMSK0;
+extern volatile uint8_t PCMSK1;
+extern volatile uint8_t PCMSK2;
+
+#define PCIE0 0
+#define PCIE1 1
+#define PCIE2 2
+
+#endif
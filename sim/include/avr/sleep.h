@@ -0,0 +1,20 @@
+#ifndef SIM_AVR_SLEEP_H
+#define SIM_AVR_SLEEP_H
+
+#include <stdint.h>
+
+#define SLEEP_MODE_IDLE 0
+#define SLEEP_MODE_ADC 1
+#define SLEEP_MODE_PWR_DOWN 2
+#define SLEEP_MODE_PWR_SAVE 3
+#define SLEEP_MODE_STANDBY 6
+
+void set_sleep_mode(uint8_t mode);
+void sleep_enable();
+void sleep_disable();
+
+// Sleeps until the next interrupt, which in ADC noise reduction mode includes
+// the conversion it starts.
+void sleep_cpu();
+
+#endif
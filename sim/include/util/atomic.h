@@ -0,0 +1,28 @@
+#ifndef SIM_UTIL_ATOMIC_H
+#define SIM_UTIL_ATOMIC_H
+
+#include <avr/interrupt.h>
+
+#define ATOMIC_RESTORESTATE true
+#define ATOMIC_FORCEON false
+
+/**
+ * Disables interrupts for the lifetime of a block, then either restores or
+ * enables them, leaving the block by any means.
+ */
+class SimAtomicBlock {
+    public:
+        SimAtomicBlock(bool restore);
+        ~SimAtomicBlock();
+
+        bool enter() { return this->entered ? false : (this->entered = true); }
+
+    private:
+        bool entered;
+        bool restore;
+        bool enabled;
+};
+
+#define ATOMIC_BLOCK(type) for (SimAtomicBlock __atomic_block(type); __atomic_block.enter(); )
+
+#endif
@@ -0,0 +1,485 @@
+#include "AdcManager.h"
+
+// Channel array, doubling as the scan list.
+AdcManager::Channel AdcManager::channels[ADC_AVAILABLE_CHANNELS] = {};
+
+// Channel count.
+uint8_t AdcManager::channel_count = 0;
+
+// Samples per result for channels that don't request more.
+uint16_t AdcManager::default_samples = 1;
+
+// Whether conversions are performed in ADC noise reduction sleep.
+bool AdcManager::noise_reduction = false;
+
+// Time spent converting since it was last taken, in microseconds.
+uint32_t AdcManager::conversion_time = 0;
+
+// Conversion state, shared with the conversion complete interrupt.
+volatile bool AdcManager::sweeping = false;
+volatile uint8_t AdcManager::current = 0;
+volatile uint8_t AdcManager::discards = 0;
+volatile uint16_t AdcManager::count = 0;
+volatile uint32_t AdcManager::accumulator = 0;
+
+/**
+ * ADC conversion complete interrupt.
+ */
+ISR(ADC_vect)
+{
+    AdcManager::handleConversion();
+}
+
+/**
+ * Load the sampler configuration.
+ *
+ * @return void
+ */
+void AdcManager::initialize()
+{
+    uint8_t bits;
+
+    bits = min(ConfigurationManager::getInteger(CFG_ADC_OVERSAMPLING), ADC_MAX_OVERSAMPLING_BITS);
+
+    // Every extra bit of resolution requires four times the samples
+    default_samples = 1 << (bits * 2);
+    noise_reduction = ConfigurationManager::getBoolean(CFG_ADC_NOISE_REDUCTION);
+
+    LogManager::debug(LOG_MOD, F("adc: samples=%d, sleep=%T"CR), default_samples, noise_reduction);
+}
+
+/**
+ * Register an analog pin, adding it to the scan list.
+ *
+ * @param uint8_t  pin     Analog pin, either as channel number or as A0 - A7.
+ * @param uint16_t samples Minimum amount of samples to accumulate per result.
+ *
+ * @return uint8_t Channel index, or ADC_CHANNEL_NONE if no channels are left
+ */
+uint8_t AdcManager::registerChannel(uint8_t pin, uint16_t samples)
+{
+    uint8_t index;
+
+    samples = max(samples, default_samples);
+    index = findChannel(pin);
+
+    if (index != ADC_CHANNEL_NONE) {
+        channels[index].samples = max(channels[index].samples, samples);
+
+        return index;
+    }
+
+    if (channel_count >= ADC_AVAILABLE_CHANNELS) {
+        LogManager::error(LOG_MOD, F("adc: channels exhausted; pin=%d"CR), pin);
+
+        return ADC_CHANNEL_NONE;
+    }
+
+    stop();
+
+    index = channel_count;
+    channels[index].mux = pin >= A0 ? pin - A0 : pin;
+    channels[index].samples = samples;
+    channels[index].sum = 0;
+    channels[index].ready = false;
+    channel_count++;
+
+    return index;
+}
+
+/**
+ * Convert all channels in the scan list in a single back-to-back sweep, so
+ * that the results form a time-coherent snapshot. The ADC free runs for the
+ * duration of the sweep and is left idle afterwards. Results of previous
+ * sweeps are dropped, so channels the sweep doesn't get to aren't read as
+ * fresh.
+ *
+ * The sweep blocks until it's done. It takes about 0.1ms per sample, so a few
+ * milliseconds per channel at the default oversampling, and the modules
+ * reading its results are updated right after it. The KY038 then needs the
+ * ADC to itself for its whole window, so a sweep left running in the
+ * background would only have to be waited for there instead.
+ *
+ * @return void
+ */
+void AdcManager::sweep()
+{
+    unsigned long started;
+    uint8_t i;
+
+    if (!channel_count) {
+        return;
+    }
+
+    stop();
+
+    for (i = 0; i < channel_count; i++) {
+        channels[i].ready = false;
+    }
+
+    if (noise_reduction) {
+        started = micros();
+        sweepAsleep();
+        conversion_time += micros() - started;
+
+        return;
+    }
+
+    sweeping = true;
+    selectChannel(0);
+
+    ADCSRB = 0; // Free running mode
+    ADCSRA = (1 << ADEN) | (1 << ADSC) | (1 << ADATE) | (1 << ADIE) | ADC_PRESCALER;
+
+    started = micros();
+
+    while (sweeping) {
+        if ((micros() - started) >= ADC_SWEEP_TIMEOUT * 1000UL) {
+            LogManager::error(LOG_MOD, F("adc: sweep timeout; channel=%d"CR), channels[current].mux);
+            stop();
+
+            break;
+        }
+    }
+
+    conversion_time += micros() - started;
+}
+
+/**
+ * Abort a sweep that may be in progress, e.g. before going to sleep. Results
+ * collected so far remain available.
+ *
+ * @return void
+ */
+void AdcManager::stop()
+{
+    ADCSRA &= ~((1 << ADATE) | (1 << ADIE));
+
+    // Wait for a conversion that may still be in progress
+    while (ADCSRA & (1 << ADSC));
+
+    sweeping = false;
+}
+
+/**
+ * Return the averaged 10-bit result for a pin from the latest sweep.
+ *
+ * @return uint16_t
+ */
+uint16_t AdcManager::read(uint8_t pin)
+{
+    uint16_t samples;
+
+    samples = getSampleCount(pin);
+
+    return (readSum(pin) + (samples / 2)) / samples;
+}
+
+/**
+ * Return the sum of the samples making up the result for a pin from the latest
+ * sweep. If the latest sweep didn't get to the pin, or none was performed yet,
+ * a single conversion stands in for every sample.
+ *
+ * @return uint32_t
+ */
+uint32_t AdcManager::readSum(uint8_t pin)
+{
+    uint8_t index;
+    uint32_t sum = 0;
+
+    index = findChannel(pin);
+
+    if (index == ADC_CHANNEL_NONE) {
+        return convert(pin);
+    }
+
+    if (!channels[index].ready) {
+        return convert(pin) * (uint32_t) channels[index].samples;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        sum = channels[index].sum;
+    }
+
+    return sum;
+}
+
+/**
+ * Return the time spent converting since the previous call, in microseconds.
+ *
+ * @return uint32_t
+ */
+uint32_t AdcManager::takeConversionTime()
+{
+    uint32_t time = conversion_time;
+
+    conversion_time = 0;
+
+    return time;
+}
+
+/**
+ * Return the amount of samples making up a result for a pin.
+ *
+ * @return uint16_t
+ */
+uint16_t AdcManager::getSampleCount(uint8_t pin)
+{
+    uint8_t index = findChannel(pin);
+
+    return index == ADC_CHANNEL_NONE ? 1 : channels[index].samples;
+}
+
+/**
+ * Measure the internal bandgap against AVcc, which allows calculating the
+ * supply voltage without any external parts. Takes about 0.1ms per sample,
+ * plus up to 3.5ms for the bandgap to settle.
+ *
+ * @param uint16_t samples Amount of samples to accumulate.
+ *
+ * @return uint32_t Sum of the samples
+ */
+uint32_t AdcManager::readBandgap(uint16_t samples)
+{
+    uint32_t sum = 0;
+    uint32_t started;
+    uint16_t previous = 0;
+    uint16_t value;
+    uint8_t settle;
+    uint16_t i;
+
+    stop();
+
+    started = micros();
+
+    ADMUX = ADC_REFERENCE | ADC_BANDGAP_CHANNEL;
+    ADCSRA = (1 << ADEN) | ADC_PRESCALER;
+
+    for (settle = 0; settle < ADC_BANDGAP_MAX_SETTLE_CONVERSIONS; settle++) {
+        value = convertSingle();
+
+        if (settle && abs((int16_t) (value - previous)) <= ADC_BANDGAP_SETTLE_TOLERANCE) {
+            break;
+        }
+
+        previous = value;
+    }
+
+    for (i = 0; i < samples; i++) {
+        sum += convertSingle();
+    }
+
+    conversion_time += micros() - started;
+
+    return sum;
+}
+
+/**
+ * Sample a single pin at the full conversion rate for a period of time, handing
+ * every sample to a callback as soon as it is available. Samples aren't
+ * stored, so callers are expected to reduce them on the fly.
+ *
+ * @param uint8_t        pin         Analog pin.
+ * @param uint16_t       duration    Duration in milliseconds.
+ * @param uint16_t       max_samples Maximum amount of samples to take.
+ * @param SampleCallback callback    Function called for every sample.
+ * @param void*          context     Pointer passed to the callback.
+ *
+ * @return uint16_t Amount of samples taken
+ */
+uint16_t AdcManager::stream(uint8_t pin, uint16_t duration, uint16_t max_samples, SampleCallback callback, void* context)
+{
+    unsigned long started;
+    uint16_t samples = 0;
+    uint8_t settle = ADC_SETTLE_DISCARDS;
+
+    stop();
+
+    ADMUX = ADC_REFERENCE | (pin >= A0 ? pin - A0 : pin);
+    ADCSRB = 0; // Free running mode
+    ADCSRA = (1 << ADEN) | (1 << ADSC) | (1 << ADATE) | (1 << ADIF) | ADC_PRESCALER;
+
+    started = millis();
+
+    while (samples < max_samples && (millis() - started) < duration) {
+        // Poll instead of using the interrupt; nothing else needs the CPU
+        if (!(ADCSRA & (1 << ADIF))) {
+            continue;
+        }
+
+        // Writing a one clears the flag
+        ADCSRA |= (1 << ADIF);
+
+        if (settle) {
+            settle--;
+            continue;
+        }
+
+        callback(context, ADC);
+        samples++;
+    }
+
+    stop();
+
+    conversion_time += (millis() - started) * 1000;
+
+    return samples;
+}
+
+/**
+ * Handle a completed conversion. Called from the conversion complete
+ * interrupt.
+ *
+ * While free running, the next conversion has already started by the time
+ * this is called. The multiplexer is therefore switched as soon as the
+ * conversion in progress is the last one needed for the current channel, so
+ * only a single settling conversion is lost per channel.
+ *
+ * @return void
+ */
+void AdcManager::handleConversion()
+{
+    uint16_t value = ADC;
+    Channel* channel = &channels[current];
+
+    if (discards) {
+        discards--;
+    } else {
+        accumulator += value;
+        count++;
+    }
+
+    if (count >= channel->samples) {
+        channel->sum = accumulator;
+        channel->ready = true;
+
+        if (!sweeping) {
+            accumulator = 0;
+            count = 0;
+
+            return;
+        }
+
+        if (current + 1 >= channel_count) {
+            sweeping = false;
+
+            return;
+        }
+
+        // The multiplexer already points at the next channel
+        current++;
+        discards = ADC_SETTLE_DISCARDS;
+        accumulator = 0;
+        count = 0;
+        channel = &channels[current];
+    }
+
+    if (sweeping && (discards + channel->samples - count) == 1) {
+        if (current + 1 < channel_count) {
+            ADMUX = ADC_REFERENCE | channels[current + 1].mux;
+        } else {
+            // Let the conversion in progress be the last one
+            ADCSRA &= ~(1 << ADATE);
+        }
+    }
+}
+
+/**
+ * Return the channel index for a pin.
+ *
+ * @return uint8_t Channel index, or ADC_CHANNEL_NONE if not registered
+ */
+uint8_t AdcManager::findChannel(uint8_t pin)
+{
+    uint8_t i;
+    uint8_t mux = pin >= A0 ? pin - A0 : pin;
+
+    for (i = 0; i < channel_count; i++) {
+        if (channels[i].mux == mux) {
+            return i;
+        }
+    }
+
+    return ADC_CHANNEL_NONE;
+}
+
+/**
+ * Perform a single blocking conversion for a pin that has no result available.
+ *
+ * @return uint16_t
+ */
+uint16_t AdcManager::convert(uint8_t pin)
+{
+    uint32_t started;
+    uint16_t value;
+
+    stop();
+
+    ADCSRA = (1 << ADEN) | ADC_PRESCALER;
+
+    started = micros();
+    value = analogRead(pin);
+    conversion_time += micros() - started;
+
+    return value;
+}
+
+/**
+ * Perform a single blocking conversion of whatever the multiplexer points at.
+ *
+ * @return uint16_t
+ */
+uint16_t AdcManager::convertSingle()
+{
+    ADCSRA |= (1 << ADSC);
+
+    while (ADCSRA & (1 << ADSC));
+
+    return ADC;
+}
+
+/**
+ * Point the multiplexer at a channel and reset the accumulator.
+ *
+ * @return void
+ */
+void AdcManager::selectChannel(uint8_t index)
+{
+    current = index;
+    discards = ADC_SETTLE_DISCARDS;
+    accumulator = 0;
+    count = 0;
+
+    ADMUX = ADC_REFERENCE | channels[index].mux;
+}
+
+/**
+ * Sweep all channels with every conversion performed in ADC noise reduction
+ * sleep.
+ *
+ * @return void
+ */
+void AdcManager::sweepAsleep()
+{
+    uint8_t i;
+
+    stop();
+
+    ADCSRA = (1 << ADEN) | (1 << ADIE) | ADC_PRESCALER;
+    set_sleep_mode(SLEEP_MODE_ADC);
+
+    for (i = 0; i < channel_count; i++) {
+        selectChannel(i);
+
+        // Entering noise reduction sleep starts a conversion; any other
+        // interrupt waking us up early simply sends us back to sleep
+        while (!channels[i].ready) {
+            sleep_enable();
+            sei();
+            sleep_cpu();
+            sleep_disable();
+        }
+    }
+
+    ADCSRA &= ~(1 << ADIE);
+}
@@ -0,0 +1,82 @@
+#ifndef ADC_MANAGER_H
+#define ADC_MANAGER_H
+
+#include "ArduinoHeader.h"
+
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+
+#include "ConfigurationManager.h"
+#include "LogManager.h"
+
+#define ADC_AVAILABLE_CHANNELS 8
+#define ADC_CHANNEL_NONE 0xFF
+
+// Conversions to throw away after switching channels, to let the sample and
+// hold capacitor settle.
+#define ADC_SETTLE_DISCARDS 1
+
+#define ADC_MAX_OVERSAMPLING_BITS 4
+#define ADC_SWEEP_TIMEOUT 500
+
+// The internal 1.1V bandgap, as multiplexer channel. Its output takes a while
+// to charge the sample and hold capacitor after switching to it, so conversions
+// are thrown away until two in a row agree, up to a limit.
+#define ADC_BANDGAP_CHANNEL 0x0E
+#define ADC_BANDGAP_SETTLE_TOLERANCE 1
+#define ADC_BANDGAP_MAX_SETTLE_CONVERSIONS 32
+
+// AVcc reference, ADC clock at F_CPU / 128.
+#define ADC_REFERENCE (1 << REFS0)
+#define ADC_PRESCALER ((1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0))
+
+class AdcManager {
+    public:
+        typedef void (*SampleCallback)(void*, uint16_t);
+
+        static void initialize();
+        static void sweep();
+        static void stop();
+
+        static uint8_t registerChannel(uint8_t pin, uint16_t samples = 1);
+
+        static uint16_t read(uint8_t pin);
+        static uint32_t readSum(uint8_t pin);
+        static uint16_t getSampleCount(uint8_t pin);
+        static uint32_t takeConversionTime();
+
+        static uint32_t readBandgap(uint16_t samples);
+
+        static uint16_t stream(uint8_t pin, uint16_t duration, uint16_t max_samples, SampleCallback callback, void* context);
+
+        static void handleConversion();
+
+    private:
+        struct Channel {
+            uint8_t mux;
+            uint16_t samples;
+            volatile uint32_t sum;
+            volatile bool ready;
+        };
+
+        static Channel channels[ADC_AVAILABLE_CHANNELS];
+        static uint8_t channel_count;
+        static uint16_t default_samples;
+        static bool noise_reduction;
+        static uint32_t conversion_time;
+
+        static volatile bool sweeping;
+        static volatile uint8_t current;
+        static volatile uint8_t discards;
+        static volatile uint16_t count;
+        static volatile uint32_t accumulator;
+
+        static uint8_t findChannel(uint8_t pin);
+        static uint16_t convert(uint8_t pin);
+        static uint16_t convertSingle();
+        static void selectChannel(uint8_t index);
+        static void sweepAsleep();
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include "BatteryManager.h"
+
+// Discharge curves, in mV per cell at light loads.
+static const uint16_t curves[BATTERY_CHEMISTRIES][BATTERY_CURVE_POINTS] PROGMEM = {
+    {1000, 1100, 1160, 1200, 1230, 1260, 1290, 1320, 1360, 1420, 1550}, // alkaline
+    {1000, 1150, 1180, 1200, 1210, 1220, 1230, 1250, 1270, 1300, 1400}, // nimh
+    {3300, 3600, 3690, 3740, 3770, 3790, 3830, 3870, 3920, 3980, 4150}, // lithium-ion
+    {2800, 3000, 3150, 3200, 3220, 3250, 3270, 3290, 3310, 3330, 3400}  // lifepo4
+};
+
+// Supply voltage in mV, as of the last measurement.
+uint16_t BatteryManager::voltage = 0;
+
+// Battery level in %, as of the last measurement.
+uint8_t BatteryManager::level = 100;
+
+/**
+ * Measure the supply voltage and update the battery level. The supply voltage
+ * is derived from a measurement of the internal bandgap, using AVcc as
+ * reference.
+ *
+ * @return void
+ */
+void BatteryManager::measure()
+{
+    uint32_t bandgap;
+    uint32_t sum;
+
+    bandgap = ConfigurationManager::getInteger(CFG_BANDGAP_VOLTAGE);
+
+    if (!bandgap) {
+        bandgap = BATTERY_DEFAULT_BANDGAP_VOLTAGE;
+    }
+
+    sum = AdcManager::readBandgap(BATTERY_SAMPLES);
+
+    // A reading of the bandgap is bandgap * 1024 / vcc
+    voltage = sum ? (bandgap * 1024 * BATTERY_SAMPLES + (sum / 2)) / sum : 0;
+    level = calculateLevel(voltage);
+
+    LogManager::debug(LOG_PWR, F("bat: voltage=%dmV, level=%d%%"CR), voltage, level);
+}
+
+/**
+ * Return the supply voltage in mV, as of the last measurement.
+ *
+ * @return uint16_t
+ */
+uint16_t BatteryManager::getVoltage()
+{
+    return voltage;
+}
+
+/**
+ * Return the battery level in %, as of the last measurement.
+ *
+ * @return uint8_t
+ */
+uint8_t BatteryManager::getLevel()
+{
+    return level;
+}
+
+/**
+ * Map a supply voltage to a battery level, interpolating linearly between the
+ * points of the discharge curve of the configured chemistry.
+ *
+ * @param uint16_t voltage Supply voltage in mV.
+ *
+ * @return uint8_t Battery level in %
+ */
+uint8_t BatteryManager::calculateLevel(uint16_t voltage)
+{
+    uint8_t chemistry;
+    uint8_t cells;
+    uint16_t cell_voltage;
+    uint16_t lower;
+    uint16_t upper;
+    uint8_t i;
+
+    chemistry = ConfigurationManager::getInteger(CFG_BATTERY_CHEMISTRY);
+    cells = max(ConfigurationManager::getInteger(CFG_BATTERY_CELLS), 1);
+
+    if (chemistry == BATTERY_CHEMISTRY_NONE || chemistry > BATTERY_CHEMISTRIES) {
+        return 100;
+    }
+
+    cell_voltage = voltage / cells;
+    lower = pgm_read_word(&curves[chemistry - 1][0]);
+
+    if (cell_voltage <= lower) {
+        return 0;
+    }
+
+    for (i = 1; i < BATTERY_CURVE_POINTS; i++) {
+        upper = pgm_read_word(&curves[chemistry - 1][i]);
+
+        if (cell_voltage < upper) {
+            return ((i - 1) * 10) + (((uint32_t) (cell_voltage - lower) * 10) / (upper - lower));
+        }
+
+        lower = upper;
+    }
+
+    return 100;
+}
@@ -0,0 +1,43 @@
+#ifndef BATTERY_MANAGER_H
+#define BATTERY_MANAGER_H
+
+#include "ArduinoHeader.h"
+
+#include <avr/pgmspace.h>
+
+#include "ConfigurationManager.h"
+#include "LogManager.h"
+#include "AdcManager.h"
+
+// Samples of the bandgap accumulated per measurement.
+#define BATTERY_SAMPLES 16
+
+#define BATTERY_DEFAULT_BANDGAP_VOLTAGE 1100
+
+// Battery chemistries, selecting the discharge curve used to map a voltage to
+// a level. Without a chemistry, the node is assumed to run off mains power.
+#define BATTERY_CHEMISTRY_NONE 0
+#define BATTERY_CHEMISTRY_ALKALINE 1
+#define BATTERY_CHEMISTRY_NIMH 2
+#define BATTERY_CHEMISTRY_LITHIUM_ION 3
+#define BATTERY_CHEMISTRY_LIFEPO4 4
+#define BATTERY_CHEMISTRIES 4
+
+// Every curve holds the voltage of a single cell at 0%, 10%, ..., 100%.
+#define BATTERY_CURVE_POINTS 11
+
+class BatteryManager {
+    public:
+        static void measure();
+
+        static uint16_t getVoltage();
+        static uint8_t getLevel();
+
+    private:
+        static uint16_t voltage;
+        static uint8_t level;
+
+        static uint8_t calculateLevel(uint16_t voltage);
+};
+
+#endif
@@ -0,0 +1,52 @@
+#include "ClockManager.h"
+
+// Time spent asleep, during which millis() doesn't advance.
+uint32_t ClockManager::slept = 0;
+
+/**
+ * Return the time since boot in milliseconds, including time spent asleep.
+ * Wraps after about 49 days, so differences between timestamps should be
+ * used rather than the timestamps themselves.
+ *
+ * @return uint32_t
+ */
+uint32_t ClockManager::now()
+{
+    return millis() + slept;
+}
+
+/**
+ * Add time spent asleep to the clock.
+ *
+ * @param uint32_t duration Duration in milliseconds.
+ *
+ * @return void
+ */
+void ClockManager::addSleep(uint32_t duration)
+{
+    slept += duration;
+}
+
+/**
+ * Return the duration of the next chunk of sleep: the longest watchdog period
+ * that fits in the time left to sleep.
+ *
+ * @param uint32_t remaining Time left to sleep in milliseconds, or 0 to sleep
+ *                           until an interrupt.
+ *
+ * @return uint32_t
+ */
+uint32_t ClockManager::getSleepChunk(uint32_t remaining)
+{
+    uint32_t chunk = CLOCK_SLEEP_CHUNK;
+
+    if (!remaining) {
+        return chunk;
+    }
+
+    while (chunk > remaining && chunk > CLOCK_MIN_SLEEP_CHUNK) {
+        chunk >>= 1;
+    }
+
+    return min(chunk, remaining);
+}
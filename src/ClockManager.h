@@ -0,0 +1,26 @@
+#ifndef CLOCK_MANAGER_H
+#define CLOCK_MANAGER_H
+
+#include "ArduinoHeader.h"
+
+// Sleep is performed in chunks of a single watchdog period each, the longest
+// that fits, so the time slept is known within half a chunk when an interrupt
+// ends it early. Periods are halved from 8s down to about 16ms.
+#define CLOCK_SLEEP_CHUNK 8000
+#define CLOCK_MIN_SLEEP_CHUNK 16
+
+// Time it takes to wake up at the end of every chunk, in milliseconds, which
+// millis() doesn't see: about 16K cycles for the crystal oscillator to start.
+#define CLOCK_WAKE_TIME 1
+
+class ClockManager {
+    public:
+        static uint32_t now();
+        static void addSleep(uint32_t duration);
+        static uint32_t getSleepChunk(uint32_t remaining);
+
+    private:
+        static uint32_t slept;
+};
+
+#endif
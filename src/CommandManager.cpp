@@ -1,48 +1,237 @@
 #include "CommandManager.h"
 
+// Handler table in program memory, indexed by command.
+const CommandManager::Callback* CommandManager::handlers = NULL;
+
 // Handler count.
 uint8_t CommandManager::handler_count = 0;
 
-// Handler array.
-CommandManager::CommandHandler CommandManager::handlers[COMMAND_AVAILABLE_SLOTS] = {};
+/**
+ * Set the table of command handlers. The table lives in program memory and
+ * is indexed by command, with NULL for commands that aren't defined.
+ *
+ * @param const Callback* handlers Handler table, in program memory.
+ * @param uint8_t         count    Amount of entries in the table.
+ *
+ * @return void
+ */
+void CommandManager::setHandlers(const Callback* handlers, uint8_t count)
+{
+    CommandManager::handlers = handlers;
+    handler_count = count;
+}
 
 /**
- * Register a handler for a command.
+ * Handle a command.
  *
- * @param uint8_t  command  Short representing command
- * @param Callback callback Pointer to a function to execute as a callback upon
- *                          receiving the command
+ * @param uint8_t   command   Command to handle.
+ * @param char*     arguments Command arguments, separated by spaces.
+ * @param Response* response  Response to fill in.
+ *
+ * @return uint8_t Status, COMMAND_STATUS_UNKNOWN if there's no such command
  */
-void CommandManager::registerHandler(uint8_t command, Callback callback)
+uint8_t CommandManager::handleCommand(uint8_t command, char* arguments, Response* response)
 {
-    CommandHandler handler;
+    Callback callback;
 
-    handler.command = command;
-    handler.callback = callback;
+    response->size = 0;
 
-    handlers[handler_count] = handler;
-    handler_count++;
+    if (command >= handler_count) {
+        return COMMAND_STATUS_UNKNOWN;
+    }
+
+    callback = reinterpret_cast<Callback>(pgm_read_ptr(&handlers[command]));
+
+    if (callback == NULL) {
+        return COMMAND_STATUS_UNKNOWN;
+    }
+
+    return callback(arguments, response);
 }
 
 /**
- * Handle a command.
+ * Format the first of typed values as text.
  *
- * @param  uint8_t command   Short representing command to handle
- * @param  char*   arguments Character array representing command arguments
- * @return bool              Boolean indicating whether or not the command was
- *                           handled
+ * @param const uint8_t* data        Typed values.
+ * @param uint8_t        size        Size of the values.
+ * @param char*          buffer      Buffer to format into, left untouched if
+ *                                   the value can't be formatted.
+ * @param uint8_t        buffer_size Size of the buffer.
+ *
+ * @return uint8_t Size of the typed value, or 0 if it is malformed, is a
+ *                 string with spaces, or doesn't fit
  */
-bool CommandManager::handleCommand(uint8_t command, char* arguments)
+uint8_t CommandManager::formatValue(const uint8_t* data, uint8_t size, char* buffer, uint8_t buffer_size)
 {
-    uint8_t i;
+    char number[FIXED_POINT_MAX_SIZE];
+    const char* text;
+    uint8_t text_size;
+    uint8_t value_size;
+    uint8_t offset = 0;
+    uint8_t tag;
+    int32_t value;
+
+    if (!size) {
+        return 0;
+    }
+
+    tag = data[offset++];
 
-    for (i = 0; i < handler_count; i++) {
-        if (handlers[i].command == command) {
-            reinterpret_cast<void(*)(char*)>(handlers[i].callback)(arguments);
+    switch (tag) {
+        case COMMAND_VALUE_UINT8:
+            value_size = 1;
+            break;
 
-            return true;
+        case COMMAND_VALUE_UINT16:
+            value_size = 2;
+            break;
+
+        case COMMAND_VALUE_INT32:
+            value_size = 4;
+            break;
+
+        case COMMAND_VALUE_STRING:
+            if (offset == size) {
+                return 0;
+            }
+
+            value_size = data[offset++];
+            break;
+
+        default:
+            return 0;
+    }
+
+    if (value_size > size - offset) {
+        return 0;
+    }
+
+    if (tag == COMMAND_VALUE_STRING) {
+        text = reinterpret_cast<const char*>(data + offset);
+        text_size = value_size;
+
+        // Values are separated by spaces
+        if (memchr(text, ' ', text_size) != NULL || memchr(text, '\0', text_size) != NULL) {
+            return 0;
         }
+    } else {
+        // Values are little endian, as is the AVR, so narrower values just
+        // need zero extending
+        value = 0;
+        memcpy(&value, data + offset, value_size);
+
+        text = formatFixedPoint(number, value, 0);
+        text_size = strlen(text);
     }
 
-    return false;
+    if (text_size >= buffer_size) {
+        return 0;
+    }
+
+    memcpy(buffer, text, text_size);
+    buffer[text_size] = '\0';
+
+    return offset + value_size;
+}
+
+/**
+ * Format typed values as text, separated by spaces, and append them to the
+ * text in a buffer. Values that don't fit are left out.
+ *
+ * @param const uint8_t* data        Typed values.
+ * @param uint8_t        size        Size of the values.
+ * @param char*          buffer      Buffer holding the text to append to.
+ * @param uint8_t        buffer_size Size of the buffer.
+ *
+ * @return bool False if the values are malformed, hold a string with spaces,
+ *              or don't fit
+ */
+bool CommandManager::formatValues(const uint8_t* data, uint8_t size, char* buffer, uint8_t buffer_size)
+{
+    uint8_t offset = 0;
+    uint8_t value_size;
+    uint8_t used;
+    uint8_t separator;
+
+    used = strlen(buffer);
+
+    while (offset < size) {
+        separator = used > 0;
+
+        if (used + separator >= buffer_size) {
+            return false;
+        }
+
+        value_size = formatValue(data + offset, size - offset, buffer + used + separator, buffer_size - used - separator);
+
+        if (!value_size) {
+            return false;
+        }
+
+        if (separator) {
+            buffer[used++] = ' ';
+        }
+
+        used += strlen(buffer + used);
+        offset += value_size;
+    }
+
+    return true;
+}
+
+/**
+ * Add an integer to a response, using the narrowest type that holds it.
+ *
+ * @param int32_t value Value to add.
+ *
+ * @return bool False if the response is full
+ */
+bool CommandManager::Response::addInteger(int32_t value)
+{
+    uint8_t tag;
+    uint8_t value_size;
+
+    if (value >= 0 && value <= 0xFF) {
+        tag = COMMAND_VALUE_UINT8;
+        value_size = 1;
+    } else if (value >= 0 && value <= 0xFFFF) {
+        tag = COMMAND_VALUE_UINT16;
+        value_size = 2;
+    } else {
+        tag = COMMAND_VALUE_INT32;
+        value_size = 4;
+    }
+
+    if (this->size + 1 + value_size > COMMAND_RESPONSE_SIZE) {
+        return false;
+    }
+
+    this->data[this->size++] = tag;
+    memcpy(this->data + this->size, &value, value_size);
+    this->size += value_size;
+
+    return true;
+}
+
+/**
+ * Add a string to a response.
+ *
+ * @param const char* value Value to add.
+ *
+ * @return bool False if the response is full
+ */
+bool CommandManager::Response::addString(const char* value)
+{
+    uint8_t value_size = strlen(value);
+
+    if (this->size + 2 + value_size > COMMAND_RESPONSE_SIZE) {
+        return false;
+    }
+
+    this->data[this->size++] = COMMAND_VALUE_STRING;
+    this->data[this->size++] = value_size;
+    memcpy(this->data + this->size, value, value_size);
+    this->size += value_size;
+
+    return true;
 }
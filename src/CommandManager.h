@@ -3,23 +3,52 @@
 
 #include "ArduinoHeader.h"
 
-#define COMMAND_AVAILABLE_SLOTS 16
+#include <avr/pgmspace.h>
+
+#include "FixedPoint.h"
+
+#define COMMAND_STATUS_OK 0
+#define COMMAND_STATUS_UNKNOWN 1
+#define COMMAND_STATUS_INVALID_ARGUMENTS 2
+
+// Responses are a list of typed values: a tag, then the value, least
+// significant byte first. Strings are preceded by their length.
+#define COMMAND_VALUE_UINT8 1
+#define COMMAND_VALUE_UINT16 2
+#define COMMAND_VALUE_INT32 3
+#define COMMAND_VALUE_STRING 4
+
+#define COMMAND_RESPONSE_SIZE 60
+
+// Size of a single response value formatted as text: the widest integer, or
+// a configuration string.
+#define COMMAND_VALUE_TEXT_SIZE 13
+
+// Size of a line of text input a command is handled from, terminator
+// included. Longer lines are rejected.
+#define COMMAND_INPUT_SIZE 33
 
 class CommandManager {
     public:
-        typedef void (*Callback)(char*);
+        // Values a command answers with, whichever way it was given.
+        struct Response {
+            uint8_t size;
+            uint8_t data[COMMAND_RESPONSE_SIZE];
 
-        static void registerHandler(uint8_t, Callback);
-        static bool handleCommand(uint8_t, char*);
-
-    private:
-        struct CommandHandler {
-            uint8_t command;
-            Callback callback;
+            bool addInteger(int32_t value);
+            bool addString(const char* value);
         };
 
+        typedef uint8_t (*Callback)(char*, Response*);
+
+        static void setHandlers(const Callback* handlers, uint8_t count);
+        static uint8_t handleCommand(uint8_t command, char* arguments, Response* response);
+        static uint8_t formatValue(const uint8_t* data, uint8_t size, char* buffer, uint8_t buffer_size);
+        static bool formatValues(const uint8_t* data, uint8_t size, char* buffer, uint8_t buffer_size);
+
+    private:
+        static const Callback* handlers;
         static uint8_t handler_count;
-        static CommandHandler handlers[COMMAND_AVAILABLE_SLOTS];
 };
 
 #endif
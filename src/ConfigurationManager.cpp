@@ -7,7 +7,12 @@ int ConfigurationManager::configuration_address = 0;
 ConfigurationManager::Configuration ConfigurationManager::data = {
     KALMON_VERSION,
     {
-        true   // debug
+        true,  // debug
+        false, // adc noise reduction
+        false, // adaptive power
+        false, // fast wake
+        false, // sensor trace
+        false  // serial telemetry
     },
     {
         50,    // loop delay
@@ -17,7 +22,25 @@ ConfigurationManager::Configuration ConfigurationManager::data = {
         25,    // awake duration
         1800,  // sleep duration
         0,     // interrupt options
-        10     // default node address
+        10,    // default node address
+        2,     // adc oversampling
+        0,     // vibration features
+        0,     // accelerometer events
+        1,     // battery chemistry
+        2,     // battery cells
+        1100,  // bandgap voltage
+        60,    // minimum sleep duration
+        7200,  // maximum sleep duration
+        18000, // awake current
+        30,    // sleep current
+        18300, // conversion current
+        16300, // transmit current
+        2500,  // battery capacity
+        10,    // energy report interval
+        0,     // log levels
+        0,     // aggregation intervals
+        0,     // accelerometer int1 pin
+        0      // accelerometer int2 pin
     },
     {
 
@@ -46,14 +69,14 @@ void ConfigurationManager::load() {
     // Ensure the version string matches our version string; if it doesn't, we
     // should just use the default configuration
     EEPROM.readBlock(configuration_address, stored);
-    Log.Debug(F("cfg: found; v=%s"CR), stored);
+    LogManager::debug(LOG_CFG, F("cfg: found; v=%s"CR), stored);
 
     if (strcmp(stored, data.version) != 0) {
         return;
     }
 
     bytes = EEPROM.readBlock(configuration_address, data);
-    Log.Debug(F("cfg: loaded; v=%s, B=%d"CR), stored, bytes);
+    LogManager::debug(LOG_CFG, F("cfg: loaded; v=%s, B=%d"CR), stored, bytes);
 }
 
 /**
@@ -66,7 +89,7 @@ void ConfigurationManager::save() {
     uint8_t bytes;
 
     bytes = EEPROM.updateBlock(configuration_address, data);
-    Log.Debug(F("cfg: saved; v=%s, B=%d"CR), data.version, bytes);
+    LogManager::debug(LOG_CFG, F("cfg: saved; v=%s, B=%d"CR), data.version, bytes);
 }
 
 /**
@@ -118,11 +141,63 @@ void ConfigurationManager::setInteger(uint8_t key, uint16_t value) {
 }
 
 /**
- * Set the value for a key.
+ * Set the value for a key. Values that don't fit in a slot are rejected.
+ *
+ * @return bool False if the value is too long
+ */
+bool ConfigurationManager::setString(uint8_t key, char* value) {
+    if (strlen(value) >= CONFIG_STRINGS_MAX_SIZE) {
+        LogManager::error(LOG_CFG, F("cfg: value too long; max=%d"CR), CONFIG_STRINGS_MAX_SIZE - 1);
+        return false;
+    }
+
+    strncpy(data.strings[key - CONFIG_STRINGS_OFFSET], value, CONFIG_STRINGS_MAX_SIZE - 1);
+    data.strings[key - CONFIG_STRINGS_OFFSET][CONFIG_STRINGS_MAX_SIZE - 1] = '\0';
+    save();
+
+    return true;
+}
+
+/**
+ * Return the child sensor ID allocated to a key, allocating the first free ID
+ * if the key hasn't been seen before. Newly allocated IDs are persisted right
+ * away so they remain stable across reboots.
+ *
+ * @param uint8_t key Non-zero key identifying a module sensor.
+ *
+ * @return uint8_t Child sensor ID, or CONFIG_CHILD_ID_NONE if the table is full
+ */
+uint8_t ConfigurationManager::getChildId(uint8_t key) {
+    uint8_t i;
+    uint8_t free_id = CONFIG_CHILD_ID_NONE;
+
+    for (i = 0; i < CONFIG_CHILD_IDS_AVAILABLE_SLOTS; i++) {
+        if (data.child_ids[i] == key) {
+            return i;
+        }
+
+        if (!data.child_ids[i] && free_id == CONFIG_CHILD_ID_NONE) {
+            free_id = i;
+        }
+    }
+
+    if (free_id == CONFIG_CHILD_ID_NONE) {
+        LogManager::error(LOG_CFG, F("cfg: child ids exhausted; key=%d"CR), key);
+        return CONFIG_CHILD_ID_NONE;
+    }
+
+    data.child_ids[free_id] = key;
+    save();
+
+    return free_id;
+}
+
+/**
+ * Release all allocated child sensor IDs.
  *
  * @return void
  */
-void ConfigurationManager::setString(uint8_t key, char* value) {
-    strcpy(data.strings[key - CONFIG_STRINGS_OFFSET], value);
+void ConfigurationManager::clearChildIds() {
+    memset(data.child_ids, 0, sizeof(data.child_ids));
     save();
 }
@@ -5,7 +5,8 @@
 #include "KalmonVersion.h"
 
 #include <EEPROMex.h>
-#include <Logging.h>
+
+#include "LogManager.h"
 
 // Size of the configuration block memory pool.
 //#define CONFIG_MEMORY_SIZE 192
@@ -17,8 +18,13 @@
 #define CONFIG_BOOLEANS_AVAILABLE_SLOTS 8
 #define CONFIG_BOOLEANS_OFFSET 0
 #define CFG_DEBUG 0
+#define CFG_ADC_NOISE_REDUCTION 1
+#define CFG_POWER_ADAPTIVE 2
+#define CFG_POWER_FAST_WAKE 3
+#define CFG_SENSOR_TRACE 4
+#define CFG_SERIAL_TELEMETRY 5
 
-#define CONFIG_INTEGERS_AVAILABLE_SLOTS 16
+#define CONFIG_INTEGERS_AVAILABLE_SLOTS 48
 #define CONFIG_INTEGERS_OFFSET 8
 #define CFG_LOOP_DELAY 8
 #define CFG_SERIAL_BAUD_RATE 9
@@ -28,18 +34,57 @@
 #define CFG_POWER_SLEEP_DURATION 13
 #define CFG_POWER_INTERRUPT_OPTIONS 14
 #define CFG_NODE_ADDRESS 15
+#define CFG_ADC_OVERSAMPLING 16
+#define CFG_VIBRATION_FEATURES 17
+#define CFG_ACCELEROMETER_EVENTS 18
+#define CFG_BATTERY_CHEMISTRY 19
+#define CFG_BATTERY_CELLS 20
+#define CFG_BANDGAP_VOLTAGE 21
+#define CFG_POWER_MIN_SLEEP_DURATION 22
+#define CFG_POWER_MAX_SLEEP_DURATION 23
+#define CFG_POWER_AWAKE_CURRENT 24
+#define CFG_POWER_SLEEP_CURRENT 25
+#define CFG_POWER_CONVERSION_CURRENT 26
+#define CFG_POWER_TRANSMIT_CURRENT 27
+#define CFG_BATTERY_CAPACITY 28
+#define CFG_ENERGY_REPORT_INTERVAL 29
+#define CFG_LOG_LEVELS 30
+#define CFG_AGGREGATION_INTERVALS 31
+#define CFG_ACCELEROMETER_INT1_PIN 32
+#define CFG_ACCELEROMETER_INT2_PIN 33
+#define CFG_MODULE_1_FILTER 44
+#define CFG_MODULE_2_FILTER 45
+#define CFG_MODULE_3_FILTER 46
+#define CFG_MODULE_4_FILTER 47
+#define CFG_MODULE_5_FILTER 48
+#define CFG_MODULE_6_FILTER 49
+#define CFG_MODULE_7_FILTER 50
+#define CFG_MODULE_8_FILTER 51
+#define CFG_MODULE_9_FILTER 52
+#define CFG_MODULE_10_FILTER 53
+#define CFG_MODULE_11_FILTER 54
+#define CFG_MODULE_12_FILTER 55
 
-#define CONFIG_STRINGS_AVAILABLE_SLOTS 8
-#define CONFIG_STRINGS_OFFSET 24
+#define CONFIG_STRINGS_AVAILABLE_SLOTS 12
+#define CONFIG_STRINGS_OFFSET 56
 #define CONFIG_STRINGS_MAX_SIZE 12
-#define CFG_MODULE_1_CONFIGURATION 24
-#define CFG_MODULE_2_CONFIGURATION 25
-#define CFG_MODULE_3_CONFIGURATION 26
-#define CFG_MODULE_4_CONFIGURATION 27
-#define CFG_MODULE_5_CONFIGURATION 28
-#define CFG_MODULE_6_CONFIGURATION 29
-#define CFG_MODULE_7_CONFIGURATION 30
-#define CFG_MODULE_8_CONFIGURATION 31
+#define CFG_MODULE_1_CONFIGURATION 56
+#define CFG_MODULE_2_CONFIGURATION 57
+#define CFG_MODULE_3_CONFIGURATION 58
+#define CFG_MODULE_4_CONFIGURATION 59
+#define CFG_MODULE_5_CONFIGURATION 60
+#define CFG_MODULE_6_CONFIGURATION 61
+#define CFG_MODULE_7_CONFIGURATION 62
+#define CFG_MODULE_8_CONFIGURATION 63
+#define CFG_MODULE_9_CONFIGURATION 64
+#define CFG_MODULE_10_CONFIGURATION 65
+#define CFG_MODULE_11_CONFIGURATION 66
+#define CFG_MODULE_12_CONFIGURATION 67
+
+// Child sensor IDs are handed out densely from this table; a slot holds the
+// key of the module sensor it was allocated to, or 0 if it is still free.
+#define CONFIG_CHILD_IDS_AVAILABLE_SLOTS 32
+#define CONFIG_CHILD_ID_NONE 0xFF
 
 class ConfigurationManager {
     private:
@@ -51,6 +96,7 @@ class ConfigurationManager {
             bool booleans[CONFIG_BOOLEANS_AVAILABLE_SLOTS];
             uint16_t integers[CONFIG_INTEGERS_AVAILABLE_SLOTS];
             char strings[CONFIG_STRINGS_AVAILABLE_SLOTS][CONFIG_STRINGS_MAX_SIZE];
+            uint8_t child_ids[CONFIG_CHILD_IDS_AVAILABLE_SLOTS];
         };
 
     public:
@@ -67,7 +113,10 @@ class ConfigurationManager {
 
         static void setBoolean(uint8_t key, bool value);
         static void setInteger(uint8_t key, uint16_t value);
-        static void setString(uint8_t key, char* value);
+        static bool setString(uint8_t key, char* value);
+
+        static uint8_t getChildId(uint8_t key);
+        static void clearChildIds();
 };
 
 #endif
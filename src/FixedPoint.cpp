@@ -0,0 +1,123 @@
+#include "FixedPoint.h"
+
+/**
+ * Parse a decimal string into a fixed-point integer scaled by 10^decimals.
+ * Surplus decimal digits are truncated. Parsing stops at the first character
+ * that isn't part of the number.
+ *
+ * @param const char* string   String to parse, e.g. "2.5".
+ * @param uint8_t     decimals Amount of decimals to keep.
+ *
+ * @return int32_t Parsed value, e.g. 2500 for "2.5" with 3 decimals
+ */
+int32_t parseFixedPoint(const char* string, uint8_t decimals)
+{
+    int32_t value = 0;
+    bool negative = false;
+    bool fraction = false;
+
+    if (string == NULL) {
+        return 0;
+    }
+
+    if (*string == '-') {
+        negative = true;
+        string++;
+    }
+
+    for (; *string; string++) {
+        if (*string == '.' && !fraction) {
+            fraction = true;
+        } else if (*string >= '0' && *string <= '9') {
+            if (fraction && !decimals) {
+                continue;
+            }
+
+            value = (value * 10) + (*string - '0');
+
+            if (fraction) {
+                decimals--;
+            }
+        } else {
+            break;
+        }
+    }
+
+    for (; decimals > 0; decimals--) {
+        value *= 10;
+    }
+
+    return negative ? -value : value;
+}
+
+/**
+ * Format a fixed-point integer scaled by 10^decimals as a decimal string.
+ *
+ * @param char*   buffer   Buffer of at least FIXED_POINT_MAX_SIZE bytes.
+ * @param int32_t value    Value to format, e.g. 3274.
+ * @param uint8_t decimals Amount of decimals in the value, e.g. 3.
+ *
+ * @return char* The buffer, e.g. containing "3.274"
+ */
+char* formatFixedPoint(char* buffer, int32_t value, uint8_t decimals)
+{
+    char digits[FIXED_POINT_MAX_SIZE];
+    uint32_t magnitude;
+    uint8_t count = 0;
+    char* position = buffer;
+
+    magnitude = value < 0 ? -((uint32_t) value) : value;
+
+    // Collect digits least significant first, padding with zeroes so there is
+    // always at least one digit in front of the decimal point
+    do {
+        digits[count++] = '0' + (magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0 || count <= decimals);
+
+    if (value < 0) {
+        *position++ = '-';
+    }
+
+    while (count > 0) {
+        if (count == decimals) {
+            *position++ = '.';
+        }
+
+        *position++ = digits[--count];
+    }
+
+    *position = '\0';
+
+    return buffer;
+}
+
+/**
+ * Integer square root, rounded down.
+ *
+ * @param uint32_t value Value to take the square root of.
+ *
+ * @return uint16_t
+ */
+uint16_t sqrt32(uint32_t value)
+{
+    uint32_t result = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > value) {
+        bit >>= 2;
+    }
+
+    while (bit) {
+        if (value >= result + bit) {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+
+        bit >>= 2;
+    }
+
+    return result;
+}
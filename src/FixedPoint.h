@@ -0,0 +1,13 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include "ArduinoHeader.h"
+
+// Large enough for a signed 32-bit value, a decimal point and a terminator.
+#define FIXED_POINT_MAX_SIZE 13
+
+int32_t parseFixedPoint(const char* string, uint8_t decimals);
+char* formatFixedPoint(char* buffer, int32_t value, uint8_t decimals);
+uint16_t sqrt32(uint32_t value);
+
+#endif
@@ -0,0 +1,262 @@
+#include "FrameManager.h"
+
+// Encoded frame being received.
+uint8_t FrameManager::buffer[FRAME_BUFFER_SIZE] = {};
+uint8_t FrameManager::length = 0;
+
+// Time the last byte of a frame was received.
+uint32_t FrameManager::received = 0;
+
+// Whether a frame is being received, and whether it outgrew the buffer.
+bool FrameManager::receiving = false;
+bool FrameManager::overflow = false;
+
+// Sequence number of the next telemetry frame.
+uint8_t FrameManager::sequence = 0;
+
+/**
+ * Feed a byte of serial input to the frame receiver, handling the frame it
+ * completes, if any. A frame that went without a byte for longer than
+ * FRAME_TIMEOUT is dropped first.
+ *
+ * @param uint8_t ch Byte received.
+ *
+ * @return bool False if the byte isn't part of a frame, and should be handled
+ *              as text
+ */
+bool FrameManager::receive(uint8_t ch)
+{
+    uint32_t now;
+
+    if (!receiving) {
+        if (ch != FRAME_DELIMITER) {
+            return false;
+        }
+
+        receiving = true;
+        overflow = false;
+        length = 0;
+        received = millis();
+
+        return true;
+    }
+
+    now = millis();
+
+    if (now - received > FRAME_TIMEOUT) {
+        LogManager::error(LOG_CMD, F("frm: dropped; length=%d"CR), length);
+        receiving = false;
+
+        return receive(ch);
+    }
+
+    received = now;
+
+    if (ch != FRAME_DELIMITER) {
+        if (length < sizeof(buffer)) {
+            buffer[length++] = ch;
+        } else {
+            overflow = true;
+        }
+
+        return true;
+    }
+
+    // Back to back delimiters only start a frame
+    if (!length && !overflow) {
+        return true;
+    }
+
+    receiving = false;
+
+    if (overflow) {
+        LogManager::error(LOG_CMD, F("frm: frame too large"CR));
+    } else {
+        handleFrame();
+    }
+
+    return true;
+}
+
+/**
+ * Send a sensor value as a telemetry frame, if telemetry is enabled.
+ *
+ * @param uint8_t child_id   Child sensor ID.
+ * @param uint8_t value_type Type of the value.
+ * @param int32_t value      Value, scaled by 10^decimals.
+ * @param uint8_t decimals   Amount of decimals in the value.
+ *
+ * @return void
+ */
+void FrameManager::sendTelemetry(uint8_t child_id, uint8_t value_type, int32_t value, uint8_t decimals)
+{
+    uint8_t payload[FRAME_MAX_SIZE];
+
+    if (!ConfigurationManager::getBoolean(CFG_SERIAL_TELEMETRY)) {
+        return;
+    }
+
+    payload[0] = FRAME_TYPE_TELEMETRY;
+    payload[1] = sequence++;
+    payload[2] = child_id;
+    payload[3] = value_type;
+    payload[4] = decimals;
+    payload[5] = COMMAND_VALUE_INT32;
+    memcpy(payload + 6, &value, sizeof(value));
+
+    send(payload, 6 + sizeof(value));
+}
+
+/**
+ * Check and handle a received frame. Commands are answered with a response
+ * carrying the same sequence number, the status and the values the handler
+ * responded with; frames that don't check out are dropped.
+ *
+ * @return void
+ */
+void FrameManager::handleFrame()
+{
+    CommandManager::Response response;
+    char arguments[FRAME_ARGUMENTS_SIZE] = "";
+    uint8_t payload[FRAME_MAX_SIZE];
+    uint8_t size;
+
+    size = decode(buffer, length);
+
+    if (size < 3 + FRAME_CRC_SIZE || getCrc(buffer, size - FRAME_CRC_SIZE) != (buffer[size - 2] | (buffer[size - 1] << 8))) {
+        LogManager::error(LOG_CMD, F("frm: invalid frame; size=%d"CR), size);
+        return;
+    }
+
+    size -= FRAME_CRC_SIZE;
+
+    if (buffer[0] != FRAME_TYPE_COMMAND) {
+        return;
+    }
+
+    payload[0] = FRAME_TYPE_RESPONSE;
+    payload[1] = buffer[1];
+    payload[2] = buffer[2];
+
+    // Handlers take their arguments as text, as given over serial or radio
+    if (!CommandManager::formatValues(buffer + 3, size - 3, arguments, sizeof(arguments))) {
+        payload[3] = COMMAND_STATUS_INVALID_ARGUMENTS;
+        response.size = 0;
+    } else {
+        LogManager::debug(LOG_CMD, F("frm: \"%d\"; args: \"%s\""CR), buffer[2], arguments);
+
+        payload[3] = CommandManager::handleCommand(buffer[2], arguments, &response);
+    }
+
+    memcpy(payload + 4, response.data, response.size);
+    send(payload, 4 + response.size);
+}
+
+/**
+ * Append the CRC to a payload, and send it as a frame.
+ *
+ * @param uint8_t* payload Payload, with room for the CRC after it.
+ * @param uint8_t  size    Size of the payload.
+ *
+ * @return void
+ */
+void FrameManager::send(uint8_t* payload, uint8_t size)
+{
+    uint8_t frame[FRAME_BUFFER_SIZE + 2];
+    uint16_t crc;
+
+    crc = getCrc(payload, size);
+    payload[size++] = crc & 0xFF;
+    payload[size++] = crc >> 8;
+
+    frame[0] = FRAME_DELIMITER;
+    size = encode(payload, size, frame + 1) + 1;
+    frame[size++] = FRAME_DELIMITER;
+
+    Serial.write(frame, size);
+}
+
+/**
+ * COBS encode data: every zero byte is replaced by the distance to the next
+ * one, and a first such distance is put in front.
+ *
+ * @param const uint8_t* data   Data to encode, below 254 bytes.
+ * @param uint8_t        size   Size of the data.
+ * @param uint8_t*       output Buffer to encode into, a byte larger than the
+ *                              data.
+ *
+ * @return uint8_t Size of the encoded data
+ */
+uint8_t FrameManager::encode(const uint8_t* data, uint8_t size, uint8_t* output)
+{
+    uint8_t code_index = 0;
+    uint8_t written = 1;
+    uint8_t i;
+
+    for (i = 0; i < size; i++) {
+        if (data[i] == 0) {
+            output[code_index] = written - code_index;
+            code_index = written++;
+        } else {
+            output[written++] = data[i];
+        }
+    }
+
+    output[code_index] = written - code_index;
+
+    return written;
+}
+
+/**
+ * COBS decode data in place.
+ *
+ * @param uint8_t* data Data to decode.
+ * @param uint8_t  size Size of the data.
+ *
+ * @return uint8_t Size of the decoded data, or 0 if the data is malformed
+ */
+uint8_t FrameManager::decode(uint8_t* data, uint8_t size)
+{
+    uint8_t read = 0;
+    uint8_t written = 0;
+    uint8_t code;
+
+    while (read < size) {
+        code = data[read++];
+
+        if (!code || code - 1 > size - read) {
+            return 0;
+        }
+
+        memmove(data + written, data + read, code - 1);
+        read += code - 1;
+        written += code - 1;
+
+        // The last block isn't followed by a zero
+        if (read < size) {
+            data[written++] = 0;
+        }
+    }
+
+    return written;
+}
+
+/**
+ * Return the CRC of data.
+ *
+ * @param const uint8_t* data Data.
+ * @param uint8_t        size Size of the data.
+ *
+ * @return uint16_t
+ */
+uint16_t FrameManager::getCrc(const uint8_t* data, uint8_t size)
+{
+    uint16_t crc = FRAME_CRC_INITIAL;
+    uint8_t i;
+
+    for (i = 0; i < size; i++) {
+        crc = _crc_ccitt_update(crc, data[i]);
+    }
+
+    return crc;
+}
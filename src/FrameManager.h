@@ -0,0 +1,64 @@
+#ifndef FRAME_MANAGER_H
+#define FRAME_MANAGER_H
+
+#include "ArduinoHeader.h"
+
+#include <util/crc16.h>
+
+#include "ConfigurationManager.h"
+#include "LogManager.h"
+#include "CommandManager.h"
+#include "FixedPoint.h"
+
+// Binary frames share the serial port with text input and log output. A frame
+// is a payload followed by its CRC-CCITT (as computed by _crc_ccitt_update(),
+// starting from 0xFFFF, least significant byte first), COBS encoded so it
+// holds no zero bytes, and sent between two zero bytes. Text never contains a
+// zero byte, so the leading one switches the receiver over to frames until
+// the trailing one.
+#define FRAME_DELIMITER 0x00
+
+// Time in milliseconds a frame may go without a byte before it is dropped, so
+// a stray zero byte doesn't keep the receiver from taking text for long.
+#define FRAME_TIMEOUT 250
+#define FRAME_CRC_INITIAL 0xFFFF
+#define FRAME_CRC_SIZE 2
+
+// Size of a payload and its CRC. Must hold the largest response, and stay
+// below 254, so COBS adds a single byte of overhead.
+#define FRAME_MAX_SIZE (4 + COMMAND_RESPONSE_SIZE + FRAME_CRC_SIZE)
+#define FRAME_BUFFER_SIZE (FRAME_MAX_SIZE + 1)
+
+// Every payload starts with its type and a sequence number. Commands are
+// followed by the command and its arguments, responses by the command, a
+// status and values, telemetry by the child sensor ID, the value type, the
+// amount of decimals and the value. Arguments and values are typed as in
+// command responses.
+#define FRAME_TYPE_COMMAND 1
+#define FRAME_TYPE_RESPONSE 2
+#define FRAME_TYPE_TELEMETRY 3
+
+// Arguments are passed to command handlers as text, separated by spaces.
+#define FRAME_ARGUMENTS_SIZE 32
+
+class FrameManager {
+    public:
+        static bool receive(uint8_t ch);
+        static void sendTelemetry(uint8_t child_id, uint8_t value_type, int32_t value, uint8_t decimals);
+
+    private:
+        static uint8_t buffer[FRAME_BUFFER_SIZE];
+        static uint8_t length;
+        static uint32_t received;
+        static bool receiving;
+        static bool overflow;
+        static uint8_t sequence;
+
+        static void handleFrame();
+        static void send(uint8_t* payload, uint8_t size);
+        static uint8_t encode(const uint8_t* data, uint8_t size, uint8_t* output);
+        static uint8_t decode(uint8_t* data, uint8_t size);
+        static uint16_t getCrc(const uint8_t* data, uint8_t size);
+};
+
+#endif
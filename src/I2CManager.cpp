@@ -0,0 +1,366 @@
+#include "I2CManager.h"
+
+// Transactions waiting for the bus, as a ring buffer.
+I2CManager::Transaction* volatile I2CManager::queue[I2C_QUEUE_SIZE] = {};
+volatile uint8_t I2CManager::queue_head = 0;
+volatile uint8_t I2CManager::queue_count = 0;
+
+// Transaction state, shared with the TWI interrupt.
+I2CManager::Transaction* volatile I2CManager::active = NULL;
+volatile uint8_t I2CManager::index = 0;
+volatile bool I2CManager::reading = false;
+volatile uint32_t I2CManager::started = 0;
+
+/**
+ * TWI interrupt.
+ */
+ISR(TWI_vect)
+{
+    I2CManager::handleInterrupt();
+}
+
+/**
+ * Initialize the TWI hardware as bus master.
+ *
+ * @return void
+ */
+void I2CManager::initialize()
+{
+    // Enable the internal pull-ups; external ones are still recommended
+    digitalWrite(SDA, HIGH);
+    digitalWrite(SCL, HIGH);
+
+    TWSR = 0;
+    TWBR = ((F_CPU / I2C_FREQUENCY) - 16) / 2;
+    TWCR = _BV(TWEN);
+}
+
+/**
+ * Reset the bus if the active transaction has timed out.
+ *
+ * @return void
+ */
+void I2CManager::poll()
+{
+    uint32_t now = millis();
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        // A transaction started after taking the time shows up as negative
+        if (active == NULL || (int32_t) (now - started) <= (active->timeout ? active->timeout : I2C_DEFAULT_TIMEOUT)) {
+            return;
+        }
+
+        LogManager::error(LOG_MOD, F("i2c: timeout; address=%d"CR), active->address);
+
+        // Disabling the TWI releases the bus, whatever state it was in
+        TWCR = 0;
+        TWCR = _BV(TWEN);
+
+        if (complete(I2C_STATUS_TIMEOUT)) {
+            start(0);
+        }
+    }
+}
+
+/**
+ * Wait until every queued transaction has completed.
+ *
+ * @return void
+ */
+void I2CManager::flush()
+{
+    while (active != NULL || queue_count) {
+        poll();
+    }
+}
+
+/**
+ * Probe every address on the bus and log the devices that respond.
+ *
+ * @return uint8_t Amount of devices found
+ */
+uint8_t I2CManager::scan()
+{
+    Transaction transaction;
+    uint8_t address;
+    uint8_t found = 0;
+
+    for (address = I2C_SCAN_FIRST_ADDRESS; address <= I2C_SCAN_LAST_ADDRESS; address++) {
+        write(&transaction, address, NULL, 0);
+
+        if (wait(&transaction) == I2C_STATUS_OK) {
+            LogManager::info(LOG_MOD, F("i2c: found; address=%d"CR), address);
+            found++;
+        }
+    }
+
+    return found;
+}
+
+/**
+ * Queue a transaction, starting it right away if the bus is idle.
+ *
+ * @param Transaction* transaction Transaction to queue.
+ *
+ * @return bool False if the queue is full
+ */
+bool I2CManager::submit(Transaction* transaction)
+{
+    transaction->status = I2C_STATUS_PENDING;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (queue_count >= I2C_QUEUE_SIZE) {
+            transaction->status = I2C_STATUS_QUEUE_FULL;
+
+            return false;
+        }
+
+        queue[(queue_head + queue_count) % I2C_QUEUE_SIZE] = transaction;
+        queue_count++;
+
+        // While a transaction is active, the interrupt takes care of starting
+        // the next one
+        if (active == NULL) {
+            while (TWCR & _BV(TWSTO));
+
+            start(0);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Wait for a transaction to complete.
+ *
+ * @param Transaction* transaction Transaction to wait for.
+ *
+ * @return uint8_t Status of the transaction
+ */
+uint8_t I2CManager::wait(Transaction* transaction)
+{
+    while (transaction->status == I2C_STATUS_PENDING) {
+        poll();
+    }
+
+    return transaction->status;
+}
+
+/**
+ * Queue a write.
+ *
+ * @param Transaction*        transaction Transaction to use.
+ * @param uint8_t             address     Device address.
+ * @param const uint8_t*      data        Bytes to write, usually starting with
+ *                                        a register.
+ * @param uint8_t             length      Amount of bytes to write.
+ * @param TransactionCallback callback    Called from the interrupt once the
+ *                                        transaction completes.
+ * @param void*               context     Passed to the callback.
+ *
+ * @return bool False if the queue is full
+ */
+bool I2CManager::write(Transaction* transaction, uint8_t address, const uint8_t* data, uint8_t length, TransactionCallback callback, void* context)
+{
+    transaction->address = address;
+    transaction->write_buffer = data;
+    transaction->write_length = length;
+    transaction->read_buffer = NULL;
+    transaction->read_length = 0;
+    transaction->timeout = I2C_DEFAULT_TIMEOUT;
+    transaction->callback = callback;
+    transaction->context = context;
+
+    return submit(transaction);
+}
+
+/**
+ * Queue a burst read of consecutive registers.
+ *
+ * @param Transaction*        transaction Transaction to use.
+ * @param uint8_t             address     Device address.
+ * @param const uint8_t*      reg         First register to read.
+ * @param uint8_t*            buffer      Buffer receiving the registers.
+ * @param uint8_t             length      Amount of registers to read.
+ * @param TransactionCallback callback    Called from the interrupt once the
+ *                                        transaction completes.
+ * @param void*               context     Passed to the callback.
+ *
+ * @return bool False if the queue is full
+ */
+bool I2CManager::read(Transaction* transaction, uint8_t address, const uint8_t* reg, uint8_t* buffer, uint8_t length, TransactionCallback callback, void* context)
+{
+    transaction->address = address;
+    transaction->write_buffer = reg;
+    transaction->write_length = 1;
+    transaction->read_buffer = buffer;
+    transaction->read_length = length;
+    transaction->timeout = I2C_DEFAULT_TIMEOUT;
+    transaction->callback = callback;
+    transaction->context = context;
+
+    return submit(transaction);
+}
+
+/**
+ * Write a single register and wait for it.
+ *
+ * @return uint8_t Status of the transaction
+ */
+uint8_t I2CManager::writeRegister(uint8_t address, uint8_t reg, uint8_t value)
+{
+    Transaction transaction;
+    uint8_t data[2] = {reg, value};
+
+    write(&transaction, address, data, sizeof(data));
+
+    return wait(&transaction);
+}
+
+/**
+ * Read consecutive registers and wait for them.
+ *
+ * @return uint8_t Status of the transaction
+ */
+uint8_t I2CManager::readRegisters(uint8_t address, uint8_t reg, uint8_t* buffer, uint8_t length)
+{
+    Transaction transaction;
+
+    read(&transaction, address, &reg, buffer, length);
+
+    return wait(&transaction);
+}
+
+/**
+ * Advance the active transaction. Called from the TWI interrupt.
+ *
+ * @return void
+ */
+void I2CManager::handleInterrupt()
+{
+    Transaction* transaction = active;
+
+    if (transaction == NULL) {
+        TWCR = _BV(TWINT) | _BV(TWEN);
+
+        return;
+    }
+
+    switch (TW_STATUS) {
+        case TW_START:
+        case TW_REP_START:
+            // Reads start with writing the register, then switch to reading
+            // using a repeated start
+            if (!reading && (transaction->write_length || !transaction->read_length)) {
+                TWDR = (transaction->address << 1) | TW_WRITE;
+            } else {
+                reading = true;
+                TWDR = (transaction->address << 1) | TW_READ;
+            }
+
+            index = 0;
+            TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWIE);
+
+            break;
+        case TW_MT_SLA_ACK:
+        case TW_MT_DATA_ACK:
+            if (index < transaction->write_length) {
+                TWDR = transaction->write_buffer[index++];
+                TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWIE);
+            } else if (transaction->read_length) {
+                reading = true;
+                TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWIE) | _BV(TWSTA);
+            } else {
+                finish(I2C_STATUS_OK);
+            }
+
+            break;
+        case TW_MR_SLA_ACK:
+            // Acknowledge every byte but the last
+            TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWIE) | (transaction->read_length > 1 ? _BV(TWEA) : 0);
+
+            break;
+        case TW_MR_DATA_ACK:
+            transaction->read_buffer[index++] = TWDR;
+            TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWIE) | (index + 1 < transaction->read_length ? _BV(TWEA) : 0);
+
+            break;
+        case TW_MR_DATA_NACK:
+            transaction->read_buffer[index++] = TWDR;
+            finish(I2C_STATUS_OK);
+
+            break;
+        case TW_MT_SLA_NACK:
+        case TW_MT_DATA_NACK:
+        case TW_MR_SLA_NACK:
+            finish(I2C_STATUS_NACK);
+
+            break;
+        default:
+            // Lost arbitration or a bus error
+            finish(I2C_STATUS_ERROR);
+
+            break;
+    }
+}
+
+/**
+ * Start the next queued transaction.
+ *
+ * @param uint8_t control Additional TWCR bits, e.g. to issue a stop first.
+ *
+ * @return void
+ */
+void I2CManager::start(uint8_t control)
+{
+    active = queue[queue_head];
+    queue_head = (queue_head + 1) % I2C_QUEUE_SIZE;
+    queue_count--;
+
+    index = 0;
+    reading = false;
+    started = millis();
+
+    TWCR = control | _BV(TWINT) | _BV(TWEN) | _BV(TWIE) | _BV(TWSTA);
+}
+
+/**
+ * Complete the active transaction and release the bus, moving on to the next
+ * queued transaction if there is one.
+ *
+ * @param uint8_t status Status of the transaction.
+ *
+ * @return void
+ */
+void I2CManager::finish(uint8_t status)
+{
+    if (complete(status)) {
+        // Stop, then start again as soon as the bus is free
+        start(_BV(TWSTO));
+    } else {
+        TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWSTO);
+    }
+}
+
+/**
+ * Mark the active transaction as completed and run its callback. The
+ * callback may queue further transactions, which are run right after.
+ *
+ * @param uint8_t status Status of the transaction.
+ *
+ * @return bool True if another transaction is queued
+ */
+bool I2CManager::complete(uint8_t status)
+{
+    Transaction* transaction = active;
+
+    transaction->status = status;
+
+    if (transaction->callback != NULL) {
+        transaction->callback(transaction->context, transaction);
+    }
+
+    active = NULL;
+
+    return queue_count > 0;
+}
@@ -0,0 +1,81 @@
+#ifndef I2C_MANAGER_H
+#define I2C_MANAGER_H
+
+#include "ArduinoHeader.h"
+
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <util/twi.h>
+
+#include "LogManager.h"
+
+#define I2C_FREQUENCY 100000UL
+#define I2C_QUEUE_SIZE 8
+
+// Time in milliseconds a transaction may take before the bus is reset.
+#define I2C_DEFAULT_TIMEOUT 25
+
+// Range of addresses probed by a bus scan; the others are reserved.
+#define I2C_SCAN_FIRST_ADDRESS 0x08
+#define I2C_SCAN_LAST_ADDRESS 0x77
+
+#define I2C_STATUS_OK 0
+#define I2C_STATUS_PENDING 1
+#define I2C_STATUS_NACK 2
+#define I2C_STATUS_TIMEOUT 3
+#define I2C_STATUS_ERROR 4
+#define I2C_STATUS_QUEUE_FULL 5
+
+class I2CManager {
+    public:
+        struct Transaction;
+
+        typedef void (*TransactionCallback)(void*, Transaction*);
+
+        // A write, a burst read, or a write followed by a burst read using a
+        // repeated start. Buffers are owned by the caller and must stay valid
+        // until the transaction completes.
+        struct Transaction {
+            uint8_t address;
+            const uint8_t* write_buffer;
+            uint8_t write_length;
+            uint8_t* read_buffer;
+            uint8_t read_length;
+            uint8_t timeout;
+            volatile uint8_t status;
+            TransactionCallback callback;
+            void* context;
+        };
+
+        static void initialize();
+        static void poll();
+        static void flush();
+        static uint8_t scan();
+
+        static bool submit(Transaction* transaction);
+        static uint8_t wait(Transaction* transaction);
+
+        static bool write(Transaction* transaction, uint8_t address, const uint8_t* data, uint8_t length, TransactionCallback callback = NULL, void* context = NULL);
+        static bool read(Transaction* transaction, uint8_t address, const uint8_t* reg, uint8_t* buffer, uint8_t length, TransactionCallback callback = NULL, void* context = NULL);
+
+        static uint8_t writeRegister(uint8_t address, uint8_t reg, uint8_t value);
+        static uint8_t readRegisters(uint8_t address, uint8_t reg, uint8_t* buffer, uint8_t length);
+
+        static void handleInterrupt();
+
+    private:
+        static Transaction* volatile queue[I2C_QUEUE_SIZE];
+        static volatile uint8_t queue_head;
+        static volatile uint8_t queue_count;
+
+        static Transaction* volatile active;
+        static volatile uint8_t index;
+        static volatile bool reading;
+        static volatile uint32_t started;
+
+        static void start(uint8_t control);
+        static void finish(uint8_t status);
+        static bool complete(uint8_t status);
+};
+
+#endif
@@ -2,6 +2,6 @@
 #define KALMON_VERSION_H
 
 #define KALMON_NAME "Kalmon"
-#define KALMON_VERSION "001"
+#define KALMON_VERSION "002"
 
 #endif
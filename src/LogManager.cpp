@@ -0,0 +1,431 @@
+#include "LogManager.h"
+
+#include "ConfigurationManager.h"
+
+// Buffered records, as a ring starting at the head.
+uint8_t LogManager::buffer[LOG_BUFFER_SIZE] = {};
+uint8_t LogManager::head = 0;
+uint8_t LogManager::used = 0;
+
+// Lines dropped because the buffer was full, and how many of those were
+// reported.
+uint16_t LogManager::dropped = 0;
+uint16_t LogManager::reported = 0;
+
+/**
+ * Log an error.
+ *
+ * @param uint8_t                    subsystem Subsystem logging the line.
+ * @param const __FlashStringHelper* format    Format, in program memory.
+ *
+ * @return void
+ */
+void LogManager::error(uint8_t subsystem, const __FlashStringHelper* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    record(subsystem, LOG_LEVEL_ERRORS, format, args);
+    va_end(args);
+}
+
+/**
+ * Log information.
+ *
+ * @param uint8_t                    subsystem Subsystem logging the line.
+ * @param const __FlashStringHelper* format    Format, in program memory.
+ *
+ * @return void
+ */
+void LogManager::info(uint8_t subsystem, const __FlashStringHelper* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    record(subsystem, LOG_LEVEL_INFOS, format, args);
+    va_end(args);
+}
+
+/**
+ * Log debug output.
+ *
+ * @param uint8_t                    subsystem Subsystem logging the line.
+ * @param const __FlashStringHelper* format    Format, in program memory.
+ *
+ * @return void
+ */
+void LogManager::debug(uint8_t subsystem, const __FlashStringHelper* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    record(subsystem, LOG_LEVEL_DEBUG, format, args);
+    va_end(args);
+}
+
+/**
+ * Log verbose output.
+ *
+ * @param uint8_t                    subsystem Subsystem logging the line.
+ * @param const __FlashStringHelper* format    Format, in program memory.
+ *
+ * @return void
+ */
+void LogManager::verbose(uint8_t subsystem, const __FlashStringHelper* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    record(subsystem, LOG_LEVEL_VERBOSE, format, args);
+    va_end(args);
+}
+
+/**
+ * Write buffered lines for as long as the serial port can take them without
+ * waiting. Meant to be called when there's nothing else to do.
+ *
+ * @return void
+ */
+void LogManager::drain()
+{
+    while (used && write(false));
+
+    if (!used && dropped != reported) {
+        Log.Info(F("log: dropped; lines=%d"CR), dropped - reported);
+        reported = dropped;
+    }
+}
+
+/**
+ * Write all buffered lines, waiting for the serial port to take them. Meant
+ * to be called before sleeping or resetting.
+ *
+ * @return void
+ */
+void LogManager::flush()
+{
+    while (used) {
+        write(true);
+    }
+
+    drain();
+    Serial.flush();
+}
+
+/**
+ * Return the amount of lines dropped since boot because the buffer was full.
+ *
+ * @return uint16_t
+ */
+uint16_t LogManager::getDropped()
+{
+    return dropped;
+}
+
+/**
+ * Return the level of a subsystem.
+ *
+ * @param uint8_t subsystem Subsystem.
+ *
+ * @return uint8_t
+ */
+uint8_t LogManager::getLevel(uint8_t subsystem)
+{
+    uint8_t level;
+
+    level = (ConfigurationManager::getInteger(CFG_LOG_LEVELS) >> (subsystem * LOG_LEVEL_BITS)) & LOG_LEVEL_MASK;
+
+    if (!level) {
+        return ConfigurationManager::getBoolean(CFG_DEBUG) ? LOG_LEVEL_DEBUG : LOG_LEVEL_INFOS;
+    }
+
+    return level - 1;
+}
+
+/**
+ * Buffer a line as a record, if its subsystem's level lets it through. The
+ * line is dropped if the buffer is full. Strings that don't fit in a record
+ * are cut short, and arguments that don't fit at all are left out.
+ *
+ * @param uint8_t                    subsystem Subsystem logging the line.
+ * @param uint8_t                    level     Level of the line.
+ * @param const __FlashStringHelper* format    Format, in program memory.
+ * @param va_list                    args      Arguments.
+ *
+ * @return void
+ */
+void LogManager::record(uint8_t subsystem, uint8_t level, const __FlashStringHelper* format, va_list args)
+{
+    uint8_t record[LOG_RECORD_MAX_SIZE];
+    uint8_t size = 1 + sizeof(format);
+    uint8_t value_size;
+    const char* position;
+    const char* text;
+    int16_t value;
+    int32_t long_value;
+    uint8_t i;
+
+    if (level > getLevel(subsystem)) {
+        return;
+    }
+
+    memcpy(record + 1, &format, sizeof(format));
+
+    for (position = reinterpret_cast<const char*>(format); pgm_read_byte(position); position++) {
+        if (pgm_read_byte(position) != '%') {
+            continue;
+        }
+
+        switch (pgm_read_byte(++position)) {
+            case '\0':
+                position--;
+
+                break;
+            case 's':
+                text = va_arg(args, const char*);
+                value_size = min(strlen(text), (size_t) (sizeof(record) - size - 1));
+
+                memcpy(record + size, text, value_size);
+                size += value_size;
+                record[size++] = '\0';
+
+                break;
+            case 'l':
+                long_value = va_arg(args, int32_t);
+                memcpy(record + size, &long_value, sizeof(long_value));
+                size += sizeof(long_value);
+
+                break;
+            case 'c':
+            case 't':
+            case 'T':
+                record[size++] = va_arg(args, int);
+
+                break;
+            case 'd':
+            case 'x':
+            case 'X':
+            case 'b':
+            case 'B':
+                value = va_arg(args, int);
+                memcpy(record + size, &value, sizeof(value));
+                size += sizeof(value);
+
+                break;
+        }
+
+        // Leave room for the widest value, or a terminator
+        if (size > sizeof(record) - sizeof(long_value)) {
+            break;
+        }
+    }
+
+    if (size > LOG_BUFFER_SIZE - used) {
+        dropped++;
+        return;
+    }
+
+    record[0] = size;
+
+    for (i = 0; i < size; i++) {
+        buffer[(head + used + i) % LOG_BUFFER_SIZE] = record[i];
+    }
+
+    used += size;
+}
+
+/**
+ * Write the oldest buffered line.
+ *
+ * @param bool wait Whether to wait for the serial port to take the line.
+ *
+ * @return bool False if the serial port couldn't take the line without
+ *              waiting
+ */
+bool LogManager::write(bool wait)
+{
+    uint8_t record[LOG_RECORD_MAX_SIZE];
+    char line[LOG_LINE_SIZE];
+    uint8_t size;
+    uint8_t length;
+    uint8_t i;
+
+    size = buffer[head];
+
+    for (i = 0; i < size; i++) {
+        record[i] = buffer[(head + i) % LOG_BUFFER_SIZE];
+    }
+
+    length = format(record, size, line);
+
+    // Lines longer than the transmit buffer only go out once it's empty
+    if (!wait && Serial.availableForWrite() < min(length + 2, SERIAL_TX_BUFFER_SIZE - 1)) {
+        return false;
+    }
+
+    Log.Info(F("%s"CR), line);
+
+    head = (head + size) % LOG_BUFFER_SIZE;
+    used -= size;
+
+    return true;
+}
+
+/**
+ * Format a record as a line, without its line ending, using the format
+ * specifiers of the Logging library. Lines that don't fit are cut short.
+ *
+ * @param const uint8_t* record Record.
+ * @param uint8_t        size   Size of the record.
+ * @param char*          line   Buffer of LOG_LINE_SIZE to format into.
+ *
+ * @return uint8_t Length of the line
+ */
+uint8_t LogManager::format(const uint8_t* record, uint8_t size, char* line)
+{
+    const char* position;
+    const char* text;
+    uint8_t offset = 1 + sizeof(position);
+    uint8_t length = 0;
+    int16_t value;
+    int32_t long_value;
+    char ch;
+
+    memcpy(&position, record + 1, sizeof(position));
+
+    for (; (ch = pgm_read_byte(position)) && length < LOG_LINE_SIZE - 1; position++) {
+        if (ch != '%') {
+            if (ch != '\r' && ch != '\n') {
+                line[length++] = ch;
+            }
+
+            continue;
+        }
+
+        ch = pgm_read_byte(++position);
+
+        if (ch == '\0') {
+            break;
+        }
+
+        // Arguments left out of the record end the line
+        if (ch != '%' && offset >= size) {
+            break;
+        }
+
+        switch (ch) {
+            case '%':
+                line[length++] = '%';
+
+                break;
+            case 's':
+                text = reinterpret_cast<const char*>(record + offset);
+                offset += strlen(text) + 1;
+
+                while (*text && length < LOG_LINE_SIZE - 1) {
+                    line[length++] = *text++;
+                }
+
+                break;
+            case 'c':
+                line[length++] = record[offset++];
+
+                break;
+            case 't':
+                line[length++] = record[offset++] ? 'T' : 'F';
+
+                break;
+            case 'T':
+                text = record[offset++] ? "true" : "false";
+
+                while (*text && length < LOG_LINE_SIZE - 1) {
+                    line[length++] = *text++;
+                }
+
+                break;
+            case 'l':
+                memcpy(&long_value, record + offset, sizeof(long_value));
+                offset += sizeof(long_value);
+
+                if (long_value < 0) {
+                    line[length++] = '-';
+                }
+
+                length = formatNumber(line, length, long_value < 0 ? 0 - (uint32_t) long_value : long_value, 10);
+
+                break;
+            case 'd':
+            case 'x':
+            case 'X':
+            case 'b':
+            case 'B':
+                memcpy(&value, record + offset, sizeof(value));
+                offset += sizeof(value);
+
+                if (ch == 'd') {
+                    if (value < 0) {
+                        line[length++] = '-';
+                    }
+
+                    length = formatNumber(line, length, value < 0 ? 0 - (int32_t) value : value, 10);
+                } else if (ch == 'x' || ch == 'X') {
+                    if (ch == 'X' && length < LOG_LINE_SIZE - 3) {
+                        line[length++] = '0';
+                        line[length++] = 'x';
+                    }
+
+                    length = formatNumber(line, length, (uint16_t) value, 16);
+                } else {
+                    if (ch == 'B' && length < LOG_LINE_SIZE - 3) {
+                        line[length++] = '0';
+                        line[length++] = 'b';
+                    }
+
+                    length = formatNumber(line, length, (uint16_t) value, 2);
+                }
+
+                break;
+            default:
+                line[length++] = '%';
+
+                if (length < LOG_LINE_SIZE - 1) {
+                    line[length++] = ch;
+                }
+
+                break;
+        }
+    }
+
+    line[length] = '\0';
+
+    return length;
+}
+
+/**
+ * Append a number to a line, as far as it fits.
+ *
+ * @param char*    line   Line to append to.
+ * @param uint8_t  length Length of the line.
+ * @param uint32_t value  Number.
+ * @param uint8_t  base   Base to format the number in.
+ *
+ * @return uint8_t Length of the line
+ */
+uint8_t LogManager::formatNumber(char* line, uint8_t length, uint32_t value, uint8_t base)
+{
+    char digits[32];
+    uint8_t count = 0;
+    uint8_t digit;
+
+    do {
+        digit = value % base;
+        digits[count++] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+        value /= base;
+    } while (value);
+
+    while (count && length < LOG_LINE_SIZE - 1) {
+        line[length++] = digits[--count];
+    }
+
+    return length;
+}
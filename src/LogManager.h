@@ -0,0 +1,55 @@
+#ifndef LOG_MANAGER_H
+#define LOG_MANAGER_H
+
+#include "ArduinoHeader.h"
+
+#include <avr/pgmspace.h>
+#include <Logging.h>
+
+// Subsystems, each with its own level. Levels are taken from the LOG_LEVELS
+// configuration value, 3 bits per subsystem, lowest subsystem first: 0
+// follows the debug flag, anything else is a LOG_LEVEL_* value plus one.
+#define LOG_CFG 0
+#define LOG_MOD 1
+#define LOG_PWR 2
+#define LOG_CMD 3
+#define LOG_NET 4
+
+#define LOG_LEVEL_BITS 3
+#define LOG_LEVEL_MASK 0b111
+
+// Lines are buffered as records, which are only formatted and written once
+// there's time to spare. A record holds its size, the address of its format
+// in program memory and the raw arguments: 2 bytes for %d, %x, %X, %b and
+// %B, 4 bytes for %l, 1 byte for %c, %t and %T, and strings, which are
+// copied along with their terminator.
+#define LOG_BUFFER_SIZE 128
+#define LOG_RECORD_MAX_SIZE 64
+#define LOG_LINE_SIZE 96
+
+class LogManager {
+    public:
+        static void error(uint8_t subsystem, const __FlashStringHelper* format, ...);
+        static void info(uint8_t subsystem, const __FlashStringHelper* format, ...);
+        static void debug(uint8_t subsystem, const __FlashStringHelper* format, ...);
+        static void verbose(uint8_t subsystem, const __FlashStringHelper* format, ...);
+
+        static void drain();
+        static void flush();
+        static uint16_t getDropped();
+
+    private:
+        static uint8_t buffer[LOG_BUFFER_SIZE];
+        static uint8_t head;
+        static uint8_t used;
+        static uint16_t dropped;
+        static uint16_t reported;
+
+        static uint8_t getLevel(uint8_t subsystem);
+        static void record(uint8_t subsystem, uint8_t level, const __FlashStringHelper* format, va_list args);
+        static bool write(bool wait);
+        static uint8_t format(const uint8_t* record, uint8_t size, char* line);
+        static uint8_t formatNumber(char* line, uint8_t length, uint32_t value, uint8_t base);
+};
+
+#endif
@@ -1,22 +1,30 @@
 #include "ModuleManager.h"
 
-// Module count.
-uint8_t ModuleManager::module_count = 0;
-
 // Module array.
 ModuleManager::Module ModuleManager::modules[MODULE_AVAILABLE_SLOTS] = {};
 
+// Filter list.
+ModuleManager::FilterSlot* ModuleManager::filters = NULL;
+
+// Aggregate list.
+ModuleManager::AggregateSlot* ModuleManager::aggregates = NULL;
+
+// Last temperature reported by a temperature module.
+int8_t ModuleManager::ambient_temperature = HCSR04_TEMPERATURE_UNKNOWN;
+
 /**
  * Register a module.
  *
- * @param char* configuration Character array containing module
- *                            configuration.
+ * @param uint8_t slot          Configuration slot the module was loaded from.
+ *                              Used as the module index.
+ * @param char*   configuration Character array containing module
+ *                              configuration.
  *
  * @return void
  */
-void ModuleManager::registerModule(char* configuration)
+void ModuleManager::registerModule(uint8_t slot, char* configuration)
 {
-    Module module;
+    Module module = {};
     uint8_t type;
 
     char* string;
@@ -25,7 +33,7 @@ void ModuleManager::registerModule(char* configuration)
     to_free = string = strdup(configuration);
 
     // First parsed token is the type
-    type = strtol(strsep(&string, ","), NULL, 10);
+    type = parseToken(&string);
 
     if (type > 0) {
         module.type = type;
@@ -34,15 +42,15 @@ void ModuleManager::registerModule(char* configuration)
             #ifdef MODULE_TYPE_DHT11
             case MODULE_TYPE_DHT11:
                 {
-                    uint8_t pin = strtol(strsep(&string, ","), NULL, 10);
+                    uint8_t pin = parseToken(&string);
 
                     if (pin > 0) {
-                        Dht11 object = Dht11(pin);
+                        DHT11 object = DHT11(pin);
                         module.object = malloc(sizeof(object));
                         memcpy(module.object, &object, sizeof(object));
 
-                        presentSensor(module_count, 0, S_HUM);
-                        presentSensor(module_count, 1, S_TEMP);
+                        presentSensor(slot, 0, S_HUM);
+                        presentSensor(slot, 1, S_TEMP);
                     }
                 }
 
@@ -52,15 +60,16 @@ void ModuleManager::registerModule(char* configuration)
             #ifdef MODULE_TYPE_HCSR04
             case MODULE_TYPE_HCSR04:
                 {
-                    uint8_t trig_pin = strtol(strsep(&string, ","), NULL, 10);
-                    uint8_t echo_pin = strtol(strsep(&string, ","), NULL, 10);
+                    uint8_t trig_pin = parseToken(&string);
+                    uint8_t echo_pin = parseToken(&string);
+                    uint8_t pings = parseToken(&string);
 
                     if (trig_pin > 0 && echo_pin > 0) {
-                        HCSR04 object = HCSR04(trig_pin, echo_pin);
+                        HCSR04 object = HCSR04(trig_pin, echo_pin, pings);
                         module.object = malloc(sizeof(object));
                         memcpy(module.object, &object, sizeof(object));
 
-                        presentSensor(module_count, 0, S_DISTANCE);
+                        presentSensor(slot, 0, S_DISTANCE);
                     }
                 }
 
@@ -70,14 +79,18 @@ void ModuleManager::registerModule(char* configuration)
             #ifdef MODULE_TYPE_KY038
             case MODULE_TYPE_KY038:
                 {
-                    uint8_t pin = strtol(strsep(&string, ","), NULL, 10);
+                    uint8_t pin = parseToken(&string);
+                    uint16_t window = parseToken(&string);
+
+                    // Optionally report peak-to-peak and peak values as well
+                    module.options = parseToken(&string);
 
                     if (pin > 0) {
-                        KY038 object = KY038(pin);
+                        KY038 object = KY038(pin, window);
                         module.object = malloc(sizeof(object));
                         memcpy(module.object, &object, sizeof(object));
 
-                        presentSensor(module_count, 0, S_CUSTOM);
+                        presentSensor(slot, 0, S_CUSTOM);
                     }
                 }
 
@@ -87,14 +100,14 @@ void ModuleManager::registerModule(char* configuration)
             #ifdef MODULE_TYPE_MNEBPTCMN
             case MODULE_TYPE_MNEBPTCMN:
                 {
-                    uint8_t pin = strtol(strsep(&string, ","), NULL, 10);
+                    uint8_t pin = parseToken(&string);
 
                     if (pin > 0) {
                         MNEBPTCMN object = MNEBPTCMN(pin);
                         module.object = malloc(sizeof(object));
                         memcpy(module.object, &object, sizeof(object));
 
-                        presentSensor(module_count, 0, S_LIGHT_LEVEL);
+                        presentSensor(slot, 0, S_LIGHT_LEVEL);
                     }
                 }
 
@@ -109,60 +122,49 @@ void ModuleManager::registerModule(char* configuration)
 
                     // Load options
                     for (i = 0; i < sizeof(options); i++) {
-                        options[i] = strtol(strsep(&string, ","), NULL, 10);
+                        options[i] = parseToken(&string);
                     }
 
-                    ADXL345 object = ADXL345();
-
-                    if (!object.begin()) {
-                        Log.Error(F("Error loading ADXL345"CR));
-                    }
-
-                    // Configure power control mode
-                    // For link and auto-slide alongside measurements, use 0b00111000 / 0x38
-                    // writeRegister8(ADXL345_ADDRESS, ADXL345_REG_POWER_CTL, 0x00);
-                    writeRegister8(ADXL345_ADDRESS, ADXL345_REG_POWER_CTL, options[5] > 0 ? options[5] : 0x08); // Default to measurement mode
-                    writeRegister8(ADXL345_ADDRESS, ADXL345_REG_FIFO_CTL, /*0b10000000*/ 0x80); // Enable FIFO streaming mode
-                    // writeRegister8(ADXL345_ADDRESS, ADXL345_REG_POWER_CTL, /*0b00111000*/ 0x38);
-
-                    // Configure activity detection
-                    if (options[0] > 0) {
-                        object.setActivityXYZ(1);
-                        object.setActivityThreshold(((float) options[0]) / 10);
-                    }
+                    ADXL345Sensor object = ADXL345Sensor();
 
-                    // Configure inactivity detection
-                    if (options[1] > 0) {
-                        object.setInactivityXYZ(1);
-                        object.setInactivityThreshold(((float) options[1]) / 10);
+                    if (!object.begin(options[0], options[1], options[2], options[5], ConfigurationManager::getInteger(CFG_ACCELEROMETER_EVENTS))) {
+                        LogManager::error(LOG_MOD, F("Error loading ADXL345"CR));
                     }
 
-                    // Configure inactivity time
-                    object.setTimeInactivity(options[2] > 0 ? options[2] : 5);
-
-                    // Configure sensitivity
-                    object.setRange(/*options[3] > 0 ? options[3] :*/ ADXL345_RANGE_16G);
-
-                    // Configure data rate
-                    object.setDataRate(/*options[4] > 0 ? options[4] :*/ ADXL345_DATARATE_100HZ);
-
-                    // Set correct interrupt to use
-                    object.useInterrupt(ADXL345_INT1);
-
-                    // Only enable the activity and inactivity interrupts
-                    writeRegister8(ADXL345_ADDRESS, ADXL345_REG_INT_ENABLE, 0b00011000);
-
-                    // Map activity interrupt to int1, inactivity interrupt to int2
-                    writeRegister8(ADXL345_ADDRESS, ADXL345_REG_INT_MAP, 0b00001000);
+                    object.setInterruptPins(
+                        ConfigurationManager::getInteger(CFG_ACCELEROMETER_INT1_PIN),
+                        ConfigurationManager::getInteger(CFG_ACCELEROMETER_INT2_PIN)
+                    );
 
                     // Present accelerometer
-                    presentSensor(module_count, 0, CS_ACCELEROMETER);
+                    presentSensor(slot, ADXL345_SENSOR_ACCELEROMETER, CS_ACCELEROMETER);
 
                     // If activity or inactivity detection is enabled
-                    if (options[0] > 0 || options[1] > 0) {
+                    if (object.hasMotionDetection()) {
                         // If activity detection is enabled, present a motion sensor in addition
                         // to the accelerometer
-                        presentSensor(module_count, 1, S_MOTION);
+                        presentSensor(slot, ADXL345_SENSOR_MOTION, S_MOTION);
+                    }
+
+                    // If vibration features are enabled, present a vibration
+                    // sensor per axis
+                    if (ConfigurationManager::getInteger(CFG_VIBRATION_FEATURES)) {
+                        for (i = 0; i < 3; i++) {
+                            presentSensor(slot, ADXL345_SENSOR_VIBRATION_X + i, CS_VIBRATION);
+                        }
+                    }
+
+                    // Present a motion sensor per enabled tap or free-fall event
+                    if (object.isEventEnabled(ADXL345_INT_SINGLE_TAP)) {
+                        presentSensor(slot, ADXL345_SENSOR_EVENT_TAP, S_MOTION);
+                    }
+
+                    if (object.isEventEnabled(ADXL345_INT_DOUBLE_TAP)) {
+                        presentSensor(slot, ADXL345_SENSOR_EVENT_DOUBLE_TAP, S_MOTION);
+                    }
+
+                    if (object.isEventEnabled(ADXL345_INT_FREE_FALL)) {
+                        presentSensor(slot, ADXL345_SENSOR_EVENT_FREE_FALL, S_MOTION);
                     }
 
                     module.object = malloc(sizeof(object));
@@ -177,31 +179,33 @@ void ModuleManager::registerModule(char* configuration)
                 {
                     uint8_t pin;
                     uint8_t sample_count;
-                    float coefficient;
+                    int32_t coefficient;
 
-                    pin = strtol(strsep(&string, ","), NULL, 10);
+                    pin = parseToken(&string);
 
                     if (pin > 0) {
                         // Load options
-                        sample_count = strtol(strsep(&string, ","), NULL, 10);
+                        sample_count = parseToken(&string);
 
                         if (!sample_count) {
                             sample_count = 1;
                         }
 
                         // Load coefficient
-                        coefficient = strtod(strsep(&string, ","), NULL);
+                        coefficient = parseFixedPoint(strsep(&string, ","), GENERIC_VOLTAGE_COEFFICIENT_DECIMALS);
 
-                        if (!coefficient) {
-                            coefficient = 1.0;
+                        if (coefficient <= 0) {
+                            coefficient = GENERIC_VOLTAGE_COEFFICIENT_ONE;
                         }
 
+                        coefficient = min(coefficient, (int32_t) GENERIC_VOLTAGE_MAX_COEFFICIENT);
+
                         GenericVoltage object = GenericVoltage(pin, sample_count, coefficient);
 
                         module.object = malloc(sizeof(object));
                         memcpy(module.object, &object, sizeof(object));
 
-                        presentSensor(module_count, 0, S_POWER);
+                        presentSensor(slot, 0, S_POWER);
                     }
                 }
 
@@ -213,59 +217,166 @@ void ModuleManager::registerModule(char* configuration)
         }
 
         if (module.object != NULL) {
-            Log.Debug(F("mod: slot=%d, type=%d, configuration=%s"CR), module_count, module.type, configuration);
-            modules[module_count] = module;
-            module_count++;
+            LogManager::debug(LOG_MOD, F("mod: slot=%d, type=%d, configuration=%s"CR), slot, module.type, configuration);
+            modules[slot] = module;
         }
     }
 
-    // free(to_free);
+    free(to_free);
 }
 
 /**
- * Perform updates for modules.
+ * Parse the next comma separated token of a module configuration as an
+ * integer. Configurations written before a module gained a parameter leave
+ * it out, so a missing token counts as 0.
+ *
+ * @param char** string Configuration left to parse, moved past the token.
+ *
+ * @return int32_t
+ */
+int32_t ModuleManager::parseToken(char** string)
+{
+    char* token = strsep(string, ",");
+
+    return token != NULL ? strtol(token, NULL, 10) : 0;
+}
+
+/**
+ * Perform background work for modules between updates, such as draining
+ * sensor buffers before they overflow.
  *
  * @return void
  */
-void ModuleManager::updateModules()
+void ModuleManager::pollModules()
 {
     for (int i = 0; i < MODULE_AVAILABLE_SLOTS; i++) {
-        if (!modules[i].type) {
-            continue;
+        switch (modules[i].type) {
+            #ifdef MODULE_TYPE_DHT11
+            case MODULE_TYPE_DHT11:
+                {
+                    DHT11* object = reinterpret_cast<DHT11*>(modules[i].object);
+                    object->poll();
+
+                    // Submit the result of a measurement started by an update
+                    if (modules[i].pending && !object->isBusy()) {
+                        modules[i].pending = false;
+                        submitHumidityAndTemperature(i, object);
+                    }
+                }
+
+                break;
+            #endif
+
+            #ifdef MODULE_TYPE_HCSR04
+            case MODULE_TYPE_HCSR04:
+                {
+                    HCSR04* object = reinterpret_cast<HCSR04*>(modules[i].object);
+                    object->poll();
+
+                    // Submit the result of a reading started by an update
+                    if (modules[i].pending && !object->isBusy()) {
+                        modules[i].pending = false;
+                        submitDistance(i, object);
+                    }
+                }
+
+                break;
+            #endif
+
+            #ifdef MODULE_TYPE_ADXL345
+            case MODULE_TYPE_ADXL345:
+                {
+                    ADXL345Sensor* object = reinterpret_cast<ADXL345Sensor*>(modules[i].object);
+                    object->poll();
+
+                    submitAccelerometerEvents(i, object);
+                }
+
+                break;
+            #endif
         }
+    }
+}
 
+/**
+ * Complete background work that can't be left running while sleeping, such as
+ * a DHT11 measurement holding its data line low or an HCSR04 waiting for an
+ * echo, and stop listening to interrupts that shouldn't wake the node.
+ *
+ * @return void
+ */
+void ModuleManager::flushModules()
+{
+    for (int i = 0; i < MODULE_AVAILABLE_SLOTS; i++) {
         switch (modules[i].type) {
             #ifdef MODULE_TYPE_DHT11
             case MODULE_TYPE_DHT11:
                 {
-                    Dht11* object = reinterpret_cast<Dht11*>(modules[i].object);
-                    //object->read();
+                    DHT11* object = reinterpret_cast<DHT11*>(modules[i].object);
 
-                    switch (object->read()) {
-                        case Dht11::OK:
-                            Log.Debug(F("humidity: %d%%"CR), object->getHumidity());
-                            Log.Debug(F("temperature: %d°C"CR), object->getTemperature());
+                    while (object->isBusy()) {
+                        object->poll();
+                    }
+                }
+
+                break;
+            #endif
+
+            #ifdef MODULE_TYPE_HCSR04
+            case MODULE_TYPE_HCSR04:
+                {
+                    HCSR04* object = reinterpret_cast<HCSR04*>(modules[i].object);
 
-                            submitSensorValue(i, 0, V_HUM, object->getHumidity());
-                            submitSensorValue(i, 1, V_TEMP, object->getTemperature());
+                    while (object->isBusy()) {
+                        object->poll();
+                    }
+                }
 
-                            break;
+                break;
+            #endif
+        }
+    }
 
-                        case Dht11::ERROR_CHECKSUM:
-                            Log.Error(F("dht11: checksum error"CR));
-                            break;
+    pollModules();
 
-                        case Dht11::ERROR_TIMEOUT:
-                            Log.Error(F("dht11: timeout error"CR));
-                            break;
+    #ifdef MODULE_TYPE_ADXL345
+    // The next poll after waking up listens again
+    for (int i = 0; i < MODULE_AVAILABLE_SLOTS; i++) {
+        if (modules[i].type == MODULE_TYPE_ADXL345) {
+            reinterpret_cast<ADXL345Sensor*>(modules[i].object)->suspend();
+        }
+    }
+    #endif
+}
 
-                        default:
-                            Log.Error(F("dht11: unknown error"CR));
-                            break;
+/**
+ * Perform updates for modules.
+ *
+ * @return void
+ */
+void ModuleManager::updateModules()
+{
+    // Convert all analog channels in one go, so analog modules report values
+    // sampled at the same time
+    AdcManager::sweep();
 
-                        // default:
-                        //     Log.Error(F("dht11: error"CR));
-                        //     break;
+    for (int i = 0; i < MODULE_AVAILABLE_SLOTS; i++) {
+        if (!modules[i].type) {
+            continue;
+        }
+
+        switch (modules[i].type) {
+            #ifdef MODULE_TYPE_DHT11
+            case MODULE_TYPE_DHT11:
+                {
+                    DHT11* object = reinterpret_cast<DHT11*>(modules[i].object);
+
+                    // Measurements complete in the background; pollModules()
+                    // submits the result once it's in
+                    if (object->read() == DHT11_PENDING) {
+                        modules[i].pending = true;
+                    } else {
+                        submitHumidityAndTemperature(i, object);
                     }
                 }
 
@@ -276,11 +387,12 @@ void ModuleManager::updateModules()
             case MODULE_TYPE_HCSR04:
                 {
                     HCSR04* object = reinterpret_cast<HCSR04*>(modules[i].object);
-                    object->read();
-                    Log.Debug(F("duration: %lμs"CR), object->getDuration());
-                    Log.Debug(F("distance: %lcm"CR), object->getDistance());
+                    object->setTemperature(ambient_temperature);
 
-                    submitSensorValue(i, 0, V_DISTANCE, (uint16_t) object->getDistance());
+                    // Pings complete in the background; pollModules() submits
+                    // the median once all of them are in
+                    object->read();
+                    modules[i].pending = true;
                 }
 
                 break;
@@ -291,9 +403,14 @@ void ModuleManager::updateModules()
                 {
                     KY038* object = reinterpret_cast<KY038*>(modules[i].object);
                     object->read();
-                    Log.Debug(F("sound: %d"CR), object->getLevel());
+                    LogManager::debug(LOG_MOD, F("sound: rms=%d, p2p=%d, peak=%d"CR), object->getLevel(), object->getPeakToPeak(), object->getPeak());
 
-                    submitSensorValue(i, 0, V_VAR1, object->getLevel());
+                    reportValue(i, 0, V_VAR1, object->getLevel());
+
+                    if (modules[i].options) {
+                        reportValue(i, 0, V_VAR2, object->getPeakToPeak());
+                        reportValue(i, 0, V_VAR3, object->getPeak());
+                    }
                 }
 
                 break;
@@ -304,9 +421,9 @@ void ModuleManager::updateModules()
                 {
                     MNEBPTCMN* object = reinterpret_cast<MNEBPTCMN*>(modules[i].object);
                     object->read();
-                    Log.Debug(F("light: %d"CR), object->getLevel());
+                    LogManager::debug(LOG_MOD, F("light: %d"CR), object->getLevel());
 
-                    submitSensorValue(i, 0, V_LIGHT_LEVEL, object->getLevel());
+                    reportValue(i, 0, V_LIGHT_LEVEL, object->getLevel());
                 }
 
                 break;
@@ -315,41 +432,36 @@ void ModuleManager::updateModules()
             #ifdef MODULE_TYPE_ADXL345
             case MODULE_TYPE_ADXL345:
                 {
-                    ADXL345* object = reinterpret_cast<ADXL345*>(modules[i].object);
+                    ADXL345Sensor* object = reinterpret_cast<ADXL345Sensor*>(modules[i].object);
+                    object->read();
 
-                    Vector norm = object->readScaled();
-                    Activites activ = object->readActivites();
+                    // Events go out first, as they're the most time sensitive
+                    submitAccelerometerEvents(i, object);
 
-                    // If both activity and inactivity interrupts are detected,
-                    // keep reading until data stabilises
-                    while (activ.isActivity && activ.isInactivity) {
-                        norm = object->readScaled();
-                        activ = object->readActivites();
-                    }
+                    LogManager::debug(
+                        LOG_MOD, F("acceleration: x=%lmg, y=%lmg, z=%lmg, samples=%d"CR),
+                        object->getAcceleration(0),
+                        object->getAcceleration(1),
+                        object->getAcceleration(2),
+                        object->getSampleCount()
+                    );
 
-                    Log.Debug(F("acceleration: x=%d, y=%d, z=%d"CR), norm.XAxis, norm.YAxis, norm.ZAxis);
+                    if (object->getEvents() & ADXL345_INT_OVERRUN) {
+                        LogManager::debug(LOG_MOD, F("mod: adxl345 fifo overrun; slot=%d"CR), i);
+                    }
 
-                    submitSensorValue(i, 0, CV_ACCELERATION_X, norm.XAxis);
-                    submitSensorValue(i, 0, CV_ACCELERATION_Y, norm.YAxis);
-                    submitSensorValue(i, 0, CV_ACCELERATION_Z, norm.ZAxis);
+                    reportValue(i, ADXL345_SENSOR_ACCELEROMETER, CV_ACCELERATION_X, object->getAcceleration(0));
+                    reportValue(i, ADXL345_SENSOR_ACCELEROMETER, CV_ACCELERATION_Y, object->getAcceleration(1));
+                    reportValue(i, ADXL345_SENSOR_ACCELEROMETER, CV_ACCELERATION_Z, object->getAcceleration(2));
 
                     // If activity or inactivity detection is enabled, also submit motion sensor data
-                    if (object->getActivityX() || object->getInactivityX()) {
-
-                        Log.Debug(
-                            F("act: %t, in_act: %t, over: %t, mark: %t, fall: %t, dbl_tap: %t, tap: %t, rdy: %t"CR),
-                            activ.isActivity,
-                            activ.isInactivity,
-                            activ.isOverrun,
-                            activ.isWatermark,
-                            activ.isFreeFall,
-                            activ.isDoubleTap,
-                            activ.isTap,
-                            activ.isDataReady
-                        );
-
-                        submitSensorValue(i, 1, V_TRIPPED, activ.isActivity && !activ.isInactivity);
+                    if (object->hasMotionDetection()) {
+                        LogManager::debug(LOG_MOD, F("act: %t, events: %d"CR), object->isActive(), object->getEvents());
+
+                        reportValue(i, ADXL345_SENSOR_MOTION, V_TRIPPED, object->isActive());
                     }
+
+                    submitVibrationFeatures(i, object);
                 }
 
                 break;
@@ -360,9 +472,11 @@ void ModuleManager::updateModules()
                 {
                     GenericVoltage* object = reinterpret_cast<GenericVoltage*>(modules[i].object);
                     object->read();
-                    // Log.Debug(F("voltage: %d"CR), object->getLevel());
 
-                    submitSensorValue(i, 0, V_VOLTAGE, object->getLevel());
+                    int32_t level = object->getLevel();
+                    LogManager::debug(LOG_MOD, F("voltage: %lmV"CR), level);
+
+                    reportValue(i, 0, V_VOLTAGE, level);
                 }
 
                 break;
@@ -375,14 +489,402 @@ void ModuleManager::updateModules()
 }
 
 /**
- * Write a value to a register by register + address.
+ * Submit the result of the last measurement of a DHT11, sharing its
+ * temperature with modules that depend on it.
+ *
+ * @param uint8_t module_index Module index.
+ * @param DHT11*  object       Sensor to submit the result of.
+ *
+ * @return void
+ */
+void ModuleManager::submitHumidityAndTemperature(uint8_t module_index, DHT11* object)
+{
+    switch (object->getStatus()) {
+        case DHT11_OK:
+            LogManager::debug(LOG_MOD, F("humidity: %d%%"CR), object->getHumidity());
+            LogManager::debug(LOG_MOD, F("temperature: %d°C"CR), object->getTemperature());
+
+            ambient_temperature = object->getTemperature();
+
+            reportValue(module_index, 0, V_HUM, object->getHumidity());
+            reportValue(module_index, 1, V_TEMP, object->getTemperature());
+
+            break;
+
+        case DHT11_ERROR_CHECKSUM:
+            LogManager::error(LOG_MOD, F("dht11: checksum error"CR));
+            break;
+
+        case DHT11_ERROR_TIMEOUT:
+            LogManager::error(LOG_MOD, F("dht11: timeout error"CR));
+            break;
+
+        default:
+            LogManager::error(LOG_MOD, F("dht11: unknown error"CR));
+            break;
+    }
+}
+
+/**
+ * Submit the distance measured by the last reading of an HCSR04.
+ *
+ * @param uint8_t module_index Module index.
+ * @param HCSR04* object       Sensor to submit the result of.
+ *
+ * @return void
+ */
+void ModuleManager::submitDistance(uint8_t module_index, HCSR04* object)
+{
+    LogManager::debug(LOG_MOD, F("duration: %lμs"CR), object->getDuration());
+    LogManager::debug(LOG_MOD, F("distance: %lcm"CR), object->getDistance());
+
+    reportValue(module_index, 0, V_DISTANCE, object->getDistance());
+}
+
+/**
+ * Submit the tap and free-fall events an ADXL345 has seen since the previous
+ * call. Every event trips its motion sensor, which is released right after.
+ *
+ * @param uint8_t        module_index Module index.
+ * @param ADXL345Sensor* object       Accelerometer to submit events for.
+ *
+ * @return void
+ */
+void ModuleManager::submitAccelerometerEvents(uint8_t module_index, ADXL345Sensor* object)
+{
+    static const uint8_t sources[] = {ADXL345_INT_SINGLE_TAP, ADXL345_INT_DOUBLE_TAP, ADXL345_INT_FREE_FALL};
+    static const uint8_t sensors[] = {ADXL345_SENSOR_EVENT_TAP, ADXL345_SENSOR_EVENT_DOUBLE_TAP, ADXL345_SENSOR_EVENT_FREE_FALL};
+    uint8_t events;
+    uint8_t i;
+
+    events = object->takeEvents();
+
+    for (i = 0; i < sizeof(sources) && events; i++) {
+        if (!(events & sources[i])) {
+            continue;
+        }
+
+        LogManager::debug(LOG_MOD, F("mod: adxl345 event; slot=%d, source=%d"CR), module_index, sources[i]);
+
+        reportValue(module_index, sensors[i], V_TRIPPED, 1);
+        reportValue(module_index, sensors[i], V_TRIPPED, 0);
+    }
+}
+
+/**
+ * Extract vibration features from the sample window of an ADXL345 and report
+ * the enabled ones, using a vibration sensor per axis.
+ *
+ * @param uint8_t        module_index Module index.
+ * @param ADXL345Sensor* object       Accelerometer to analyze.
+ *
+ * @return void
+ */
+void ModuleManager::submitVibrationFeatures(uint8_t module_index, ADXL345Sensor* object)
+{
+    uint16_t enabled;
+    int16_t samples[VIBRATION_WINDOW_SIZE];
+    VibrationFeatures features;
+    uint8_t axis;
+    uint8_t band;
+
+    enabled = ConfigurationManager::getInteger(CFG_VIBRATION_FEATURES);
+
+    for (axis = 0; axis < 3 && enabled; axis++) {
+        if (!object->getWindow(axis, samples)) {
+            return;
+        }
+
+        features.analyze(samples, ADXL345_SAMPLE_RATE);
+
+        LogManager::debug(
+            LOG_MOD, F("vibration: axis=%d, rms=%d, peak=%d, crest=%d, zcr=%d"CR),
+            axis,
+            features.getRms(),
+            features.getPeak(),
+            features.getCrestFactor(),
+            features.getZeroCrossingRate()
+        );
+
+        if (enabled & VIBRATION_FEATURE_RMS) {
+            reportValue(module_index, ADXL345_SENSOR_VIBRATION_X + axis, CV_VIBRATION_RMS, (int32_t) features.getRms() * ADXL345_MG_PER_LSB);
+        }
+
+        if (enabled & VIBRATION_FEATURE_PEAK) {
+            reportValue(module_index, ADXL345_SENSOR_VIBRATION_X + axis, CV_VIBRATION_PEAK, (int32_t) features.getPeak() * ADXL345_MG_PER_LSB);
+        }
+
+        if (enabled & VIBRATION_FEATURE_CREST_FACTOR) {
+            reportValue(module_index, ADXL345_SENSOR_VIBRATION_X + axis, CV_VIBRATION_CREST_FACTOR, features.getCrestFactor());
+        }
+
+        if (enabled & VIBRATION_FEATURE_ZERO_CROSSING_RATE) {
+            reportValue(module_index, ADXL345_SENSOR_VIBRATION_X + axis, CV_VIBRATION_ZERO_CROSSING_RATE, features.getZeroCrossingRate());
+        }
+
+        if (enabled & VIBRATION_FEATURE_BANDS) {
+            for (band = 0; band < VIBRATION_BANDS; band++) {
+                reportValue(module_index, ADXL345_SENSOR_VIBRATION_X + axis, CV_VIBRATION_BAND_1 + band, (int32_t) features.getBand(band) * ADXL345_MG_PER_LSB);
+            }
+        }
+    }
+}
+
+/**
+ * Report a value read by a module's sensor: trace it, pass it through the
+ * module's filter where that applies, and submit it in the format of its
+ * type. Both sensor updates and trace replays go through here.
+ *
+ * @param uint8_t module_index Module index.
+ * @param uint8_t sensor_index Sensor index.
+ * @param uint8_t value_type   Type of the value.
+ * @param int32_t value        Value as read by the sensor.
+ *
+ * @return void
+ */
+void ModuleManager::reportValue(uint8_t module_index, uint8_t sensor_index, uint8_t value_type, int32_t value)
+{
+    TraceManager::record(module_index, sensor_index, value_type, value);
+
+    switch (value_type) {
+        // Motion and acceleration are submitted as read
+        case V_TRIPPED:
+        case CV_ACCELERATION_X:
+        case CV_ACCELERATION_Y:
+        case CV_ACCELERATION_Z:
+            submitValue(module_index, sensor_index, value_type, value);
+            return;
+    }
+
+    if (!filterValue(module_index, sensor_index, value_type, value)) {
+        return;
+    }
+
+    if (aggregateValue(module_index, sensor_index, value_type, value)) {
+        return;
+    }
+
+    submitValue(module_index, sensor_index, value_type, value);
+}
+
+/**
+ * Return the amount of decimals values of a type are scaled by.
+ *
+ * @param uint8_t value_type Type of the value.
+ *
+ * @return uint8_t
+ */
+uint8_t ModuleManager::getDecimals(uint8_t value_type)
+{
+    switch (value_type) {
+        case V_VOLTAGE:
+        case CV_ACCELERATION_X:
+        case CV_ACCELERATION_Y:
+        case CV_ACCELERATION_Z:
+        case CV_VIBRATION_RMS:
+        case CV_VIBRATION_PEAK:
+        case CV_VIBRATION_BAND_1:
+        case CV_VIBRATION_BAND_2:
+        case CV_VIBRATION_BAND_3:
+        case CV_VIBRATION_BAND_4:
+            return 3;
+
+        case CV_VIBRATION_CREST_FACTOR:
+            return VIBRATION_CREST_FACTOR_DECIMALS;
+
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Submit a value in the format of its type: as a fixed-point value if the
+ * type has decimals, and as a 16-bit integer otherwise, signed for humidity
+ * and temperature.
+ *
+ * @param uint8_t module_index Module index.
+ * @param uint8_t sensor_index Sensor index.
+ * @param uint8_t value_type   Type of the value.
+ * @param int32_t value        Value.
  *
  * @return void
  */
-void ModuleManager::writeRegister8(uint8_t address, uint8_t reg, uint8_t value)
+void ModuleManager::submitValue(uint8_t module_index, uint8_t sensor_index, uint8_t value_type, int32_t value)
+{
+    uint8_t decimals = getDecimals(value_type);
+
+    if (decimals) {
+        submitSensorValue(module_index, sensor_index, value_type, value, decimals);
+        return;
+    }
+
+    switch (value_type) {
+        case V_HUM:
+        case V_TEMP:
+            submitSensorValue(module_index, sensor_index, value_type, (int16_t) value);
+            break;
+
+        default:
+            submitSensorValue(module_index, sensor_index, value_type, (uint16_t) value);
+            break;
+    }
+}
+
+/**
+ * Pass a value read by a module through the filter configured for that module.
+ * Filter state is kept per reported value, allocated upon first use and reset
+ * when the filter options change.
+ *
+ * @param uint8_t  module_index Module index.
+ * @param uint8_t  sensor_index Sensor index.
+ * @param uint8_t  value_type   Type of the value.
+ * @param int32_t& value        Value to filter. Replaced by the filtered value.
+ *
+ * @return bool False if the value should not be submitted
+ */
+bool ModuleManager::filterValue(uint8_t module_index, uint8_t sensor_index, uint8_t value_type, int32_t& value)
 {
-    Wire.beginTransmission(address);
-    Wire.write(reg);
-    Wire.write(value);
-    Wire.endTransmission();
+    uint16_t options;
+    FilterSlot* slot;
+
+    options = ConfigurationManager::getInteger(CFG_MODULE_1_FILTER + module_index);
+
+    for (slot = filters; slot != NULL; slot = slot->next) {
+        if (slot->module_index == module_index && slot->sensor_index == sensor_index && slot->value_type == value_type) {
+            break;
+        }
+    }
+
+    if (!options) {
+        // Start over once the filter is enabled again
+        if (slot != NULL) {
+            slot->options = 0;
+        }
+
+        return true;
+    }
+
+    if (slot == NULL) {
+        slot = reinterpret_cast<FilterSlot*>(malloc(sizeof(FilterSlot)));
+
+        if (slot == NULL) {
+            LogManager::error(LOG_MOD, F("mod: filter allocation failed"CR));
+            return true;
+        }
+
+        slot->module_index = module_index;
+        slot->sensor_index = sensor_index;
+        slot->value_type = value_type;
+        slot->options = 0;
+        slot->next = filters;
+        filters = slot;
+    }
+
+    // Set up the filter again whenever its options change
+    if (slot->options != options) {
+        SensorFilter filter = SensorFilter(options);
+        memcpy(&slot->filter, &filter, sizeof(filter));
+
+        slot->options = options;
+    }
+
+    if (!slot->filter.apply(value)) {
+        LogManager::debug(LOG_MOD, F("mod: spike rejected; slot=%d, value=%l"CR), module_index, value);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Add a filtered value to the aggregate of the current window, if aggregation
+ * is enabled. Once the window is complete, its mean is submitted as the value
+ * itself, followed by summaries of its minimum, maximum and count on the same
+ * child sensor, which name the type of the value. Aggregate state is kept per
+ * reported value and allocated upon first use. Values of updates triggered by
+ * an interrupt are submitted as is, so they don't cut windows short.
+ *
+ * @param uint8_t module_index Module index.
+ * @param uint8_t sensor_index Sensor index.
+ * @param uint8_t value_type   Type of the value.
+ * @param int32_t value        Filtered value.
+ *
+ * @return bool False if the value should be submitted as is
+ */
+bool ModuleManager::aggregateValue(uint8_t module_index, uint8_t sensor_index, uint8_t value_type, int32_t value)
+{
+    uint8_t intervals;
+    AggregateSlot* slot;
+
+    intervals = min(ConfigurationManager::getInteger(CFG_AGGREGATION_INTERVALS), AGGREGATE_MAX_COUNT);
+
+    // Updates triggered by an interrupt come on top of the sampling
+    // intervals, so their values are submitted as they are
+    if (PowerManager::isInterrupt()) {
+        return false;
+    }
+
+    if (intervals < 2) {
+        // Drop windows left unfinished, so they don't carry over into the
+        // next window once aggregation is enabled again
+        while (aggregates != NULL) {
+            slot = aggregates->next;
+            free(aggregates);
+            aggregates = slot;
+        }
+
+        return false;
+    }
+
+    for (slot = aggregates; slot != NULL; slot = slot->next) {
+        if (slot->module_index == module_index && slot->sensor_index == sensor_index && slot->value_type == value_type) {
+            break;
+        }
+    }
+
+    if (slot == NULL) {
+        slot = reinterpret_cast<AggregateSlot*>(malloc(sizeof(AggregateSlot)));
+
+        if (slot == NULL) {
+            LogManager::error(LOG_MOD, F("mod: aggregate allocation failed"CR));
+            return false;
+        }
+
+        SensorAggregate aggregate = SensorAggregate();
+        memcpy(&slot->aggregate, &aggregate, sizeof(aggregate));
+
+        slot->module_index = module_index;
+        slot->sensor_index = sensor_index;
+        slot->value_type = value_type;
+        slot->next = aggregates;
+        aggregates = slot;
+    }
+
+    slot->aggregate.add(value);
+
+    // Values that aren't submitted still count as activity when they change
+    PowerManager::recordValue(getChildId(module_index, sensor_index), value_type, value);
+
+    if (slot->aggregate.getCount() < intervals) {
+        return true;
+    }
+
+    LogManager::debug(
+        LOG_MOD, F("mod: aggregate; slot=%d, type=%d, min=%l, max=%l, mean=%l, count=%d"CR),
+        module_index,
+        value_type,
+        slot->aggregate.getMinimum(),
+        slot->aggregate.getMaximum(),
+        slot->aggregate.getMean(),
+        slot->aggregate.getCount()
+    );
+
+    submitValue(module_index, sensor_index, value_type, slot->aggregate.getMean());
+    submitSensorSummary(module_index, sensor_index, CV_MINIMUM, value_type, slot->aggregate.getMinimum(), getDecimals(value_type));
+    submitSensorSummary(module_index, sensor_index, CV_MAXIMUM, value_type, slot->aggregate.getMaximum(), getDecimals(value_type));
+    submitSensorSummary(module_index, sensor_index, CV_SAMPLE_COUNT, value_type, slot->aggregate.getCount(), 0);
+
+    slot->aggregate.reset();
+
+    return true;
 }
@@ -3,19 +3,31 @@
 
 #include "ArduinoHeader.h"
 
-#include <Logging.h>
-#include <Dht11.h>
-#include <Wire.h>
-#include <ADXL345.h>
-
 #include "Network.h"
+#include "ConfigurationManager.h"
+#include "LogManager.h"
+#include "TraceManager.h"
+#include "Sensor/DHT11.h"
 #include "Sensor/HCSR04.h"
 #include "Sensor/KY038.h"
 #include "Sensor/MNEBPTCMN.h"
 #include "Sensor/GenericVoltage.h"
+#include "Sensor/ADXL345Sensor.h"
+#include "Sensor/VibrationFeatures.h"
+#include "Sensor/SensorFilter.h"
+#include "Sensor/SensorAggregate.h"
+
+#define MODULE_AVAILABLE_SLOTS CONFIG_STRINGS_AVAILABLE_SLOTS
+#define MODULE_SENSORS_PER_MODULE 8
 
-#define MODULE_AVAILABLE_SLOTS 8
-#define MODULE_SENSORS_PER_MODULE 5
+// Sensor indices of an ADXL345 module: the accelerometer, a motion sensor
+// for activity, a vibration sensor per axis and a motion sensor per event.
+#define ADXL345_SENSOR_ACCELEROMETER 0
+#define ADXL345_SENSOR_MOTION 1
+#define ADXL345_SENSOR_VIBRATION_X 2
+#define ADXL345_SENSOR_EVENT_TAP 5
+#define ADXL345_SENSOR_EVENT_DOUBLE_TAP 6
+#define ADXL345_SENSOR_EVENT_FREE_FALL 7
 
 #define MODULE_TYPE_DHT11 1
 #define MODULE_TYPE_HCSR04 2
@@ -27,18 +39,57 @@
 
 class ModuleManager {
     public:
-        static void registerModule(char*);
+        static void registerModule(uint8_t, char*);
+        static void pollModules();
+        static void flushModules();
         static void updateModules();
+        static void reportValue(uint8_t module_index, uint8_t sensor_index, uint8_t value_type, int32_t value);
 
     private:
+        // A registered module. Modules measuring in the background are
+        // pending from the update that started a measurement until its
+        // result is submitted.
         struct Module {
             uint8_t type;
+            uint8_t options;
+            bool pending;
             void* object;
         };
 
-        static uint8_t module_count;
+        // Filter state for a single value reported by a module's sensor,
+        // along with the options it was set up with.
+        struct FilterSlot {
+            uint8_t module_index;
+            uint8_t sensor_index;
+            uint8_t value_type;
+            uint16_t options;
+            FilterSlot* next;
+            SensorFilter filter;
+        };
+
+        // Aggregate of a single value reported by a module's sensor.
+        struct AggregateSlot {
+            uint8_t module_index;
+            uint8_t sensor_index;
+            uint8_t value_type;
+            AggregateSlot* next;
+            SensorAggregate aggregate;
+        };
+
         static Module modules[MODULE_AVAILABLE_SLOTS];
-        static void writeRegister8(uint8_t address, uint8_t reg, uint8_t value);
+        static FilterSlot* filters;
+        static AggregateSlot* aggregates;
+        static int8_t ambient_temperature;
+
+        static int32_t parseToken(char** string);
+        static void submitHumidityAndTemperature(uint8_t module_index, DHT11* object);
+        static void submitDistance(uint8_t module_index, HCSR04* object);
+        static void submitVibrationFeatures(uint8_t module_index, ADXL345Sensor* object);
+        static void submitAccelerometerEvents(uint8_t module_index, ADXL345Sensor* object);
+        static bool filterValue(uint8_t module_index, uint8_t sensor_index, uint8_t value_type, int32_t& value);
+        static bool aggregateValue(uint8_t module_index, uint8_t sensor_index, uint8_t value_type, int32_t value);
+        static uint8_t getDecimals(uint8_t value_type);
+        static void submitValue(uint8_t module_index, uint8_t sensor_index, uint8_t value_type, int32_t value);
 };
 
 #endif
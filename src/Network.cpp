@@ -1,5 +1,63 @@
 #include "Network.h"
 
+// Whether messages are sent back to back, with a single wait at the end.
+static bool batching = false;
+
+/**
+ * Send the shared message to the gateway, accounting the time spent
+ * transmitting, then give the gateway some time to process it.
+ *
+ * @return void
+ */
+static void sendMessage()
+{
+    uint32_t started = micros();
+
+    gateway.send(gatewayMessage, NETWORK_REQUEST_ACK);
+    PowerManager::recordTransmission(micros() - started);
+
+    gateway.wait(batching ? NETWORK_BATCH_MESSAGE_DELAY : NETWORK_SENSOR_VALUE_SUBMIT_DELAY);
+}
+
+/**
+ * Enable or disable batching. While batching, messages are sent back to back
+ * and only a short wait follows each one; flushMessages() should be called
+ * once a batch is complete.
+ *
+ * @param enabled Whether to batch messages.
+ *
+ * @return void
+ */
+void setMessageBatching(bool enabled)
+{
+    batching = enabled;
+}
+
+/**
+ * Wait for the gateway to process the messages sent so far, handling any
+ * incoming messages in the meantime.
+ *
+ * @return void
+ */
+void flushMessages()
+{
+    gateway.wait(batching ? NETWORK_BATCH_FLUSH_DELAY : NETWORK_DEFAULT_FLUSH_DELAY);
+}
+
+/**
+ * Return the child sensor ID for a module's sensor. IDs are allocated densely
+ * on first use and persisted along with the configuration.
+ *
+ * @param module_index Module index.
+ * @param sensor_index Sensor index.
+ *
+ * @return uint8_t Child sensor ID, or CONFIG_CHILD_ID_NONE if none is available
+ */
+uint8_t getChildId(uint8_t module_index, uint8_t sensor_index)
+{
+    return ConfigurationManager::getChildId(((module_index + 1) * MODULE_SENSORS_PER_MODULE) + sensor_index);
+}
+
 /**
  * Present a module's sensor to the gateway.
  *
@@ -11,7 +69,16 @@
  */
 void presentSensor(uint8_t module_index, uint8_t sensor_index, uint8_t sensor_type)
 {
-    gateway.present((module_index * MODULE_SENSORS_PER_MODULE) + sensor_index, sensor_type, NETWORK_REQUEST_ACK);
+    uint32_t started;
+    uint8_t child_id = getChildId(module_index, sensor_index);
+
+    if (child_id == CONFIG_CHILD_ID_NONE) {
+        return;
+    }
+
+    started = micros();
+    gateway.present(child_id, sensor_type, NETWORK_REQUEST_ACK);
+    PowerManager::recordTransmission(micros() - started);
     gateway.wait(NETWORK_SENSOR_PRESENT_DELAY);
 }
 
@@ -27,45 +94,176 @@ void presentSensor(uint8_t module_index, uint8_t sensor_index, uint8_t sensor_ty
  */
 void submitSensorValue(uint8_t module_index, uint8_t sensor_index, uint8_t sensor_value_type, int16_t sensor_value)
 {
+    uint8_t child_id = getChildId(module_index, sensor_index);
+
+    if (child_id == CONFIG_CHILD_ID_NONE) {
+        return;
+    }
+
+    PowerManager::recordValue(child_id, sensor_value_type, sensor_value);
+    FrameManager::sendTelemetry(child_id, sensor_value_type, sensor_value, 0);
+
     gatewayMessage
-        .setSensor((module_index * MODULE_SENSORS_PER_MODULE) + sensor_index)
+        .setSensor(child_id)
         .setType(sensor_value_type)
         .set(sensor_value);
 
-    gateway.send(gatewayMessage, NETWORK_REQUEST_ACK);
-    gateway.wait(NETWORK_SENSOR_VALUE_SUBMIT_DELAY);
+    sendMessage();
 }
 
 void submitSensorValue(uint8_t module_index, uint8_t sensor_index, uint8_t sensor_value_type, uint16_t sensor_value)
 {
+    uint8_t child_id = getChildId(module_index, sensor_index);
+
+    if (child_id == CONFIG_CHILD_ID_NONE) {
+        return;
+    }
+
+    PowerManager::recordValue(child_id, sensor_value_type, sensor_value);
+    FrameManager::sendTelemetry(child_id, sensor_value_type, sensor_value, 0);
+
     gatewayMessage
-        .setSensor((module_index * MODULE_SENSORS_PER_MODULE) + sensor_index)
+        .setSensor(child_id)
         .setType(sensor_value_type)
         .set(sensor_value);
 
-    gateway.send(gatewayMessage, NETWORK_REQUEST_ACK);
-    gateway.wait(NETWORK_SENSOR_VALUE_SUBMIT_DELAY);
+    sendMessage();
 }
 
-void submitSensorValue(uint8_t module_index, uint8_t sensor_index, uint8_t sensor_value_type, float sensor_value)
+/**
+ * Submit a fixed-point sensor value to the gateway. The value is sent as a
+ * decimal string, so no floating point formatting is required.
+ *
+ * @param module_index      Index of module the sensor belongs to. Starts at 0.
+ * @param sensor_index      Index of sensor within module to send value for. Starts at 0.
+ * @param sensor_value_type Type of the value sent to the gateway.
+ * @param sensor_value      Value sent to the gateway, scaled by 10^decimals.
+ * @param decimals          Amount of decimals in the value.
+ *
+ * @return void
+ */
+void submitSensorValue(uint8_t module_index, uint8_t sensor_index, uint8_t sensor_value_type, int32_t sensor_value, uint8_t decimals)
 {
+    char buffer[FIXED_POINT_MAX_SIZE];
+    uint8_t child_id = getChildId(module_index, sensor_index);
+
+    if (child_id == CONFIG_CHILD_ID_NONE) {
+        return;
+    }
+
+    PowerManager::recordValue(child_id, sensor_value_type, sensor_value);
+    FrameManager::sendTelemetry(child_id, sensor_value_type, sensor_value, decimals);
+
     gatewayMessage
-        .setSensor((module_index * MODULE_SENSORS_PER_MODULE) + sensor_index)
+        .setSensor(child_id)
         .setType(sensor_value_type)
-        .set(sensor_value, 5);
+        .set(formatFixedPoint(buffer, sensor_value, decimals));
 
-    gateway.send(gatewayMessage, NETWORK_REQUEST_ACK);
-    gateway.wait(NETWORK_SENSOR_VALUE_SUBMIT_DELAY);
+    sendMessage();
+}
+
+/**
+ * Submit a summary of a sensor's values to the gateway, such as their
+ * minimum. A sensor can report several types of values, so the summary is
+ * sent as text holding the type of the values it summarises, a space and the
+ * summary itself, e.g. "132 0.125".
+ *
+ * @param module_index Index of module the sensor belongs to. Starts at 0.
+ * @param sensor_index Index of sensor within module to send summary for. Starts at 0.
+ * @param summary_type Type of the summary sent to the gateway.
+ * @param value_type   Type of the values summarised.
+ * @param value        Summary, scaled by 10^decimals.
+ * @param decimals     Amount of decimals in the summary.
+ *
+ * @return void
+ */
+void submitSensorSummary(uint8_t module_index, uint8_t sensor_index, uint8_t summary_type, uint8_t value_type, int32_t value, uint8_t decimals)
+{
+    char buffer[4 + FIXED_POINT_MAX_SIZE];
+    uint8_t child_id = getChildId(module_index, sensor_index);
+
+    if (child_id == CONFIG_CHILD_ID_NONE) {
+        return;
+    }
+
+    formatFixedPoint(buffer, value_type, 0);
+    strcat(buffer, " ");
+    formatFixedPoint(buffer + strlen(buffer), value, decimals);
+
+    gatewayMessage
+        .setSensor(child_id)
+        .setType(summary_type)
+        .set(buffer);
+
+    sendMessage();
 }
 
 void sendCustomData(uint8_t sensor_id, uint8_t type, uint16_t value)
 {
+    FrameManager::sendTelemetry(sensor_id, type, value, 0);
+
     gatewayMessage
         .setSensor(sensor_id)
         .setType(type)
         .set(value);
 
-    gateway.send(gatewayMessage, NETWORK_REQUEST_ACK);
-    gateway.wait(NETWORK_SENSOR_VALUE_SUBMIT_DELAY);
-    // gateway.wait(NETWORK_DEFAULT_MESSAGE_DELAY);
+    sendMessage();
+}
+
+/**
+ * Send a fixed-point custom value to the gateway.
+ *
+ * @param sensor_id Child sensor ID.
+ * @param type      Type of the value.
+ * @param value     Value, scaled by 10^decimals.
+ * @param decimals  Amount of decimals in the value.
+ *
+ * @return void
+ */
+void sendCustomData(uint8_t sensor_id, uint8_t type, int32_t value, uint8_t decimals)
+{
+    char buffer[FIXED_POINT_MAX_SIZE];
+
+    FrameManager::sendTelemetry(sensor_id, type, value, decimals);
+
+    gatewayMessage
+        .setSensor(sensor_id)
+        .setType(type)
+        .set(formatFixedPoint(buffer, value, decimals));
+
+    sendMessage();
+}
+
+/**
+ * Send a text custom value to the gateway.
+ *
+ * @param sensor_id Child sensor ID.
+ * @param type      Type of the value.
+ * @param value     Value, at most MAX_PAYLOAD characters.
+ *
+ * @return void
+ */
+void sendCustomData(uint8_t sensor_id, uint8_t type, const char* value)
+{
+    gatewayMessage
+        .setSensor(sensor_id)
+        .setType(type)
+        .set(value);
+
+    sendMessage();
+}
+
+/**
+ * Send the battery level to the gateway.
+ *
+ * @param level Battery level in %.
+ *
+ * @return void
+ */
+void sendBatteryLevel(uint8_t level)
+{
+    uint32_t started = micros();
+
+    gateway.sendBatteryLevel(level, NETWORK_REQUEST_ACK);
+    PowerManager::recordTransmission(micros() - started);
 }
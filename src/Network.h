@@ -5,19 +5,50 @@
 #define NETWORK_DEFAULT_MESSAGE_DELAY 250
 #define NETWORK_SENSOR_PRESENT_DELAY 500
 #define NETWORK_SENSOR_VALUE_SUBMIT_DELAY NETWORK_SENSOR_PRESENT_DELAY
+#define NETWORK_DEFAULT_FLUSH_DELAY 200
+
+// Delays while batching messages, e.g. during a fast wake.
+#define NETWORK_BATCH_MESSAGE_DELAY 5
+#define NETWORK_BATCH_FLUSH_DELAY 50
 
 #include <MySensor.h>
 
 // Custom sensor types
 #define CS_ACCELEROMETER 128
+#define CS_VIBRATION 129
 
 // Custom value types
 #define CV_AVAILABLE_MEMORY 128
 #define CV_ACCELERATION_X 129
 #define CV_ACCELERATION_Y 130
 #define CV_ACCELERATION_Z 131
+#define CV_VIBRATION_RMS 132
+#define CV_VIBRATION_PEAK 133
+#define CV_VIBRATION_CREST_FACTOR 134
+#define CV_VIBRATION_ZERO_CROSSING_RATE 135
+#define CV_VIBRATION_BAND_1 136
+#define CV_VIBRATION_BAND_2 137
+#define CV_VIBRATION_BAND_3 138
+#define CV_VIBRATION_BAND_4 139
+#define CV_BATTERY_VOLTAGE 140
+#define CV_SLEEP_DURATION 141
+#define CV_AWAKE_TIME 142
+#define CV_SLEEP_TIME 143
+#define CV_CONVERSION_TIME 144
+#define CV_TRANSMIT_TIME 145
+#define CV_CHARGE_CONSUMED 146
+#define CV_PROJECTED_LIFETIME 147
+#define CV_COMMAND 148
+#define CV_COMMAND_RESPONSE 149
+#define CV_MINIMUM 150
+#define CV_MAXIMUM 151
+#define CV_SAMPLE_COUNT 152
 
 #include "ModuleManager.h"
+#include "ConfigurationManager.h"
+#include "FixedPoint.h"
+#include "PowerManager.h"
+#include "FrameManager.h"
 
 #ifdef MAIN
 #define EXTERN
@@ -28,11 +59,18 @@
 EXTERN MySensor gateway;
 EXTERN MyMessage gatewayMessage;
 
+uint8_t getChildId(uint8_t module_index, uint8_t sensor_index);
 void presentSensor(uint8_t module_index, uint8_t sensor_index, uint8_t sensor_type);
-void sendCustomData(uint8_t sensor_id = NODE_SENSOR_ID, uint8_t type = V_VAR1, uint16_t value = NULL);
+void sendCustomData(uint8_t sensor_id = NODE_SENSOR_ID, uint8_t type = V_VAR1, uint16_t value = 0);
+void sendCustomData(uint8_t sensor_id, uint8_t type, int32_t value, uint8_t decimals);
+void sendCustomData(uint8_t sensor_id, uint8_t type, const char* value);
+void sendBatteryLevel(uint8_t level);
+void setMessageBatching(bool enabled);
+void flushMessages();
 
 void submitSensorValue(uint8_t module_index, uint8_t sensor_index, uint8_t value_type, uint16_t value);
 void submitSensorValue(uint8_t module_index, uint8_t sensor_index, uint8_t value_type, int16_t value);
-void submitSensorValue(uint8_t module_index, uint8_t sensor_index, uint8_t value_type, float value);
+void submitSensorValue(uint8_t module_index, uint8_t sensor_index, uint8_t value_type, int32_t value, uint8_t decimals);
+void submitSensorSummary(uint8_t module_index, uint8_t sensor_index, uint8_t summary_type, uint8_t value_type, int32_t value, uint8_t decimals);
 
 #endif
@@ -0,0 +1,141 @@
+#include "PinChangeManager.h"
+
+// Handler array.
+PinChangeManager::Handler PinChangeManager::handlers[PIN_CHANGE_AVAILABLE_SLOTS] = {};
+
+// Last known input state per port, used to tell which pins changed.
+volatile uint8_t PinChangeManager::states[PIN_CHANGE_PORTS] = {};
+
+/**
+ * Pin change interrupts, one per port.
+ */
+ISR(PCINT0_vect)
+{
+    PinChangeManager::handleChange(0);
+}
+
+ISR(PCINT1_vect)
+{
+    PinChangeManager::handleChange(1);
+}
+
+ISR(PCINT2_vect)
+{
+    PinChangeManager::handleChange(2);
+}
+
+/**
+ * Attach a callback to changes of a pin's level. The callback is executed from
+ * the interrupt, so it should be kept short.
+ *
+ * @param uint8_t  pin      Digital pin.
+ * @param Callback callback Function called with the context and new level.
+ * @param void*    context  Pointer passed to the callback.
+ *
+ * @return bool False if the pin doesn't support pin change interrupts, or no
+ *              slots are left
+ */
+bool PinChangeManager::attach(uint8_t pin, Callback callback, void* context)
+{
+    uint8_t i;
+    Handler* handler = NULL;
+
+    if (digitalPinToPCICR(pin) == NULL) {
+        return false;
+    }
+
+    // Replace the pin's own handler if it has one, so a pin never ends up
+    // with two, and take a free slot otherwise
+    for (i = 0; i < PIN_CHANGE_AVAILABLE_SLOTS && handler == NULL; i++) {
+        if (handlers[i].callback != NULL && handlers[i].pin == pin) {
+            handler = &handlers[i];
+        }
+    }
+
+    for (i = 0; i < PIN_CHANGE_AVAILABLE_SLOTS && handler == NULL; i++) {
+        if (handlers[i].callback == NULL) {
+            handler = &handlers[i];
+        }
+    }
+
+    if (handler == NULL) {
+        return false;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        handler->pin = pin;
+        handler->port = digitalPinToPCICRbit(pin);
+        handler->mask = digitalPinToBitMask(pin);
+        handler->input = portInputRegister(digitalPinToPort(pin));
+        handler->callback = callback;
+        handler->context = context;
+
+        states[handler->port] = *handler->input;
+
+        *digitalPinToPCMSK(pin) |= (1 << digitalPinToPCMSKbit(pin));
+        *digitalPinToPCICR(pin) |= (1 << digitalPinToPCICRbit(pin));
+    }
+
+    return true;
+}
+
+/**
+ * Detach the callback from a pin.
+ *
+ * @return void
+ */
+void PinChangeManager::detach(uint8_t pin)
+{
+    uint8_t i;
+
+    if (digitalPinToPCICR(pin) == NULL) {
+        return;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        *digitalPinToPCMSK(pin) &= ~(1 << digitalPinToPCMSKbit(pin));
+
+        // Disable the port's interrupt altogether if no pins are left on it
+        if (!*digitalPinToPCMSK(pin)) {
+            *digitalPinToPCICR(pin) &= ~(1 << digitalPinToPCICRbit(pin));
+        }
+
+        for (i = 0; i < PIN_CHANGE_AVAILABLE_SLOTS; i++) {
+            if (handlers[i].pin == pin) {
+                handlers[i].callback = NULL;
+            }
+        }
+    }
+}
+
+/**
+ * Dispatch a pin change interrupt to the callbacks of the pins that changed.
+ *
+ * @param uint8_t port Port index.
+ *
+ * @return void
+ */
+void PinChangeManager::handleChange(uint8_t port)
+{
+    uint8_t i;
+    uint8_t state;
+    uint8_t changed;
+    bool read = false;
+
+    for (i = 0; i < PIN_CHANGE_AVAILABLE_SLOTS; i++) {
+        if (handlers[i].callback == NULL || handlers[i].port != port) {
+            continue;
+        }
+
+        if (!read) {
+            state = *handlers[i].input;
+            changed = state ^ states[port];
+            states[port] = state;
+            read = true;
+        }
+
+        if (changed & handlers[i].mask) {
+            handlers[i].callback(handlers[i].context, state & handlers[i].mask);
+        }
+    }
+}
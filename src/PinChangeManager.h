@@ -0,0 +1,35 @@
+#ifndef PIN_CHANGE_MANAGER_H
+#define PIN_CHANGE_MANAGER_H
+
+#include "ArduinoHeader.h"
+
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#define PIN_CHANGE_AVAILABLE_SLOTS 4
+#define PIN_CHANGE_PORTS 3
+
+class PinChangeManager {
+    public:
+        typedef void (*Callback)(void*, bool);
+
+        static bool attach(uint8_t pin, Callback callback, void* context);
+        static void detach(uint8_t pin);
+
+        static void handleChange(uint8_t port);
+
+    private:
+        struct Handler {
+            uint8_t pin;
+            uint8_t port;
+            uint8_t mask;
+            volatile uint8_t* input;
+            Callback callback;
+            void* context;
+        };
+
+        static Handler handlers[PIN_CHANGE_AVAILABLE_SLOTS];
+        static volatile uint8_t states[PIN_CHANGE_PORTS];
+};
+
+#endif
@@ -0,0 +1,338 @@
+#include "PowerManager.h"
+
+// Interrupts and changed updates during the current cycle.
+uint8_t PowerManager::events = 0;
+
+// Recent activity, as a decaying sum of events.
+uint8_t PowerManager::activity = 0;
+
+// Sleep duration in seconds, as of the last cycle.
+uint16_t PowerManager::sleep_duration = 0;
+
+// Digests of the values submitted by the current and the previous update.
+uint16_t PowerManager::digest = 0;
+uint16_t PowerManager::last_digest = 0;
+
+// Whether values are being submitted because of an interrupt.
+bool PowerManager::interrupt = false;
+
+// Time spent in every state, as accounted so far.
+PowerManager::Duration PowerManager::awake_time = {};
+PowerManager::Duration PowerManager::sleep_time = {};
+PowerManager::Duration PowerManager::conversion_time = {};
+PowerManager::Duration PowerManager::transmit_time = {};
+
+// Start of the awake time that has yet to be accounted.
+uint32_t PowerManager::awake_since = 0;
+
+// Transmit time that has yet to be accounted, in microseconds.
+uint32_t PowerManager::pending_transmit_time = 0;
+
+// Estimated charge consumed in uAh, and the remainder in uAms.
+uint32_t PowerManager::charge = 0;
+uint32_t PowerManager::charge_remainder = 0;
+
+/**
+ * Record an interrupt as activity.
+ *
+ * @return void
+ */
+void PowerManager::recordInterrupt()
+{
+    if (events < POWER_MAX_EVENTS_PER_CYCLE) {
+        events++;
+    }
+}
+
+/**
+ * Mark the values submitted from now on as submitted because of an interrupt,
+ * or not. The interrupt itself already counts as activity, so its values are
+ * left out of the digest.
+ *
+ * @param bool value Whether an interrupt is being handled.
+ *
+ * @return void
+ */
+void PowerManager::setInterrupt(bool value)
+{
+    interrupt = value;
+}
+
+/**
+ * Return whether values are being submitted because of an interrupt.
+ *
+ * @return bool
+ */
+bool PowerManager::isInterrupt()
+{
+    return interrupt;
+}
+
+/**
+ * Fold a submitted value into the digest of the current update, which is used
+ * to tell whether any value changed since the previous update. Values
+ * submitted because of an interrupt are ignored.
+ *
+ * @param uint8_t child_id   Child sensor ID.
+ * @param uint8_t value_type Type of the value.
+ * @param int32_t value      Submitted value.
+ *
+ * @return void
+ */
+void PowerManager::recordValue(uint8_t child_id, uint8_t value_type, int32_t value)
+{
+    if (interrupt) {
+        return;
+    }
+
+    digest = (digest << 5) | (digest >> 11);
+    digest ^= ((uint16_t) child_id << 8) ^ value_type ^ (uint16_t) value ^ (uint16_t) (value >> 16);
+}
+
+/**
+ * Complete an update, recording it as activity if any of its values differ
+ * from the previous update.
+ *
+ * @return void
+ */
+void PowerManager::completeUpdate()
+{
+    if (digest != last_digest) {
+        recordInterrupt();
+    }
+
+    last_digest = digest;
+    digest = 0;
+}
+
+/**
+ * Calculate how long to sleep for at the end of the current cycle. Without
+ * adaptive duty cycling, this is the configured sleep duration. Otherwise,
+ * that duration is stretched as the battery drops, shortened while activity is
+ * high, and kept within the configured bounds.
+ *
+ * @return uint16_t Sleep duration in seconds
+ */
+uint16_t PowerManager::updateSleepDuration()
+{
+    uint32_t duration;
+    uint16_t maximum;
+    uint8_t level;
+
+    activity = min((activity >> 1) + (events * POWER_ACTIVITY_PER_EVENT), 255);
+    events = 0;
+
+    duration = ConfigurationManager::getInteger(CFG_POWER_SLEEP_DURATION);
+
+    if (!ConfigurationManager::getBoolean(CFG_POWER_ADAPTIVE) || !duration) {
+        sleep_duration = duration;
+
+        return sleep_duration;
+    }
+
+    level = BatteryManager::getLevel();
+
+    if (level < POWER_LOW_BATTERY_LEVEL) {
+        duration = (duration * POWER_LOW_BATTERY_LEVEL) / max(level, POWER_MIN_BATTERY_LEVEL);
+    }
+
+    duration = (duration * POWER_ACTIVITY_SCALE) / (POWER_ACTIVITY_SCALE + activity);
+
+    maximum = ConfigurationManager::getInteger(CFG_POWER_MAX_SLEEP_DURATION);
+
+    if (maximum && duration > maximum) {
+        duration = maximum;
+    }
+
+    sleep_duration = max(min(duration, 0xFFFF), ConfigurationManager::getInteger(CFG_POWER_MIN_SLEEP_DURATION));
+
+    return sleep_duration;
+}
+
+/**
+ * Return the sleep duration in seconds, as of the last cycle.
+ *
+ * @return uint16_t
+ */
+uint16_t PowerManager::getSleepDuration()
+{
+    return sleep_duration;
+}
+
+/**
+ * Return the recent activity, from 0 up to 255.
+ *
+ * @return uint8_t
+ */
+uint8_t PowerManager::getActivity()
+{
+    return activity;
+}
+
+/**
+ * Record time spent transmitting.
+ *
+ * @param uint32_t duration Duration in microseconds.
+ *
+ * @return void
+ */
+void PowerManager::recordTransmission(uint32_t duration)
+{
+    pending_transmit_time += duration;
+}
+
+/**
+ * Account the time spent awake since the previous call, split into time spent
+ * converting, transmitting and otherwise awake, along with the charge each of
+ * those consumed.
+ *
+ * @return void
+ */
+void PowerManager::accountAwake()
+{
+    uint32_t now = millis();
+    uint32_t elapsed = now - awake_since;
+    uint32_t converting = AdcManager::takeConversionTime();
+    uint32_t transmitting = pending_transmit_time;
+    uint64_t idle;
+
+    awake_since = now;
+    pending_transmit_time = 0;
+
+    addTime(awake_time, elapsed, 0);
+    addTime(conversion_time, 0, converting);
+    addTime(transmit_time, 0, transmitting);
+
+    // Every state is accounted at its own current, so overlapping time is
+    // taken off the time otherwise spent awake
+    idle = (uint64_t) elapsed * 1000;
+    idle = idle > (uint64_t) converting + transmitting ? idle - converting - transmitting : 0;
+
+    addCharge((
+        (idle * ConfigurationManager::getInteger(CFG_POWER_AWAKE_CURRENT))
+        + ((uint64_t) converting * ConfigurationManager::getInteger(CFG_POWER_CONVERSION_CURRENT))
+        + ((uint64_t) transmitting * ConfigurationManager::getInteger(CFG_POWER_TRANSMIT_CURRENT))
+    ) / 1000);
+}
+
+/**
+ * Account time spent asleep, and time spent waking up in between, which is
+ * spent awake.
+ *
+ * @param uint32_t duration  Duration in milliseconds.
+ * @param uint32_t wake_time Time spent waking up in milliseconds.
+ *
+ * @return void
+ */
+void PowerManager::accountSleep(uint32_t duration, uint32_t wake_time)
+{
+    addTime(sleep_time, duration, 0);
+    addTime(awake_time, wake_time, 0);
+    addCharge(
+        ((uint64_t) duration * ConfigurationManager::getInteger(CFG_POWER_SLEEP_CURRENT))
+        + ((uint64_t) wake_time * ConfigurationManager::getInteger(CFG_POWER_AWAKE_CURRENT))
+    );
+}
+
+/**
+ * Return the time spent awake in seconds, as accounted so far.
+ *
+ * @return uint32_t
+ */
+uint32_t PowerManager::getAwakeTime()
+{
+    return awake_time.seconds;
+}
+
+/**
+ * Return the time spent asleep in seconds, as accounted so far.
+ *
+ * @return uint32_t
+ */
+uint32_t PowerManager::getSleepTime()
+{
+    return sleep_time.seconds;
+}
+
+/**
+ * Return the time spent converting in milliseconds, as accounted so far.
+ *
+ * @return uint32_t
+ */
+uint32_t PowerManager::getConversionTime()
+{
+    return (conversion_time.seconds * 1000) + (conversion_time.microseconds / 1000);
+}
+
+/**
+ * Return the time spent transmitting in milliseconds, as accounted so far.
+ *
+ * @return uint32_t
+ */
+uint32_t PowerManager::getTransmitTime()
+{
+    return (transmit_time.seconds * 1000) + (transmit_time.microseconds / 1000);
+}
+
+/**
+ * Return the estimated charge consumed in uAh, as accounted so far.
+ *
+ * @return uint32_t
+ */
+uint32_t PowerManager::getCharge()
+{
+    return charge;
+}
+
+/**
+ * Return the time left until the battery is depleted in hours, assuming the
+ * average current so far is kept up.
+ *
+ * @return uint32_t Hours left, or 0 if nothing has been accounted yet
+ */
+uint32_t PowerManager::getProjectedLifetime()
+{
+    uint32_t capacity;
+    uint32_t seconds;
+    uint64_t average;
+
+    capacity = (uint32_t) ConfigurationManager::getInteger(CFG_BATTERY_CAPACITY) * 1000;
+    seconds = awake_time.seconds + sleep_time.seconds;
+
+    if (!charge || !seconds || charge >= capacity) {
+        return 0;
+    }
+
+    // Average current in nA, keeping precision for nodes that sleep a lot
+    average = ((uint64_t) charge * 3600 * 1000) / seconds;
+
+    return average ? (((uint64_t) (capacity - charge)) * 1000) / average : 0;
+}
+
+/**
+ * Add time to a duration.
+ *
+ * @return void
+ */
+void PowerManager::addTime(Duration& duration, uint32_t milliseconds, uint32_t microseconds)
+{
+    duration.microseconds += microseconds % 1000000;
+    duration.microseconds += (milliseconds % 1000) * 1000;
+    duration.seconds += (microseconds / 1000000) + (milliseconds / 1000) + (duration.microseconds / 1000000);
+    duration.microseconds %= 1000000;
+}
+
+/**
+ * Add consumed charge, carrying whole uAh over.
+ *
+ * @param uint64_t consumed Charge in uAms.
+ *
+ * @return void
+ */
+void PowerManager::addCharge(uint64_t consumed)
+{
+    consumed += charge_remainder;
+
+    charge += consumed / POWER_CHARGE_PER_UAH;
+    charge_remainder = consumed % POWER_CHARGE_PER_UAH;
+}
@@ -0,0 +1,76 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include "ArduinoHeader.h"
+
+#include "ConfigurationManager.h"
+#include "BatteryManager.h"
+#include "AdcManager.h"
+
+// Below this battery level, sleep is stretched in proportion to the level,
+// up to four times the configured duration.
+#define POWER_LOW_BATTERY_LEVEL 50
+#define POWER_MIN_BATTERY_LEVEL (POWER_LOW_BATTERY_LEVEL / 4)
+
+// Activity decays by half every cycle, and every interrupt or changed update
+// adds to it, up to a limit per cycle. Sleep is divided by 1 + activity / 64.
+#define POWER_ACTIVITY_PER_EVENT 16
+#define POWER_MAX_EVENTS_PER_CYCLE 8
+#define POWER_ACTIVITY_SCALE 64
+
+// Charge is accumulated in uAms, and carried over into uAh.
+#define POWER_CHARGE_PER_UAH 3600000UL
+
+class PowerManager {
+    public:
+        static void recordInterrupt();
+        static void setInterrupt(bool value);
+        static bool isInterrupt();
+        static void recordValue(uint8_t child_id, uint8_t value_type, int32_t value);
+        static void completeUpdate();
+
+        static uint16_t updateSleepDuration();
+        static uint16_t getSleepDuration();
+        static uint8_t getActivity();
+
+        static void recordTransmission(uint32_t duration);
+        static void accountAwake();
+        static void accountSleep(uint32_t duration, uint32_t wake_time);
+
+        static uint32_t getAwakeTime();
+        static uint32_t getSleepTime();
+        static uint32_t getConversionTime();
+        static uint32_t getTransmitTime();
+        static uint32_t getCharge();
+        static uint32_t getProjectedLifetime();
+
+    private:
+        // A duration too long to keep in microseconds.
+        struct Duration {
+            uint32_t seconds;
+            uint32_t microseconds;
+        };
+
+        static Duration awake_time;
+        static Duration sleep_time;
+        static Duration conversion_time;
+        static Duration transmit_time;
+        static uint32_t awake_since;
+        static uint32_t pending_transmit_time;
+
+        static uint32_t charge;
+        static uint32_t charge_remainder;
+
+        static uint8_t events;
+        static uint8_t activity;
+        static uint16_t sleep_duration;
+
+        static uint16_t digest;
+        static uint16_t last_digest;
+        static bool interrupt;
+
+        static void addTime(Duration& duration, uint32_t milliseconds, uint32_t microseconds);
+        static void addCharge(uint64_t charge);
+};
+
+#endif
@@ -0,0 +1,417 @@
+#include "ADXL345Sensor.h"
+
+// Registers read by transactions, which need them to stay in memory.
+static const uint8_t source_register = ADXL345_REG_INT_SOURCE;
+static const uint8_t fifo_status_register = ADXL345_REG_FIFO_STATUS;
+static const uint8_t data_register = ADXL345_REG_DATAX0;
+
+bool ADXL345Sensor::begin(uint8_t activity_threshold, uint8_t inactivity_threshold, uint8_t inactivity_time, uint8_t power_mode, uint8_t events)
+{
+    I2CManager::Transaction transactions[6];
+    uint8_t device_id = 0;
+    uint8_t interrupts = ADXL345_INT_WATERMARK;
+    uint8_t i;
+
+    // Consecutive registers are written in a single transaction each:
+    // DUR, LATENT, WINDOW, THRESH_ACT, THRESH_INACT, TIME_INACT,
+    // ACT_INACT_CTL, THRESH_FF, TIME_FF and TAP_AXES
+    uint8_t timing[11] = {ADXL345_REG_DUR};
+    // BW_RATE, POWER_CTL and INT_ENABLE
+    uint8_t control[4] = {ADXL345_REG_BW_RATE, ADXL345_BW_RATE};
+    uint8_t tap[2] = {ADXL345_REG_THRESH_TAP, 0};
+    uint8_t format[2] = {ADXL345_REG_DATA_FORMAT, ADXL345_DATA_FORMAT};
+
+    // Enable FIFO streaming mode, raising the watermark interrupt once the
+    // FIFO holds the given amount of entries
+    uint8_t fifo[2] = {ADXL345_REG_FIFO_CTL, ADXL345_FIFO_STREAM | ADXL345_FIFO_WATERMARK};
+
+    // Map activity, tap and free-fall interrupts to int1; inactivity and
+    // watermark interrupts to int2, so the watermark doesn't wake a node
+    // waiting for activity
+    uint8_t map[2] = {ADXL345_REG_INT_MAP, ADXL345_INT_INACTIVITY | ADXL345_INT_WATERMARK};
+
+    if (I2CManager::readRegisters(ADXL345_ADDRESS, ADXL345_REG_DEVID, &device_id, 1) != I2C_STATUS_OK
+        || device_id != ADXL345_DEVICE_ID) {
+        return false;
+    }
+
+    // Configure activity detection
+    if (activity_threshold > 0) {
+        // Threshold is configured in 0.1g, the register uses 62.5mg / LSB
+        timing[4] = min(((uint16_t) activity_threshold * 8) / 5, 255);
+        timing[7] |= 0x70;
+        this->activity_enabled = true;
+        interrupts |= ADXL345_INT_ACTIVITY;
+    }
+
+    // Configure inactivity detection
+    if (inactivity_threshold > 0) {
+        timing[5] = min(((uint16_t) inactivity_threshold * 8) / 5, 255);
+        timing[7] |= 0x07;
+        this->inactivity_enabled = true;
+        interrupts |= ADXL345_INT_INACTIVITY;
+    }
+
+    // Configure inactivity time
+    timing[6] = inactivity_time > 0 ? inactivity_time : 5;
+
+    // Configure tap detection; double taps also need single tap detection
+    if (events & (ADXL345_EVENT_TAP | ADXL345_EVENT_DOUBLE_TAP)) {
+        tap[1] = ADXL345_TAP_THRESHOLD;
+        timing[1] = ADXL345_TAP_DURATION;
+        timing[10] = 0x07;
+
+        if (events & ADXL345_EVENT_TAP) {
+            this->enabled_events |= ADXL345_INT_SINGLE_TAP;
+        }
+
+        if (events & ADXL345_EVENT_DOUBLE_TAP) {
+            timing[2] = ADXL345_TAP_LATENCY;
+            timing[3] = ADXL345_TAP_WINDOW;
+            this->enabled_events |= ADXL345_INT_DOUBLE_TAP;
+        }
+    }
+
+    // Configure free-fall detection
+    if (events & ADXL345_EVENT_FREE_FALL) {
+        timing[8] = ADXL345_FREE_FALL_THRESHOLD;
+        timing[9] = ADXL345_FREE_FALL_TIME;
+        this->enabled_events |= ADXL345_INT_FREE_FALL;
+    }
+
+    interrupts |= this->enabled_events;
+
+    // Configure power control mode last, so measuring starts with everything
+    // else in place
+    // For link and auto-sleep alongside measurements, use 0b00111000 / 0x38
+    control[2] = power_mode > 0 ? power_mode : 0x08; // Default to measurement mode
+    control[3] = interrupts;
+
+    // Queue everything at once and only wait for the results afterwards
+    I2CManager::write(&transactions[0], ADXL345_ADDRESS, format, sizeof(format));
+    I2CManager::write(&transactions[1], ADXL345_ADDRESS, tap, sizeof(tap));
+    I2CManager::write(&transactions[2], ADXL345_ADDRESS, timing, sizeof(timing));
+    I2CManager::write(&transactions[3], ADXL345_ADDRESS, fifo, sizeof(fifo));
+    I2CManager::write(&transactions[4], ADXL345_ADDRESS, map, sizeof(map));
+    I2CManager::write(&transactions[5], ADXL345_ADDRESS, control, sizeof(control));
+
+    for (i = 0; i < sizeof(transactions) / sizeof(transactions[0]); i++) {
+        if (I2CManager::wait(&transactions[i]) != I2C_STATUS_OK) {
+            I2CManager::flush();
+
+            return false;
+        }
+    }
+
+    // Clear stale interrupts
+    I2CManager::readRegisters(ADXL345_ADDRESS, ADXL345_REG_INT_SOURCE, &device_id, 1);
+
+    return true;
+}
+
+void ADXL345Sensor::setInterruptPins(uint8_t int1_pin, uint8_t int2_pin)
+{
+    // Interrupts mapped to a line that isn't connected would go unnoticed
+    if (!int2_pin || (!int1_pin && (this->activity_enabled || this->enabled_events))) {
+        return;
+    }
+
+    this->int1_pin = int1_pin;
+    this->int2_pin = int2_pin;
+
+    pinMode(this->int2_pin, INPUT);
+
+    if (this->int1_pin) {
+        pinMode(this->int1_pin, INPUT);
+    }
+}
+
+void ADXL345Sensor::poll()
+{
+    if (this->busy) {
+        return;
+    }
+
+    if (this->int2_pin && !this->listening) {
+        this->listen();
+    }
+
+    // Only read the interrupt sources once a line has been raised
+    if (this->listening) {
+        if (this->checked && this->isRaised()) {
+            this->interrupted = true;
+        }
+
+        this->checked = false;
+
+        if (!this->interrupted) {
+            return;
+        }
+
+        this->interrupted = false;
+        this->checked = true;
+    }
+
+    this->checkEvents(false);
+}
+
+void ADXL345Sensor::suspend()
+{
+    if (!this->listening) {
+        return;
+    }
+
+    PinChangeManager::detach(this->int2_pin);
+
+    if (this->int1_pin) {
+        PinChangeManager::detach(this->int1_pin);
+    }
+
+    this->listening = false;
+}
+
+void ADXL345Sensor::read()
+{
+    uint8_t axis;
+
+    // Let a running chain complete, then drain whatever is queued, whether
+    // the watermark has been reached or not
+    this->sync();
+    this->checkEvents(true);
+    this->sync();
+
+    // Without anything queued, fall back to the current output data
+    if (!this->count) {
+        this->busy = true;
+        this->remaining = 1;
+
+        if (!I2CManager::read(&this->transaction, ADXL345_ADDRESS, &data_register, this->buffer, sizeof(this->buffer), onSample, this)) {
+            this->busy = false;
+        }
+
+        this->sync();
+    }
+
+    // In full resolution mode every LSB represents 4mg regardless of the
+    // range, so the mean can be scaled without involving floating point math
+    for (axis = 0; axis < 3; axis++) {
+        this->acceleration[axis] = this->count ? (this->sum[axis] * ADXL345_MG_PER_LSB) / (int32_t) this->count : 0;
+        this->sum[axis] = 0;
+    }
+
+    this->samples = this->count;
+    this->count = 0;
+
+    this->events = this->pending_events;
+    this->pending_events = 0;
+}
+
+bool ADXL345Sensor::getWindow(uint8_t axis, int16_t* samples) const
+{
+    uint8_t i;
+
+    if (this->window_count < ADXL345_WINDOW_SIZE) {
+        return false;
+    }
+
+    // Once full, the write index points at the oldest sample
+    for (i = 0; i < ADXL345_WINDOW_SIZE; i++) {
+        samples[i] = this->window[(this->window_index + i) % ADXL345_WINDOW_SIZE][axis];
+    }
+
+    return true;
+}
+
+uint8_t ADXL345Sensor::takeEvents()
+{
+    uint8_t events = 0;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        events = this->unreported_events;
+        this->unreported_events = 0;
+    }
+
+    return events;
+}
+
+/**
+ * Start a transfer chain by reading the interrupt sources.
+ *
+ * @param bool drain Drain the FIFO even if the watermark hasn't been reached.
+ *
+ * @return void
+ */
+void ADXL345Sensor::checkEvents(bool drain)
+{
+    this->busy = true;
+    this->drain_always = drain;
+    this->retries = ADXL345_EVENT_RETRIES;
+
+    if (!I2CManager::read(&this->transaction, ADXL345_ADDRESS, &source_register, this->buffer, 1, onEvents, this)) {
+        this->busy = false;
+    }
+}
+
+/**
+ * Wait for a running transfer chain to complete. Every transaction is subject
+ * to a timeout, so this can't hang.
+ *
+ * @return void
+ */
+void ADXL345Sensor::sync()
+{
+    while (this->busy) {
+        I2CManager::poll();
+    }
+}
+
+/**
+ * Attach to the interrupt lines. Lines raised before then don't cause an
+ * interrupt, so the sources are checked once right after. If no pin change
+ * interrupts are left, the sources are checked on every poll instead.
+ *
+ * @return void
+ */
+void ADXL345Sensor::listen()
+{
+    this->listening = PinChangeManager::attach(this->int2_pin, onInterrupt, this)
+        && (!this->int1_pin || PinChangeManager::attach(this->int1_pin, onInterrupt, this));
+
+    // Without pin change interrupts, fall back to checking on every poll
+    if (!this->listening) {
+        PinChangeManager::detach(this->int2_pin);
+
+        this->int1_pin = 0;
+        this->int2_pin = 0;
+    }
+
+    this->interrupted = true;
+}
+
+/**
+ * Return whether one of the interrupt lines is raised. Lines are active high.
+ *
+ * @return bool
+ */
+bool ADXL345Sensor::isRaised() const
+{
+    return digitalRead(this->int2_pin) || (this->int1_pin && digitalRead(this->int1_pin));
+}
+
+/**
+ * Flag a raised interrupt line. Called from the pin change interrupt.
+ *
+ * @return void
+ */
+void ADXL345Sensor::onInterrupt(void* context, bool level)
+{
+    if (level) {
+        reinterpret_cast<ADXL345Sensor*>(context)->interrupted = true;
+    }
+}
+
+/**
+ * Handle the interrupt sources, latching them as reading INT_SOURCE clears
+ * them. If activity and inactivity show up in the same read, read again a
+ * bounded amount of times until only one of them remains. Called from the TWI
+ * interrupt.
+ *
+ * @return void
+ */
+void ADXL345Sensor::onEvents(void* context, I2CManager::Transaction* transaction)
+{
+    ADXL345Sensor* sensor = reinterpret_cast<ADXL345Sensor*>(context);
+    uint8_t source;
+    uint8_t movement;
+
+    if (transaction->status != I2C_STATUS_OK) {
+        sensor->busy = false;
+        return;
+    }
+
+    source = sensor->buffer[0];
+    sensor->pending_events |= source;
+    sensor->unreported_events |= source & sensor->enabled_events;
+    movement = source & (ADXL345_INT_ACTIVITY | ADXL345_INT_INACTIVITY);
+
+    if (movement == (ADXL345_INT_ACTIVITY | ADXL345_INT_INACTIVITY) && --sensor->retries) {
+        sensor->busy = I2CManager::submit(transaction);
+        return;
+    }
+
+    if (movement == ADXL345_INT_ACTIVITY) {
+        sensor->active = true;
+    } else if (movement == ADXL345_INT_INACTIVITY) {
+        sensor->active = false;
+    }
+
+    if (sensor->drain_always || (source & (ADXL345_INT_WATERMARK | ADXL345_INT_OVERRUN))) {
+        sensor->busy = I2CManager::read(transaction, ADXL345_ADDRESS, &fifo_status_register, sensor->buffer, 1, onFifoStatus, sensor);
+        return;
+    }
+
+    sensor->busy = false;
+}
+
+/**
+ * Start draining the entries queued in the FIFO. Called from the TWI
+ * interrupt.
+ *
+ * @return void
+ */
+void ADXL345Sensor::onFifoStatus(void* context, I2CManager::Transaction* transaction)
+{
+    ADXL345Sensor* sensor = reinterpret_cast<ADXL345Sensor*>(context);
+
+    if (transaction->status != I2C_STATUS_OK) {
+        sensor->busy = false;
+        return;
+    }
+
+    sensor->remaining = min(sensor->buffer[0] & ADXL345_FIFO_ENTRIES_MASK, ADXL345_FIFO_SIZE);
+
+    if (!sensor->remaining) {
+        sensor->busy = false;
+        return;
+    }
+
+    // Every entry has to be read as a single 6 byte burst; reading past the
+    // data registers doesn't pop the next entry, so one transaction per entry
+    // is the best we can do. The 5us the datasheet requires between entries
+    // is covered by the stop and start conditions in between.
+    sensor->busy = I2CManager::read(transaction, ADXL345_ADDRESS, &data_register, sensor->buffer, sizeof(sensor->buffer), onSample, sensor);
+}
+
+/**
+ * Add a sample read from the output data registers to the window, and read
+ * the next FIFO entry if there is one. Called from the TWI interrupt.
+ *
+ * @return void
+ */
+void ADXL345Sensor::onSample(void* context, I2CManager::Transaction* transaction)
+{
+    ADXL345Sensor* sensor = reinterpret_cast<ADXL345Sensor*>(context);
+    uint8_t axis;
+    int16_t* sample;
+
+    if (transaction->status != I2C_STATUS_OK) {
+        sensor->busy = false;
+        return;
+    }
+
+    sample = sensor->window[sensor->window_index];
+
+    for (axis = 0; axis < 3; axis++) {
+        sample[axis] = (int16_t) ((sensor->buffer[(axis * 2) + 1] << 8) | sensor->buffer[axis * 2]);
+        sensor->sum[axis] += sample[axis];
+    }
+
+    sensor->count++;
+    sensor->window_index = (sensor->window_index + 1) % ADXL345_WINDOW_SIZE;
+
+    if (sensor->window_count < ADXL345_WINDOW_SIZE) {
+        sensor->window_count++;
+    }
+
+    sensor->busy = --sensor->remaining && I2CManager::submit(transaction);
+}
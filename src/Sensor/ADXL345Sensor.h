@@ -0,0 +1,300 @@
+/**
+    ADXL345 Digital 3-Axis Gravity Acceleration Sensor class
+
+    http://www.analog.com/media/en/technical-documentation/data-sheets/ADXL345.pdf
+ */
+
+#ifndef adxl345_sensor_h
+#define adxl345_sensor_h
+
+#include "../ArduinoHeader.h"
+
+#include "../I2CManager.h"
+#include "../PinChangeManager.h"
+#include "VibrationFeatures.h"
+
+#define ADXL345_ADDRESS 0x53
+#define ADXL345_DEVICE_ID 0xE5
+
+#define ADXL345_REG_DEVID 0x00
+#define ADXL345_REG_THRESH_TAP 0x1D
+#define ADXL345_REG_DUR 0x21
+#define ADXL345_REG_BW_RATE 0x2C
+#define ADXL345_REG_INT_MAP 0x2F
+#define ADXL345_REG_INT_SOURCE 0x30
+#define ADXL345_REG_DATA_FORMAT 0x31
+#define ADXL345_REG_DATAX0 0x32
+#define ADXL345_REG_FIFO_CTL 0x38
+#define ADXL345_REG_FIFO_STATUS 0x39
+
+// Full resolution, +-16g
+#define ADXL345_DATA_FORMAT 0x0B
+
+// 100Hz output data rate
+#define ADXL345_BW_RATE 0x0A
+
+// INT_SOURCE / INT_ENABLE / INT_MAP bits
+#define ADXL345_INT_DATA_READY 0x80
+#define ADXL345_INT_SINGLE_TAP 0x40
+#define ADXL345_INT_DOUBLE_TAP 0x20
+#define ADXL345_INT_ACTIVITY 0x10
+#define ADXL345_INT_INACTIVITY 0x08
+#define ADXL345_INT_FREE_FALL 0x04
+#define ADXL345_INT_WATERMARK 0x02
+#define ADXL345_INT_OVERRUN 0x01
+
+// FIFO_CTL stream mode, and the mask of the entry count in FIFO_STATUS
+#define ADXL345_FIFO_STREAM 0x80
+#define ADXL345_FIFO_ENTRIES_MASK 0x3F
+
+// The FIFO holds 32 entries. Raising the watermark halfway leaves 16 entries,
+// or 160ms at 100Hz, to drain it before samples are overwritten.
+#define ADXL345_FIFO_SIZE 32
+#define ADXL345_FIFO_WATERMARK 16
+
+// Amount of most recent samples kept around for analysis.
+#define ADXL345_WINDOW_SIZE VIBRATION_WINDOW_SIZE
+
+// Output data rate in Hz, and the resolution in full resolution mode, which is
+// the same for every range.
+#define ADXL345_SAMPLE_RATE 100
+#define ADXL345_MG_PER_LSB 4
+
+// Events to detect, as packed into the accelerometer events configuration
+// integer.
+#define ADXL345_EVENT_TAP 0x01
+#define ADXL345_EVENT_DOUBLE_TAP 0x02
+#define ADXL345_EVENT_FREE_FALL 0x04
+
+// Tap detection: a 3g threshold (62.5mg / LSB) exceeded for at most 10ms
+// (625us / LSB), with a second tap 100ms (1.25ms / LSB) to 350ms later
+// counting as a double tap.
+#define ADXL345_TAP_THRESHOLD 48
+#define ADXL345_TAP_DURATION 16
+#define ADXL345_TAP_LATENCY 80
+#define ADXL345_TAP_WINDOW 200
+
+// Free-fall detection: all axes below 375mg (62.5mg / LSB) for 100ms
+// (5ms / LSB), in the ranges recommended by the datasheet.
+#define ADXL345_FREE_FALL_THRESHOLD 6
+#define ADXL345_FREE_FALL_TIME 20
+
+// Maximum amount of INT_SOURCE reads spent on resolving simultaneous activity
+// and inactivity events.
+#define ADXL345_EVENT_RETRIES 4
+
+/*
+ * ADXL345Sensor
+ *
+ * A class that is in charge of managing an ADXL345 accelerometer.
+ *
+ * The FIFO of the device runs in stream mode and raises its watermark
+ * interrupt once it is half full, at which point every queued entry is read in
+ * a burst. This captures the full output data rate instead of a single sample
+ * per update, without having to poll the device for every sample. Transfers
+ * run in the background through the I2C manager.
+ *
+ * If the INT1 and INT2 lines are connected, the interrupt sources are only
+ * read once a pin change interrupt reports one of them was raised; otherwise
+ * they're read on every poll.
+ */
+class ADXL345Sensor {
+    protected:
+        // The most recent samples per axis in raw LSB, as a ring buffer
+        int16_t window[ADXL345_WINDOW_SIZE][3];
+        uint8_t window_index = 0;
+        uint8_t window_count = 0;
+
+        // Sum and amount of samples drained since the last reading
+        int32_t sum[3] = {0, 0, 0};
+        uint16_t count = 0;
+
+        // Mean acceleration in mg and amount of samples of the last reading
+        int32_t acceleration[3] = {0, 0, 0};
+        uint16_t samples = 0;
+
+        // Interrupt sources seen since the last reading, as reading INT_SOURCE
+        // clears them on the device, and those seen during the last reading
+        uint8_t pending_events = 0;
+        uint8_t events = 0;
+
+        // Tap and free-fall interrupt sources not yet handed out by
+        // takeEvents(), and those that are enabled
+        uint8_t unreported_events = 0;
+        uint8_t enabled_events = 0;
+
+        bool activity_enabled = false;
+        bool inactivity_enabled = false;
+        bool active = false;
+
+        // Pins the INT1 and INT2 lines are connected to, if any. Raised lines
+        // are flagged from the pin change interrupt; a line still raised
+        // after its sources were checked needs another check, as it won't
+        // change again by itself.
+        uint8_t int1_pin = 0;
+        uint8_t int2_pin = 0;
+        bool listening = false;
+        bool checked = false;
+        volatile bool interrupted = false;
+
+        // Transfers run in the background as a chain of transactions, each
+        // queueing the next from its callback
+        I2CManager::Transaction transaction;
+        uint8_t buffer[6];
+        volatile bool busy = false;
+        bool drain_always = false;
+        uint8_t remaining = 0;
+        uint8_t retries = 0;
+
+    public:
+        /*
+         * begin
+         *
+         * Configures the device given an activity threshold, an inactivity
+         * threshold (both in 0.1g), an inactivity time in seconds, the value
+         * of the power control register and the events to detect.
+         */
+        bool begin(uint8_t activity_threshold, uint8_t inactivity_threshold, uint8_t inactivity_time, uint8_t power_mode, uint8_t events = 0);
+
+        /*
+         * setInterruptPins
+         *
+         * Sets the pins the INT1 and INT2 lines of the device are connected
+         * to. Both are needed if tap, free-fall or activity events are
+         * enabled, only INT2 otherwise.
+         */
+        void setInterruptPins(uint8_t int1_pin, uint8_t int2_pin);
+
+        /*
+         * poll
+         *
+         * Starts checking the interrupt sources of the device in the
+         * background if an interrupt line was raised, draining the FIFO once
+         * the watermark has been reached. Should be called at least once per
+         * FIFO period.
+         */
+        void poll();
+
+        /*
+         * suspend
+         *
+         * Stops listening to the interrupt lines, so the watermark doesn't
+         * wake a sleeping node. The next poll listens again.
+         */
+        void suspend();
+
+        /*
+         * read
+         *
+         * Drains the FIFO and updates the acceleration and activity state
+         * from the samples and events seen since the previous reading.
+         */
+        void read();
+
+        /*
+         * getAcceleration
+         *
+         * Gets the mean acceleration of the last reading in mg, for each axis.
+         */
+        inline int32_t getAcceleration(uint8_t axis) const {
+            return this->acceleration[axis];
+        };
+
+        /*
+         * getWindow
+         *
+         * Copies the most recent samples of an axis, oldest first, in raw LSB.
+         * Returns false until the window has been filled.
+         */
+        bool getWindow(uint8_t axis, int16_t* samples) const;
+
+        /*
+         * getSampleCount
+         *
+         * Gets the amount of samples the last reading consisted of.
+         */
+        inline uint16_t getSampleCount() const {
+            return this->samples;
+        };
+
+        /*
+         * getEvents
+         *
+         * Gets the interrupt sources seen during the last reading.
+         */
+        inline uint8_t getEvents() const {
+            return this->events;
+        };
+
+        /*
+         * takeEvents
+         *
+         * Gets the tap and free-fall interrupt sources seen since the previous
+         * call, so every event is handed out exactly once.
+         */
+        uint8_t takeEvents();
+
+        /*
+         * isEventEnabled
+         *
+         * Whether a tap or free-fall interrupt source is enabled.
+         */
+        inline bool isEventEnabled(uint8_t source) const {
+            return this->enabled_events & source;
+        };
+
+        /*
+         * hasMotionDetection
+         *
+         * Whether activity or inactivity detection is enabled.
+         */
+        inline bool hasMotionDetection() const {
+            return this->activity_enabled || this->inactivity_enabled;
+        };
+
+        /*
+         * isActive
+         *
+         * Whether activity was the last movement event seen by the device.
+         */
+        inline bool isActive() const {
+            return this->active;
+        };
+
+    protected:
+        /*
+         * checkEvents
+         *
+         * Starts a transfer chain by reading the interrupt sources.
+         */
+        void checkEvents(bool drain);
+
+        /*
+         * sync
+         *
+         * Waits for a running transfer chain to complete.
+         */
+        void sync();
+
+        /*
+         * listen
+         *
+         * Attaches to the interrupt lines.
+         */
+        void listen();
+
+        /*
+         * isRaised
+         *
+         * Whether one of the interrupt lines is raised.
+         */
+        bool isRaised() const;
+
+        static void onInterrupt(void* context, bool level);
+
+        static void onEvents(void* context, I2CManager::Transaction* transaction);
+        static void onFifoStatus(void* context, I2CManager::Transaction* transaction);
+        static void onSample(void* context, I2CManager::Transaction* transaction);
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include "DHT11.h"
+
+DHT11::DHT11(uint8_t pin) {
+    this->pin = pin;
+
+    pinMode(this->pin, INPUT_PULLUP);
+}
+
+uint8_t DHT11::read() {
+    if (this->state != DHT11_STATE_IDLE) {
+        return DHT11_PENDING;
+    }
+
+    // Sampling again this soon would only produce errors
+    if (this->measured && (millis() - this->measured_at) < DHT11_MIN_INTERVAL) {
+        return this->status;
+    }
+
+    // Pull the data line low to request a measurement
+    digitalWrite(this->pin, LOW);
+    pinMode(this->pin, OUTPUT);
+
+    this->state = DHT11_STATE_STARTING;
+    this->started = millis();
+
+    return DHT11_PENDING;
+}
+
+void DHT11::poll() {
+    uint8_t i;
+
+    switch (this->state) {
+        case DHT11_STATE_STARTING:
+            if ((millis() - this->started) < DHT11_START_SIGNAL) {
+                return;
+            }
+
+            this->edges = 0;
+
+            for (i = 0; i < DHT11_FRAME_BYTES; i++) {
+                this->data[i] = 0;
+            }
+
+            this->measured = true;
+            this->measured_at = millis();
+
+            // Listen before releasing the line, as the sensor answers within
+            // 40us
+            if (!PinChangeManager::attach(this->pin, onEdge, this)) {
+                pinMode(this->pin, INPUT_PULLUP);
+
+                this->status = DHT11_ERROR_TIMEOUT;
+                this->state = DHT11_STATE_IDLE;
+
+                return;
+            }
+
+            pinMode(this->pin, INPUT_PULLUP);
+
+            this->state = DHT11_STATE_RECEIVING;
+            this->started = millis();
+
+            break;
+
+        case DHT11_STATE_RECEIVING:
+            if (this->edges < DHT11_FRAME_EDGES && (millis() - this->started) <= DHT11_FRAME_TIMEOUT) {
+                return;
+            }
+
+            PinChangeManager::detach(this->pin);
+
+            this->status = this->edges < DHT11_FRAME_EDGES ? DHT11_ERROR_TIMEOUT : this->decode();
+            this->state = DHT11_STATE_IDLE;
+
+            break;
+
+        default:
+            break;
+    }
+}
+
+uint8_t DHT11::decode() {
+    uint8_t checksum = 0;
+    uint8_t i;
+
+    for (i = 0; i < DHT11_FRAME_BYTES - 1; i++) {
+        checksum += this->data[i];
+    }
+
+    if (checksum != this->data[DHT11_FRAME_BYTES - 1]) {
+        return DHT11_ERROR_CHECKSUM;
+    }
+
+    // The decimal bytes are always zero on a DHT11
+    this->humidity = this->data[0];
+    this->temperature = this->data[2];
+
+    return DHT11_OK;
+}
+
+void DHT11::onEdge(void* context, bool level) {
+    DHT11* sensor = reinterpret_cast<DHT11*>(context);
+    uint16_t now;
+    uint8_t edge;
+
+    if (level || sensor->edges >= DHT11_FRAME_EDGES) {
+        return;
+    }
+
+    // The lower 16 bits of the time suffice for intervals this short
+    now = micros();
+    edge = ++sensor->edges;
+
+    // The first two falling edges start the response and the first bit; every
+    // edge after that ends a bit
+    if (edge > 2) {
+        edge -= 3;
+        sensor->data[edge >> 3] = (sensor->data[edge >> 3] << 1) | ((uint16_t) (now - sensor->last_edge) > DHT11_BIT_THRESHOLD);
+    }
+
+    sensor->last_edge = now;
+}
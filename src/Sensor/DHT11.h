@@ -0,0 +1,154 @@
+/**
+    DHT11 Digital Temperature Humidity Sensor class
+
+    http://www.dx.com/p/arduino-digital-temperature-humidity-sensor-module-121350
+ */
+
+#ifndef dht11_h
+#define dht11_h
+
+#include "../ArduinoHeader.h"
+#include "../PinChangeManager.h"
+
+// Measurement results.
+#define DHT11_OK 0
+#define DHT11_ERROR_CHECKSUM 1
+#define DHT11_ERROR_TIMEOUT 2
+#define DHT11_PENDING 3
+
+// The sensor can't be sampled more than once per second.
+#define DHT11_MIN_INTERVAL 1000
+
+// Time the data line is held low to request a measurement, in milliseconds.
+// The datasheet asks for at least 18ms; holding it longer is harmless.
+#define DHT11_START_SIGNAL 20
+
+// Time the frame may take once the data line is released, in milliseconds.
+// A complete frame takes about 5ms.
+#define DHT11_FRAME_TIMEOUT 10
+
+// A bit is sent as 50us low followed by 26us high for a 0, or 70us high for a
+// 1. Bits are told apart by the time between their falling edges.
+#define DHT11_BIT_THRESHOLD 100
+
+// Falling edges in a frame: the response, then one per bit ending with the
+// start of the next bit or the end of the frame.
+#define DHT11_FRAME_BYTES 5
+#define DHT11_FRAME_EDGES ((DHT11_FRAME_BYTES * 8) + 2)
+
+#define DHT11_STATE_IDLE 0
+#define DHT11_STATE_STARTING 1
+#define DHT11_STATE_RECEIVING 2
+
+/*
+ * DHT11
+ *
+ * A class that is in charge of managing a DHT11 temperature and humidity
+ * sensor.
+ *
+ * Measurements run in the background: the start signal is timed by poll()
+ * and the frame is decoded from pin change interrupts, timing the falling
+ * edges of every bit. Reads within the minimum interval of the sensor return
+ * the result of the previous measurement.
+ */
+class DHT11 {
+private:
+    // The pin we use to communicate with the sensor
+    uint8_t pin;
+
+    uint8_t state = DHT11_STATE_IDLE;
+    uint8_t status = DHT11_PENDING;
+
+    // Whether a measurement has been made yet, and when it started
+    bool measured = false;
+    uint32_t started = 0;
+    uint32_t measured_at = 0;
+
+    // The last measured values
+    uint8_t humidity = 0;
+    uint8_t temperature = 0;
+
+    // Frame state, updated from the pin change interrupt
+    volatile uint8_t edges = 0;
+    volatile uint16_t last_edge = 0;
+    volatile uint8_t data[DHT11_FRAME_BYTES];
+
+public:
+    /*
+     * DHT11
+     *
+     * Constructs a new DHT11 object that manages a DHT11 sensor using a given
+     * data pin.
+     */
+    DHT11(uint8_t pin);
+
+    /*
+     * read
+     *
+     * Start a measurement, unless one is running or the previous one is more
+     * recent than the minimum interval. Returns the status of the previous
+     * measurement in the latter case, and DHT11_PENDING otherwise.
+     */
+    uint8_t read();
+
+    /*
+     * poll
+     *
+     * Advance a running measurement. Should be called regularly while
+     * isBusy() returns true.
+     */
+    void poll();
+
+    /*
+     * isBusy
+     *
+     * Whether a measurement is running.
+     */
+    inline bool isBusy() const {
+        return this->state != DHT11_STATE_IDLE;
+    }
+
+    /*
+     * getStatus
+     *
+     * Gets the status of the last measurement.
+     */
+    inline uint8_t getStatus() const {
+        return this->status;
+    }
+
+    /*
+     * getHumidity
+     *
+     * Gets the last measured relative humidity in %.
+     */
+    inline uint8_t getHumidity() const {
+        return this->humidity;
+    }
+
+    /*
+     * getTemperature
+     *
+     * Gets the last measured temperature in °C.
+     */
+    inline uint8_t getTemperature() const {
+        return this->temperature;
+    }
+
+private:
+    /*
+     * decode
+     *
+     * Check the received frame and update the measured values from it.
+     */
+    uint8_t decode();
+
+    /*
+     * onEdge
+     *
+     * Pin change callback shifting in a bit for every falling edge.
+     */
+    static void onEdge(void* context, bool level);
+};
+
+#endif
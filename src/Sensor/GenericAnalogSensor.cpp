@@ -2,5 +2,5 @@
 
 void GenericAnalogSensor::read()
 {
-    this->level = analogRead(this->input_pin);
+    this->level = AdcManager::read(this->input_pin);
 }
@@ -2,13 +2,19 @@
 #define generic_analog_sensor_h
 
 #include "GenericSensor.h"
+#include "../AdcManager.h"
 
 class GenericAnalogSensor: public GenericSensor {
     protected:
         uint16_t level = 0;
 
     public:
-        GenericAnalogSensor(uint8_t input_pin): GenericSensor(input_pin) {};
+        // Pins sampled with zero samples aren't added to the ADC scan list
+        GenericAnalogSensor(uint8_t input_pin, uint16_t samples = 1): GenericSensor(input_pin) {
+            if (samples) {
+                AdcManager::registerChannel(input_pin, samples);
+            }
+        };
 
         void read();
 
@@ -1,14 +1,20 @@
 #include "GenericVoltage.h"
 
 void GenericVoltage::read() {
-    uint8_t i;
+    // The sweep at the start of the update accumulated at least the requested
+    // amount of samples, so the sum is available right away
+    this->sample_sum = AdcManager::readSum(this->input_pin);
+    this->sample_count = AdcManager::getSampleCount(this->input_pin);
+}
 
-    this->level = 0;
+int32_t GenericVoltage::toMillivolts(uint32_t level) const {
+    uint32_t average;
 
-    for (i = 0; i < this->sample_count; i++) {
-        this->level += analogRead(this->input_pin);
-        delay(20);
-    }
+    // Average in Q4 so 1/16th of an LSB survives the division; at most
+    // 1023 * 16, which leaves room for the multiplication below
+    average = ((level << 4) + (this->sample_count / 2)) / this->sample_count;
 
-    // this->level /= this->sample_count;
+    // mV = (average / 16) / 1024 * 5000 / (coefficient / 1000), which
+    // reduces to average * 78125 / (256 * coefficient)
+    return ((average * (GENERIC_VOLTAGE_REFERENCE * 1000UL / 64)) + (128UL * this->coefficient)) / (256UL * this->coefficient);
 }
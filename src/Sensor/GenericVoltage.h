@@ -7,22 +7,45 @@
 
 #include "GenericAnalogSensor.h"
 
+// The coefficient is kept as a fixed-point value with this many decimals.
+#define GENERIC_VOLTAGE_COEFFICIENT_DECIMALS 3
+#define GENERIC_VOLTAGE_COEFFICIENT_ONE 1000
+
+// Largest coefficient, 16777.215, which keeps 256 times the coefficient within
+// 32 bits.
+#define GENERIC_VOLTAGE_MAX_COEFFICIENT 16777215UL
+
+// Reference voltage in millivolts.
+#define GENERIC_VOLTAGE_REFERENCE 5000
+
 /*
  * GenericVoltage
  *
  * A class that is in charge of managing a relatively generic voltage sensor.
+ *
+ * Voltages are calculated in millivolts using integer arithmetic only. Compared
+ * to the floating point formula (level / samples / 1024 * 5) / coefficient,
+ * the result is off by at most 0.5mV + (0.16mV / coefficient), which is well
+ * below the 4.9mV resolution of the ADC.
  */
 class GenericVoltage: public GenericAnalogSensor {
     protected:
-        uint8_t sample_count = 1;
-        float coefficient = 1.0;
+        uint16_t sample_count = 1;
+        uint32_t coefficient = GENERIC_VOLTAGE_COEFFICIENT_ONE;
+        uint32_t sample_sum = 0;
 
     public:
-        GenericVoltage(uint8_t input_pin, uint8_t sample_count = 1, float coefficient = 1.0): GenericAnalogSensor(input_pin), sample_count(sample_count), coefficient(coefficient) {};
+        GenericVoltage(uint8_t input_pin, uint16_t sample_count = 1, uint32_t coefficient = GENERIC_VOLTAGE_COEFFICIENT_ONE): GenericAnalogSensor(input_pin, sample_count), sample_count(sample_count), coefficient(coefficient) {};
         void read();
 
-        inline float getLevel() const {
-            return ((((float) this->level / (float) this->sample_count) / (float) 1024.0) * 5.0) / (float) this->coefficient;
+        inline uint32_t getRawLevel() const {
+            return this->sample_sum;
+        };
+
+        int32_t toMillivolts(uint32_t level) const;
+
+        inline int32_t getLevel() const {
+            return this->toMillivolts(this->sample_sum);
         };
 };
 
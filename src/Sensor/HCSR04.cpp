@@ -1,14 +1,83 @@
 #include "HCSR04.h"
 
-HCSR04::HCSR04(uint8_t trig_pin, uint8_t echo_pin) {
+HCSR04::HCSR04(uint8_t trig_pin, uint8_t echo_pin, uint8_t pings) {
     this->trig_pin = trig_pin;
     this->echo_pin = echo_pin;
+    this->pings = constrain(pings, 1, HCSR04_MAX_PINGS);
 
     pinMode(this->trig_pin, OUTPUT);
     pinMode(this->echo_pin, INPUT);
 }
 
 void HCSR04::read() {
+    if (this->state != HCSR04_STATE_IDLE) {
+        return;
+    }
+
+    this->pinged = 0;
+    this->echoes = 0;
+
+    if (!this->ping()) {
+        this->finish();
+    }
+}
+
+void HCSR04::poll() {
+    switch (this->state) {
+        case HCSR04_STATE_PINGING:
+            // Give up once the echo would correspond to an object beyond the
+            // maximum range
+            if (!this->echo_end && (micros() - this->started) < HCSR04_ECHO_TIMEOUT) {
+                return;
+            }
+
+            this->collect();
+
+            if (this->pinged >= this->pings) {
+                this->finish();
+
+                return;
+            }
+
+            this->state = HCSR04_STATE_WAITING;
+            this->started = millis();
+
+            break;
+
+        case HCSR04_STATE_WAITING:
+            if ((millis() - this->started) < HCSR04_PING_INTERVAL) {
+                return;
+            }
+
+            if (!this->ping()) {
+                this->finish();
+            }
+
+            break;
+
+        default:
+            break;
+    }
+}
+
+uint32_t HCSR04::toDistance(uint32_t duration, int8_t temperature) {
+    if (temperature == HCSR04_TEMPERATURE_UNKNOWN) {
+        return (duration * HCSR04_DISTANCE_FACTOR) >> 16;
+    }
+
+    // The speed of sound is about 331.3 + 0.606 * T m/s; halve it for the
+    // round trip and convert to cm/µs
+    return (duration * ((331300L + (606L * temperature)) / 10)) / 2000000UL;
+}
+
+bool HCSR04::ping() {
+    this->echo_start = 0;
+    this->echo_end = 0;
+
+    if (!PinChangeManager::attach(this->echo_pin, onEcho, this)) {
+        return false;
+    }
+
     // The sensor is triggered by a HIGH pulse of 10 or more microseconds.
     // Give a short LOW pulse beforehand to ensure a clean HIGH pulse:
     digitalWrite(this->trig_pin, LOW);
@@ -17,11 +86,46 @@ void HCSR04::read() {
     delayMicroseconds(10);
     digitalWrite(this->trig_pin, LOW);
 
-    // Read the signal from the sensor: a HIGH pulse whose
-    // duration is the time (in microseconds) from the sending
-    // of the ping to the reception of its echo off of an object.
-    this->duration = pulseIn(this->echo_pin, HIGH);
+    this->pinged++;
+    this->state = HCSR04_STATE_PINGING;
+    this->started = micros();
+
+    return true;
+}
+
+void HCSR04::collect() {
+    uint16_t duration;
+    uint8_t i;
+
+    PinChangeManager::detach(this->echo_pin);
+
+    if (!this->echo_start || !this->echo_end) {
+        return;
+    }
+
+    duration = this->echo_end - this->echo_start;
+
+    // Keep the durations sorted, so the median is in the middle
+    for (i = this->echoes; i > 0 && this->durations[i - 1] > duration; i--) {
+        this->durations[i] = this->durations[i - 1];
+    }
+
+    this->durations[i] = duration;
+    this->echoes++;
+}
+
+void HCSR04::finish() {
+    this->duration = this->echoes ? this->durations[this->echoes / 2] : 0;
+    this->distance = toDistance(this->duration, this->temperature);
+    this->state = HCSR04_STATE_IDLE;
+}
+
+void HCSR04::onEcho(void* context, bool level) {
+    HCSR04* sensor = reinterpret_cast<HCSR04*>(context);
 
-    // convert the time into a distance
-    this->distance = this->duration / 58.2;
+    if (level) {
+        sensor->echo_start = micros();
+    } else if (sensor->echo_start) {
+        sensor->echo_end = micros();
+    }
 }
@@ -39,10 +39,41 @@
 #    include <WProgram.h>
 #endif
 
+#include "../PinChangeManager.h"
+
+/*
+ * Factor to convert a duration in microseconds into a distance in centimeters,
+ * as a Q16 reciprocal of 58.2 (65536 / 58.2). Multiplying and shifting avoids
+ * both a floating point and a 32-bit division; distances differ from
+ * duration / 58.2 by at most 1cm for any echo a ping can measure.
+ */
+#define HCSR04_DISTANCE_FACTOR 1126UL
+
+// Maximum range of the sensor in centimeters, and the echo timeout matching
+// it. Echoes taking longer than this are treated as no reflection.
+#define HCSR04_MAX_RANGE 400
+#define HCSR04_ECHO_TIMEOUT ((HCSR04_MAX_RANGE * 59UL) + 1000)
+
+// Time to wait between pings, letting echoes of the previous ping die out.
+#define HCSR04_PING_INTERVAL 30
+
+#define HCSR04_MAX_PINGS 7
+
+#define HCSR04_STATE_IDLE 0
+#define HCSR04_STATE_PINGING 1
+#define HCSR04_STATE_WAITING 2
+
+// No temperature known; assume the speed of sound at about 20°C.
+#define HCSR04_TEMPERATURE_UNKNOWN -128
+
 /*
  * HCSR04
  *
  * A class that is in charge of managing a HC-SR04 ultrasonic sensor.
+ *
+ * Readings run in the background: poll() triggers every ping and waits out
+ * the interval between pings, and the echo pulse is timed using pin change
+ * interrupts, with a timeout matching the maximum range of the sensor.
  */
 class HCSR04 {
 private:
@@ -56,22 +87,69 @@ private:
     uint8_t echo_pin;
     uint8_t trig_pin;
 
+    // The amount of pings to take the median of
+    uint8_t pings = 1;
+
+    // The ambient temperature in °C, used to compensate the speed of sound
+    int8_t temperature = HCSR04_TEMPERATURE_UNKNOWN;
+
+    uint8_t state = HCSR04_STATE_IDLE;
+
+    // Pings sent so far in the running reading, when the last one was sent,
+    // and the durations of those that received an echo, sorted
+    uint8_t pinged = 0;
+    uint8_t echoes = 0;
+    uint32_t started = 0;
+    uint16_t durations[HCSR04_MAX_PINGS];
+
+    // Echo timing, updated from the pin change interrupt
+    volatile uint32_t echo_start = 0;
+    volatile uint32_t echo_end = 0;
+
 public:
     /*
      * HCSR04
      *
      * Constructs a new HCSR04 object that manages a HC-SR04 ultrasonic sensor
-     * using a given echo pin and a given trig pin.
+     * using a given echo pin and a given trig pin, taking the median of a
+     * given amount of pings per reading.
      */
-    HCSR04(uint8_t trig_pin, uint8_t echo_pin);
+    HCSR04(uint8_t trig_pin, uint8_t echo_pin, uint8_t pings = 1);
 
     /*
      * read
      *
-     * Update the duration and distance of this object from the sensor.
+     * Start a reading, unless one is running. The duration and distance of
+     * this object are updated once it completes.
      */
     void read();
 
+    /*
+     * poll
+     *
+     * Advance a running reading. Should be called regularly while isBusy()
+     * returns true.
+     */
+    void poll();
+
+    /*
+     * isBusy
+     *
+     * Whether a reading is running.
+     */
+    inline bool isBusy() const {
+        return this->state != HCSR04_STATE_IDLE;
+    }
+
+    /*
+     * setTemperature
+     *
+     * Sets the ambient temperature in °C used to calculate distances.
+     */
+    inline void setTemperature(int8_t temperature) {
+        this->temperature = temperature;
+    }
+
     /*
      * getDistance
      *
@@ -90,7 +168,44 @@ public:
         return this->duration;
     }
 
+    /*
+     * toDistance
+     *
+     * Converts an echo duration in microseconds into a distance in
+     * centimeters, at a given ambient temperature in °C.
+     */
+    static uint32_t toDistance(uint32_t duration, int8_t temperature = HCSR04_TEMPERATURE_UNKNOWN);
+
 private:
+    /*
+     * ping
+     *
+     * Trigger a single ping and listen for its echo. Returns false if the
+     * echo can't be listened for.
+     */
+    bool ping();
+
+    /*
+     * collect
+     *
+     * Stop listening for the echo of the last ping, and add its duration to
+     * the reading if one was received.
+     */
+    void collect();
+
+    /*
+     * finish
+     *
+     * Complete the reading, taking the median of the collected durations.
+     */
+    void finish();
+
+    /*
+     * onEcho
+     *
+     * Pin change callback recording the start and end of the echo pulse.
+     */
+    static void onEcho(void* context, bool level);
 };
 
 #endif
@@ -0,0 +1,55 @@
+#include "KY038.h"
+
+void KY038::read()
+{
+    Envelope envelope = {0, 0xFFFF, 0, 0, 0};
+    uint16_t mean;
+    uint16_t remainder_mean;
+    uint32_t mean_of_squares;
+    uint32_t remainder_squares;
+    int32_t variance;
+
+    AdcManager::stream(this->input_pin, this->window, KY038_MAX_SAMPLES, accumulate, &envelope);
+
+    if (!envelope.count) {
+        this->level = this->peak_to_peak = this->peak = 0;
+        return;
+    }
+
+    // With sum = mean * n + r and sum of squares = q * n + s, the variance
+    // E[x^2] - E[x]^2 equals (q - mean^2) + (s - 2 * mean * r - r^2 / n) / n,
+    // which keeps every intermediate result within 32 bits
+    mean = envelope.sum / envelope.count;
+    remainder_mean = envelope.sum % envelope.count;
+    mean_of_squares = envelope.sum_of_squares / envelope.count;
+    remainder_squares = envelope.sum_of_squares % envelope.count;
+
+    variance = (int32_t) (mean_of_squares - ((uint32_t) mean * mean));
+    variance += ((int32_t) remainder_squares - (2L * mean * remainder_mean) - (((uint32_t) remainder_mean * remainder_mean) / envelope.count)) / (int32_t) envelope.count;
+
+    this->level = sqrt32(variance > 0 ? variance : 0);
+    this->peak_to_peak = envelope.maximum - envelope.minimum;
+    this->peak = max(envelope.maximum - mean, mean - envelope.minimum);
+}
+
+/**
+ * Fold a sample into the envelope.
+ *
+ * @return void
+ */
+void KY038::accumulate(void* context, uint16_t value)
+{
+    Envelope* envelope = reinterpret_cast<Envelope*>(context);
+
+    envelope->count++;
+    envelope->sum += value;
+    envelope->sum_of_squares += (uint32_t) value * value;
+
+    if (value < envelope->minimum) {
+        envelope->minimum = value;
+    }
+
+    if (value > envelope->maximum) {
+        envelope->maximum = value;
+    }
+}
@@ -8,15 +8,72 @@
 #define ky038_h
 
 #include "GenericAnalogSensor.h"
+#include "../FixedPoint.h"
+
+#define KY038_DEFAULT_WINDOW 50
+#define KY038_MAX_WINDOW 400
+
+// Keeps the sum of squares of 10-bit samples within 32 bits.
+#define KY038_MAX_SAMPLES 4096
 
 /*
  * KY038
  *
  * A class that is in charge of managing a Keyes Microphone Sound Detection sensor.
+ *
+ * Instead of a single instantaneous reading, the microphone is sampled at the
+ * full ADC rate over a window. The envelope of the signal is computed on the
+ * fly, without storing any samples.
  */
 class KY038: public GenericAnalogSensor {
+    protected:
+        uint16_t window = KY038_DEFAULT_WINDOW;
+        uint16_t peak_to_peak = 0;
+        uint16_t peak = 0;
+
+        struct Envelope {
+            uint16_t count;
+            uint16_t minimum;
+            uint16_t maximum;
+            uint32_t sum;
+            uint32_t sum_of_squares;
+        };
+
+        static void accumulate(void* context, uint16_t value);
+
     public:
-        KY038(uint8_t input_pin): GenericAnalogSensor(input_pin) {};
+        KY038(uint8_t input_pin, uint16_t window = KY038_DEFAULT_WINDOW): GenericAnalogSensor(input_pin, 0) {
+            this->window = window ? min(window, KY038_MAX_WINDOW) : KY038_DEFAULT_WINDOW;
+        };
+
+        void read();
+
+        /*
+         * getLevel
+         *
+         * Gets the RMS amplitude of the signal, in ADC steps.
+         */
+        inline uint16_t getLevel() const {
+            return this->level;
+        };
+
+        /*
+         * getPeakToPeak
+         *
+         * Gets the difference between the highest and lowest sample.
+         */
+        inline uint16_t getPeakToPeak() const {
+            return this->peak_to_peak;
+        };
+
+        /*
+         * getPeak
+         *
+         * Gets the largest deviation of a sample from the mean.
+         */
+        inline uint16_t getPeak() const {
+            return this->peak;
+        };
 };
 
 #endif
@@ -0,0 +1,82 @@
+#include "SensorAggregate.h"
+
+/**
+ * Add a value to the aggregate.
+ *
+ * @param int32_t value Value to add.
+ *
+ * @return void
+ */
+void SensorAggregate::add(int32_t value)
+{
+    if (!this->count || value < this->minimum) {
+        this->minimum = value;
+    }
+
+    if (!this->count || value > this->maximum) {
+        this->maximum = value;
+    }
+
+    this->sum += value;
+    this->count++;
+}
+
+/**
+ * Start a new window.
+ *
+ * @return void
+ */
+void SensorAggregate::reset()
+{
+    this->sum = 0;
+    this->count = 0;
+}
+
+/**
+ * Return the lowest value in the window.
+ *
+ * @return int32_t
+ */
+int32_t SensorAggregate::getMinimum() const
+{
+    return this->minimum;
+}
+
+/**
+ * Return the highest value in the window.
+ *
+ * @return int32_t
+ */
+int32_t SensorAggregate::getMaximum() const
+{
+    return this->maximum;
+}
+
+/**
+ * Return the mean of the values in the window, rounded to the nearest
+ * integer.
+ *
+ * @return int32_t
+ */
+int32_t SensorAggregate::getMean() const
+{
+    if (!this->count) {
+        return 0;
+    }
+
+    if (this->sum < 0) {
+        return (this->sum - (this->count / 2)) / this->count;
+    }
+
+    return (this->sum + (this->count / 2)) / this->count;
+}
+
+/**
+ * Return the amount of values in the window.
+ *
+ * @return uint8_t
+ */
+uint8_t SensorAggregate::getCount() const
+{
+    return this->count;
+}
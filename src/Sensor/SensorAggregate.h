@@ -0,0 +1,37 @@
+/**
+ * Windowed sensor value aggregate.
+ */
+
+#ifndef sensor_aggregate_h
+#define sensor_aggregate_h
+
+#include "../ArduinoHeader.h"
+
+// Largest amount of values in a window. Keeps the sum of 16-bit values well
+// within 32 bits.
+#define AGGREGATE_MAX_COUNT 255
+
+/*
+ * SensorAggregate
+ *
+ * A class that keeps the minimum, maximum, sum and count of the integer
+ * sensor values added since it was last reset.
+ */
+class SensorAggregate {
+    protected:
+        int32_t minimum = 0;
+        int32_t maximum = 0;
+        int32_t sum = 0;
+        uint8_t count = 0;
+
+    public:
+        void add(int32_t value);
+        void reset();
+
+        int32_t getMinimum() const;
+        int32_t getMaximum() const;
+        int32_t getMean() const;
+        uint8_t getCount() const;
+};
+
+#endif
@@ -0,0 +1,109 @@
+#include "SensorFilter.h"
+
+/**
+ * Pass a value through the filter.
+ *
+ * @param int32_t& value Value to filter. Replaced by the filtered value.
+ *
+ * @return bool False if the value was rejected as a spike and should be
+ *              dropped
+ */
+bool SensorFilter::apply(int32_t& value)
+{
+    uint8_t size;
+    uint8_t threshold;
+    uint8_t i;
+    int32_t sum;
+    int32_t delta;
+
+    threshold = FILTER_OPTION_SPIKE_THRESHOLD(this->options);
+
+    if (threshold && this->count) {
+        delta = value > this->last ? value - this->last : this->last - value;
+
+        if (delta > threshold && this->rejects < FILTER_SPIKE_MAX_REJECTS) {
+            this->rejects++;
+
+            return false;
+        }
+    }
+
+    this->rejects = 0;
+    this->last = value;
+
+    switch (FILTER_OPTION_TYPE(this->options)) {
+        case FILTER_TYPE_EMA:
+            if (!this->count) {
+                this->ema = value << FILTER_EMA_FRACTION_BITS;
+                this->count = 1;
+            } else {
+                this->ema += ((value << FILTER_EMA_FRACTION_BITS) - this->ema) >> FILTER_OPTION_PARAMETER(this->options);
+            }
+
+            value = (this->ema + (1 << (FILTER_EMA_FRACTION_BITS - 1))) >> FILTER_EMA_FRACTION_BITS;
+
+            break;
+
+        case FILTER_TYPE_MOVING_AVERAGE:
+        case FILTER_TYPE_MEDIAN:
+            size = FILTER_OPTION_PARAMETER(this->options) + 1;
+
+            this->window[this->index] = value;
+            this->index = (this->index + 1) % size;
+
+            if (this->count < size) {
+                this->count++;
+            }
+
+            if (FILTER_OPTION_TYPE(this->options) == FILTER_TYPE_MEDIAN) {
+                value = this->getMedian();
+            } else {
+                sum = 0;
+
+                for (i = 0; i < this->count; i++) {
+                    sum += this->window[i];
+                }
+
+                value = (sum + (this->count / 2)) / this->count;
+            }
+
+            break;
+
+        default:
+            this->count = 1;
+            break;
+    }
+
+    return true;
+}
+
+/**
+ * Return the median of the values currently in the window. For an even amount
+ * of values, the mean of the two middle values is returned.
+ *
+ * @return int32_t
+ */
+int32_t SensorFilter::getMedian() const
+{
+    int32_t sorted[FILTER_MAX_WINDOW];
+    int32_t value;
+    uint8_t i;
+    uint8_t j;
+
+    // Insertion sort; the window is tiny
+    for (i = 0; i < this->count; i++) {
+        value = this->window[i];
+
+        for (j = i; j > 0 && sorted[j - 1] > value; j--) {
+            sorted[j] = sorted[j - 1];
+        }
+
+        sorted[j] = value;
+    }
+
+    if (this->count % 2) {
+        return sorted[this->count / 2];
+    }
+
+    return (sorted[(this->count / 2) - 1] + sorted[this->count / 2]) / 2;
+}
@@ -0,0 +1,55 @@
+/**
+ * Fixed-point sensor value filter.
+ */
+
+#ifndef sensor_filter_h
+#define sensor_filter_h
+
+#include "../ArduinoHeader.h"
+
+#define FILTER_TYPE_NONE 0
+#define FILTER_TYPE_MOVING_AVERAGE 1
+#define FILTER_TYPE_EMA 2
+#define FILTER_TYPE_MEDIAN 3
+
+// Filter options are packed into a single configuration integer:
+// bits 0-1 contain the type, bits 2-4 the window size minus one (or the EMA
+// smoothing shift), bits 8-15 the spike rejection threshold.
+#define FILTER_OPTION_TYPE(options) ((options) & 0b11)
+#define FILTER_OPTION_PARAMETER(options) (((options) >> 2) & 0b111)
+#define FILTER_OPTION_SPIKE_THRESHOLD(options) (((options) >> 8) & 0xFF)
+
+#define FILTER_MAX_WINDOW 8
+#define FILTER_EMA_FRACTION_BITS 8
+
+// Amount of consecutive spikes after which a reading is accepted as a genuine
+// step change.
+#define FILTER_SPIKE_MAX_REJECTS 2
+
+/*
+ * SensorFilter
+ *
+ * A class that smooths a stream of integer sensor values using a moving
+ * average, an exponential moving average or a median, optionally preceded by
+ * spike rejection. All state is fixed in size and no floating point
+ * arithmetic is used.
+ */
+class SensorFilter {
+    protected:
+        uint16_t options;
+        uint8_t count = 0;
+        uint8_t index = 0;
+        uint8_t rejects = 0;
+        int32_t last = 0;
+        int32_t ema = 0;
+        int32_t window[FILTER_MAX_WINDOW];
+
+        int32_t getMedian() const;
+
+    public:
+        SensorFilter(uint16_t options = 0): options(options) {};
+
+        bool apply(int32_t& value);
+};
+
+#endif
@@ -0,0 +1,154 @@
+#include "VibrationFeatures.h"
+
+// sin(2 * pi * k / VIBRATION_WINDOW_SIZE) in Q15, for k up to three quarters
+// of a period; cosines are read a quarter period further.
+static const int16_t sine[(VIBRATION_WINDOW_SIZE * 3) / 4] PROGMEM = {
+    0, 6393, 12539, 18204, 23170, 27245, 30273, 32137,
+    32767, 32137, 30273, 27245, 23170, 18204, 12539, 6393,
+    0, -6393, -12539, -18204, -23170, -27245, -30273, -32137
+};
+
+/**
+ * Analyze a window of samples. The samples are overwritten with their
+ * deviation from the mean.
+ *
+ * @param int16_t* samples     VIBRATION_WINDOW_SIZE samples, oldest first.
+ * @param uint16_t sample_rate Sample rate in Hz.
+ *
+ * @return void
+ */
+void VibrationFeatures::analyze(int16_t* samples, uint16_t sample_rate)
+{
+    int16_t imaginary[VIBRATION_WINDOW_SIZE] = {};
+    int32_t sum = 0;
+    int16_t mean;
+    uint32_t sum_of_squares = 0;
+    uint32_t power;
+    uint16_t deviation;
+    uint8_t crossings = 0;
+    int8_t sign = 0;
+    uint8_t shift = 0;
+    uint8_t band;
+    uint8_t i;
+
+    for (i = 0; i < VIBRATION_WINDOW_SIZE; i++) {
+        sum += samples[i];
+    }
+
+    mean = sum >> VIBRATION_WINDOW_BITS;
+    this->peak = 0;
+
+    for (i = 0; i < VIBRATION_WINDOW_SIZE; i++) {
+        samples[i] -= mean;
+        deviation = abs(samples[i]);
+        sum_of_squares += (uint32_t) deviation * deviation;
+
+        if (deviation > this->peak) {
+            this->peak = deviation;
+        }
+
+        // Samples right on the mean don't count as a crossing
+        if (samples[i] && (samples[i] > 0 ? 1 : -1) != sign) {
+            if (sign) {
+                crossings++;
+            }
+
+            sign = samples[i] > 0 ? 1 : -1;
+        }
+    }
+
+    this->rms = sqrt32(sum_of_squares >> VIBRATION_WINDOW_BITS);
+    this->crest_factor = this->rms ? ((uint32_t) this->peak * 100) / this->rms : 0;
+    this->zero_crossing_rate = ((uint32_t) crossings * sample_rate) / (VIBRATION_WINDOW_SIZE - 1);
+
+    // Scale the samples up as far as the FFT allows, so small vibrations
+    // aren't lost to rounding; the FFT itself halves values at every stage
+    while (this->peak && (this->peak << shift) < 0x2000) {
+        shift++;
+    }
+
+    for (i = 0; i < VIBRATION_WINDOW_SIZE; i++) {
+        samples[i] <<= shift;
+    }
+
+    transform(samples, imaginary);
+
+    // The spectrum of a real signal is mirrored, so every bin below the
+    // Nyquist frequency counts twice; the Nyquist bin itself only once
+    for (band = 0; band < VIBRATION_BANDS; band++) {
+        power = 0;
+
+        for (i = (band * VIBRATION_BINS_PER_BAND) + 1; i <= (band + 1) * VIBRATION_BINS_PER_BAND; i++) {
+            power += ((int32_t) samples[i] * samples[i] + (int32_t) imaginary[i] * imaginary[i])
+                * (i < VIBRATION_WINDOW_SIZE / 2 ? 2 : 1);
+        }
+
+        this->bands[band] = sqrt32(power) >> shift;
+    }
+}
+
+/**
+ * In-place radix-2 FFT, scaled by 1 / VIBRATION_WINDOW_SIZE so every bin
+ * holds the amplitude of its frequency rather than a sum. Inputs must stay
+ * within 14 bits.
+ *
+ * @param int16_t* real      Real parts, replaced by the real output.
+ * @param int16_t* imaginary Imaginary parts, replaced by the imaginary output.
+ *
+ * @return void
+ */
+void VibrationFeatures::transform(int16_t* real, int16_t* imaginary)
+{
+    uint8_t i;
+    uint8_t j;
+    uint8_t bit;
+    uint8_t size;
+    uint8_t start;
+    uint8_t k;
+    int16_t swap;
+    int16_t twiddle_cosine;
+    int16_t twiddle_sine;
+    int32_t tr;
+    int32_t ti;
+
+    // Bit reversal permutation
+    for (i = 1, j = 0; i < VIBRATION_WINDOW_SIZE; i++) {
+        for (bit = VIBRATION_WINDOW_SIZE >> 1; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+
+        j |= bit;
+
+        if (i < j) {
+            swap = real[i];
+            real[i] = real[j];
+            real[j] = swap;
+
+            swap = imaginary[i];
+            imaginary[i] = imaginary[j];
+            imaginary[j] = swap;
+        }
+    }
+
+    for (size = 2; size <= VIBRATION_WINDOW_SIZE; size <<= 1) {
+        for (start = 0; start < VIBRATION_WINDOW_SIZE; start += size) {
+            for (k = 0; k < size / 2; k++) {
+                i = start + k;
+                j = i + (size / 2);
+
+                // Twiddle factor e^(-i * 2 * pi * k / size)
+                bit = k * (VIBRATION_WINDOW_SIZE / size);
+                twiddle_cosine = pgm_read_word(&sine[bit + (VIBRATION_WINDOW_SIZE / 4)]);
+                twiddle_sine = pgm_read_word(&sine[bit]);
+
+                tr = (((int32_t) twiddle_cosine * real[j]) + ((int32_t) twiddle_sine * imaginary[j])) >> 15;
+                ti = (((int32_t) twiddle_cosine * imaginary[j]) - ((int32_t) twiddle_sine * real[j])) >> 15;
+
+                real[j] = (real[i] - tr) >> 1;
+                imaginary[j] = (imaginary[i] - ti) >> 1;
+                real[i] = (real[i] + tr) >> 1;
+                imaginary[i] = (imaginary[i] + ti) >> 1;
+            }
+        }
+    }
+}
@@ -0,0 +1,101 @@
+/**
+ * Fixed-point vibration feature extraction.
+ */
+
+#ifndef vibration_features_h
+#define vibration_features_h
+
+#include "../ArduinoHeader.h"
+#include "../FixedPoint.h"
+
+#include <avr/pgmspace.h>
+
+// Amount of samples analyzed at once; a power of two for the FFT.
+#define VIBRATION_WINDOW_BITS 5
+#define VIBRATION_WINDOW_SIZE (1 << VIBRATION_WINDOW_BITS)
+
+// The spectrum above DC is split into equally wide bands.
+#define VIBRATION_BANDS 4
+#define VIBRATION_BINS_PER_BAND ((VIBRATION_WINDOW_SIZE / 2) / VIBRATION_BANDS)
+
+// Features to report, as packed into the vibration features configuration
+// integer.
+#define VIBRATION_FEATURE_RMS 0x01
+#define VIBRATION_FEATURE_PEAK 0x02
+#define VIBRATION_FEATURE_CREST_FACTOR 0x04
+#define VIBRATION_FEATURE_ZERO_CROSSING_RATE 0x08
+#define VIBRATION_FEATURE_BANDS 0x10
+
+// Crest factors are calculated with two decimals.
+#define VIBRATION_CREST_FACTOR_DECIMALS 2
+
+/*
+ * VibrationFeatures
+ *
+ * A class that condenses a window of samples of a single axis into a handful
+ * of features describing the vibration around its mean: RMS, peak, crest
+ * factor, zero-crossing rate and the RMS per frequency band. Band values come
+ * from a fixed-point FFT; no floating point arithmetic is used.
+ */
+class VibrationFeatures {
+    protected:
+        uint16_t rms = 0;
+        uint16_t peak = 0;
+        uint16_t crest_factor = 0;
+        uint16_t zero_crossing_rate = 0;
+        uint16_t bands[VIBRATION_BANDS] = {};
+
+        static void transform(int16_t* real, int16_t* imaginary);
+
+    public:
+        void analyze(int16_t* samples, uint16_t sample_rate);
+
+        /*
+         * getRms
+         *
+         * Gets the RMS of the signal around its mean, in sample units.
+         */
+        inline uint16_t getRms() const {
+            return this->rms;
+        };
+
+        /*
+         * getPeak
+         *
+         * Gets the largest deviation of a sample from the mean.
+         */
+        inline uint16_t getPeak() const {
+            return this->peak;
+        };
+
+        /*
+         * getCrestFactor
+         *
+         * Gets the ratio of the peak to the RMS, with two decimals.
+         */
+        inline uint16_t getCrestFactor() const {
+            return this->crest_factor;
+        };
+
+        /*
+         * getZeroCrossingRate
+         *
+         * Gets the amount of times per second the signal crosses its mean.
+         */
+        inline uint16_t getZeroCrossingRate() const {
+            return this->zero_crossing_rate;
+        };
+
+        /*
+         * getBand
+         *
+         * Gets the RMS of the signal within a frequency band, in sample units.
+         * Band n covers the frequencies from n / 4 up to (n + 1) / 4 of the
+         * Nyquist frequency.
+         */
+        inline uint16_t getBand(uint8_t band) const {
+            return this->bands[band];
+        };
+};
+
+#endif
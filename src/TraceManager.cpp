@@ -0,0 +1,83 @@
+#include "TraceManager.h"
+
+// Time of the previous record on the sleep-compensated clock.
+uint32_t TraceManager::last_record = 0;
+
+// Whether readings are being taken because of an interrupt.
+bool TraceManager::interrupt = false;
+
+/**
+ * Mark the readings that follow as taken because of an interrupt, or not.
+ *
+ * @param bool value Whether an interrupt is being handled.
+ *
+ * @return void
+ */
+void TraceManager::setInterrupt(bool value)
+{
+    interrupt = value;
+}
+
+/**
+ * Write a raw value read by a module's sensor to the serial port, if sensor
+ * tracing is enabled.
+ *
+ * @param uint8_t module_index Module index.
+ * @param uint8_t sensor_index Sensor index.
+ * @param uint8_t value_type   Type of the value.
+ * @param int32_t value        Value as read, before any filtering.
+ *
+ * @return void
+ */
+void TraceManager::record(uint8_t module_index, uint8_t sensor_index, uint8_t value_type, int32_t value)
+{
+    uint8_t buffer[TRACE_RECORD_MAX_SIZE];
+    uint8_t size = 1;
+    uint8_t checksum = 0;
+    uint32_t now;
+    uint8_t i;
+
+    if (!ConfigurationManager::getBoolean(CFG_SENSOR_TRACE)) {
+        return;
+    }
+
+    now = ClockManager::now();
+
+    buffer[0] = TRACE_RECORD_START;
+    size += encode(buffer + size, ((now - last_record) << 1) | (interrupt ? TRACE_FLAG_INTERRUPT : 0));
+    buffer[size++] = ((module_index & TRACE_MODULE_MASK) << TRACE_SENSOR_BITS) | (sensor_index & TRACE_SENSOR_MASK);
+    buffer[size++] = value_type;
+    size += encode(buffer + size, ((uint32_t) value << 1) ^ (uint32_t) (value >> 31));
+
+    for (i = 1; i < size; i++) {
+        checksum ^= buffer[i];
+    }
+
+    buffer[size++] = checksum;
+
+    Serial.write(buffer, size);
+
+    last_record = now;
+}
+
+/**
+ * Encode a value 7 bits at a time.
+ *
+ * @param uint8_t* buffer Buffer to encode into; up to 5 bytes are used.
+ * @param uint32_t value  Value to encode.
+ *
+ * @return uint8_t Amount of bytes used
+ */
+uint8_t TraceManager::encode(uint8_t* buffer, uint32_t value)
+{
+    uint8_t size = 0;
+
+    while (value >= 0x80) {
+        buffer[size++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+
+    buffer[size++] = value;
+
+    return size;
+}
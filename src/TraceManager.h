@@ -0,0 +1,42 @@
+#ifndef TRACE_MANAGER_H
+#define TRACE_MANAGER_H
+
+#include "ArduinoHeader.h"
+
+#include "ConfigurationManager.h"
+#include "ClockManager.h"
+
+// A trace is a stream of records, written to the serial port in between log
+// output. Every record starts with a byte that never occurs in log output,
+// followed by:
+//
+// - the time since the previous record in ms, shifted left by one, with the
+//   lowest bit set if the reading was taken because of an interrupt
+// - the module index in bits 3-6 and the sensor index in bits 0-2
+// - the value type
+// - the raw value, zigzag encoded so small negative values stay small
+// - the XOR of all of the above, to resynchronize on corrupted records
+//
+// Times and values are variable length: 7 bits per byte, least significant
+// first, with the highest bit set on every byte but the last.
+#define TRACE_RECORD_START 0xA5
+#define TRACE_RECORD_MAX_SIZE 14
+#define TRACE_FLAG_INTERRUPT 0b1
+
+#define TRACE_SENSOR_BITS 3
+#define TRACE_SENSOR_MASK 0b111
+#define TRACE_MODULE_MASK 0b1111
+
+class TraceManager {
+    public:
+        static void setInterrupt(bool value);
+        static void record(uint8_t module_index, uint8_t sensor_index, uint8_t value_type, int32_t value);
+
+    private:
+        static uint32_t last_record;
+        static bool interrupt;
+
+        static uint8_t encode(uint8_t* buffer, uint32_t value);
+};
+
+#endif
@@ -16,6 +16,8 @@ void setup()
     initConnection();
     initCommands();
     initInterrupts();
+    initAnalog();
+    initI2C();
     initModules();
 }
 
@@ -28,6 +30,8 @@ void loop()
 {
     handleConnection();
 
+    i2c::poll();
+    mod::pollModules();
     handleSensorUpdates();
     handlePowerState();
 
@@ -35,6 +39,9 @@ void loop()
         handleInterrupt();
     }
 
+    // Write buffered log output while idle
+    lgm::drain();
+
     gateway.wait(cfg::getInteger(CFG_LOOP_DELAY));
 }
 
@@ -49,8 +56,9 @@ void initLogging()
         Serial.end();
     }
 
+    // Levels are applied per subsystem, as lines are buffered
     Log.Init(
-        cfg::getBoolean(CFG_DEBUG) ? LOG_LEVEL_DEBUG : LOG_LEVEL_INFOS,
+        LOG_LEVEL_VERBOSE,
         //cfg::getInteger(CFG_SERIAL_BAUD_RATE)
         BAUD_RATE
     );
@@ -74,7 +82,7 @@ void initConfiguration()
  */
 void initConnection()
 {
-    gateway.begin(NULL, !cfg::getInteger(CFG_NODE_ADDRESS) ? AUTO : cfg::getInteger(CFG_NODE_ADDRESS));
+    gateway.begin(handleMessage, !cfg::getInteger(CFG_NODE_ADDRESS) ? AUTO : cfg::getInteger(CFG_NODE_ADDRESS));
     gateway.sendSketchInfo(KALMON_NAME, KALMON_VERSION, true);
 }
 
@@ -88,6 +96,62 @@ void handleConnection()
     gateway.process();
 }
 
+/**
+ * Handle a message from the gateway. Commands are sent to the node sensor as
+ * text, just like over serial, and are answered with the command, the status
+ * and the response values, as far as they fit in a message.
+ *
+ * @return void
+ */
+void handleMessage(const MyMessage& message)
+{
+    cmd::Response response;
+    char arguments[MAX_PAYLOAD + 1];
+    char reply[MAX_PAYLOAD + 1] = "";
+    char* end;
+    uint8_t command;
+    uint8_t status;
+
+    if (message.isAck()
+        || message.getCommand() != C_SET
+        || message.getSensor() != NODE_SENSOR_ID
+        || message.getType() != CV_COMMAND) {
+        return;
+    }
+
+    strncpy(arguments, message.getString(), sizeof(arguments) - 1);
+    arguments[sizeof(arguments) - 1] = '\0';
+
+    command = strtol(arguments, &end, 10);
+    end += *end == ' ';
+
+    lgm::debug(LOG_NET, F("net: command; cmd=%d, args=\"%s\""CR), command, end);
+
+    status = cmd::handleCommand(command, end, &response);
+
+    // Prefix the response values with the command and status
+    formatFixedPoint(reply, command, 0);
+    strcat(reply, " ");
+    formatFixedPoint(reply + strlen(reply), status, 0);
+    cmd::formatValues(response.data, response.size, reply, sizeof(reply));
+
+    sendCustomData(NODE_SENSOR_ID, CV_COMMAND_RESPONSE, reply);
+}
+
+// Command handlers, indexed by command.
+static const cmd::Callback command_handlers[] PROGMEM = {
+    // 0 - 9
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    // 10 - 19
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    // 20 - 29: device
+    NULL, getStats, performReset, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    // 30 - 39
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    // 40 - 45: configuration
+    NULL, loadConfiguration, saveConfiguration, getConfigurationValue, setConfigurationValue, clearChildIds
+};
+
 /**
  * Initialize the command manager.
  *
@@ -95,14 +159,29 @@ void handleConnection()
  */
 void initCommands()
 {
-    // Register command handlers
-    cmd::registerHandler(21, printStats);
-    cmd::registerHandler(22, performReset);
-
-    cmd::registerHandler(41, loadConfiguration);
-    cmd::registerHandler(42, saveConfiguration);
-    cmd::registerHandler(43, getConfigurationValue);
-    cmd::registerHandler(44, setConfigurationValue);
+    cmd::setHandlers(command_handlers, sizeof(command_handlers) / sizeof(command_handlers[0]));
+}
+
+/**
+ * Initialize the ADC sampler.
+ *
+ * @return void
+ */
+void initAnalog()
+{
+    adc::initialize();
+}
+
+/**
+ * Initialize the I2C bus and scan it for devices.
+ *
+ * @return void
+ */
+void initI2C()
+{
+    i2c::initialize();
+
+    lgm::debug(LOG_MOD, F("i2c: scanned; devices=%d"CR), i2c::scan());
 }
 
 /**
@@ -112,8 +191,8 @@ void initCommands()
  */
 void initModules()
 {
-    for (int i = CFG_MODULE_1_CONFIGURATION; i < (CFG_MODULE_1_CONFIGURATION + MODULE_AVAILABLE_SLOTS); i++) {
-        mod::registerModule(cfg::getString(i));
+    for (int i = 0; i < MODULE_AVAILABLE_SLOTS; i++) {
+        mod::registerModule(i, cfg::getString(CFG_MODULE_1_CONFIGURATION + i));
     }
 }
 
@@ -149,20 +228,25 @@ void initInterrupts()
  */
 void handlePowerState() {
     uint32_t sleep_duration;
+    uint32_t slept = 0;
+    uint32_t chunk;
+    uint16_t wakes = 0;
     uint8_t int_options;
     uint8_t int0_options;
     uint8_t int1_options;
-    uint8_t retval;
+    bool woken = false;
 
-    // If we have a waking period and it has expired, go to sleep
+    // If we have a waking period and it has expired, go to sleep; during a
+    // fast wake, go back to sleep as soon as there's nothing left to do
     if (current_power_state == PowerState::AWAKE
         && cfg::getInteger(CFG_POWER_WAKE_DURATION) > 0
         && ((cfg::getInteger(CFG_POWER_SLEEP_DURATION) > 0) || ((cfg::getInteger(CFG_POWER_INTERRUPT_OPTIONS) & POWER_INT0_INT1_ENABLED) > 0))
-        && (power_state_elapsed / 1000) >= cfg::getInteger(CFG_POWER_WAKE_DURATION)) {
-        Log.Debug(F("pwr: sleeping"CR));
-        gateway.wait(200);
+        && (((clk::now() - power_state_changed) / 1000) >= cfg::getInteger(CFG_POWER_WAKE_DURATION)
+            || (fast_wake && !interrupt && !isSensorUpdateDue()))) {
+        sleep_duration = (uint32_t) pwr::updateSleepDuration() * 1000;
+
+        lgm::debug(LOG_PWR, F("pwr: sleeping; duration=%ls, activity=%d"CR), (uint32_t) pwr::getSleepDuration(), pwr::getActivity());
 
-        sleep_duration = (uint32_t) cfg::getInteger(CFG_POWER_SLEEP_DURATION) * 1000;
         int_options = cfg::getInteger(CFG_POWER_INTERRUPT_OPTIONS);
         int0_options = (int_options & 0b1110) >> 1; // Bit 2 - Bit 4 contain the mode
         int1_options = (int_options & 0b11100000) >> 5; // Bit 5 - Bit 7 contain the mode
@@ -171,36 +255,65 @@ void handlePowerState() {
         // using a serial command
         current_power_state = PowerState::ASLEEP;
 
-        if ((int_options & POWER_INT0_INT1_ENABLED) == POWER_INT0_INT1_ENABLED) {
-            retval = gateway.sleep(0, int0_options, 1, int1_options, sleep_duration);
-            interrupt = retval != -1;
-        } else if (int_options & POWER_INT0_ENABLED) {
-            retval = gateway.sleep(0, int0_options, sleep_duration);
-            interrupt = retval == true;
-        } else if (int_options & POWER_INT1_ENABLED) {
-            retval = gateway.sleep(1, int1_options, sleep_duration);
-            interrupt = retval == true;
-        } else {
-            gateway.sleep(sleep_duration);
+        // Make sure no sweep, transaction or measurement is left running
+        // while powered down
+        adc::stop();
+        i2c::flush();
+        mod::flushModules();
+        flushMessages();
+        lgm::flush();
+
+        pwr::accountAwake();
+
+        // Sleep in chunks to keep track of the time slept, as millis() doesn't
+        // advance while asleep. An interrupt ends a chunk at an unknown
+        // moment, so half of that chunk is counted. Without a sleep duration,
+        // only an interrupt ends the sleep.
+        while (!woken && (!sleep_duration || slept < sleep_duration)) {
+            chunk = clk::getSleepChunk(sleep_duration ? sleep_duration - slept : 0);
+            wakes++;
+
+            if ((int_options & POWER_INT0_INT1_ENABLED) == POWER_INT0_INT1_ENABLED) {
+                woken = gateway.sleep(0, int0_options, 1, int1_options, chunk) != -1;
+            } else if (int_options & POWER_INT0_ENABLED) {
+                woken = gateway.sleep(0, int0_options, chunk);
+            } else if (int_options & POWER_INT1_ENABLED) {
+                woken = gateway.sleep(1, int1_options, chunk);
+            } else {
+                gateway.sleep(chunk);
+            }
+
+            slept += woken ? chunk / 2 : chunk;
         }
 
         current_power_state = PowerState::AWAKE;
+        interrupt = woken;
+
+        // Waking up from every chunk takes time of its own, spent awake
+        clk::addSleep(slept + (wakes * CLOCK_WAKE_TIME));
+        pwr::accountSleep(slept, wakes * CLOCK_WAKE_TIME);
 
-        // Reset all counting timers after a wakeup
-        power_state_elapsed = 0;
-        sensor_update_elapsed = 0;
+        // Start a new waking period. The sensor update timer keeps running
+        // across sleep, so updates keep their interval whatever the sleep
+        // pattern; during a fast wake, an update that has come due is sent
+        // right away.
+        fast_wake = cfg::getBoolean(CFG_POWER_FAST_WAKE);
+        setMessageBatching(fast_wake);
+
+        power_state_changed = clk::now();
 
         // Re-initialize interrupts after a wakeup
         initInterrupts();
 
-        Log.Debug(F("pwr: waking"CR));
+        lgm::debug(LOG_PWR, F("pwr: waking"CR));
     }
 }
 
 /**
  * Handler executed upon receiving serial input. This handler will append
  * received data to the buffer, and if a line ending is received, will trigger
- * the processing of the received input.
+ * the processing of the received input. Binary frames are passed on to the
+ * frame manager instead.
  *
  * @return void
  */
@@ -210,6 +323,11 @@ void serialEvent() {
     while (Serial.available()) {
         ch = (char) Serial.read();
 
+        // Binary frames are handled on their own, byte by byte
+        if (frm::receive(ch)) {
+            continue;
+        }
+
         // If we receive a newline, break the loop
         if (ch == '\n' || ch == '\r') {
             // Try to handle a command if our buffer isn't empty
@@ -227,34 +345,89 @@ void serialEvent() {
     }
 }
 
+// Lines the values of the stats command are logged as over serial, in the
+// order they're responded with.
+static const char stats_uptime[] PROGMEM = "uptime: %ss"CR;
+static const char stats_free[] PROGMEM = "free: %sB"CR;
+static const char stats_battery[] PROGMEM = "battery: %s%%"CR;
+static const char stats_voltage[] PROGMEM = "voltage: %smV"CR;
+static const char stats_sleep[] PROGMEM = "sleep: %ss"CR;
+static const char stats_activity[] PROGMEM = "activity: %s"CR;
+static const char stats_awake[] PROGMEM = "awake: %ss"CR;
+static const char stats_asleep[] PROGMEM = "asleep: %ss"CR;
+static const char stats_adc[] PROGMEM = "adc: %sms"CR;
+static const char stats_tx[] PROGMEM = "tx: %sms"CR;
+static const char stats_charge[] PROGMEM = "charge: %suAh"CR;
+static const char stats_lifetime[] PROGMEM = "lifetime: %sh"CR;
+static const char stats_dropped[] PROGMEM = "log dropped: %s"CR;
+
+static const char* const stats_formats[] PROGMEM = {
+    stats_uptime, stats_free, stats_battery, stats_voltage, stats_sleep,
+    stats_activity, stats_awake, stats_asleep, stats_adc, stats_tx,
+    stats_charge, stats_lifetime, stats_dropped
+};
+
 /**
- * Handle serial input when it is ready for processing.
+ * Handle serial input when it is ready for processing. The response values
+ * are formatted and logged one per line, labelled for the stats command.
  *
  * @return void
  */
 void handleSerialInput() {
-    uint8_t space_index;
+    cmd::Response response;
+    char input[COMMAND_INPUT_SIZE];
+    char value[COMMAND_VALUE_TEXT_SIZE];
+    const __FlashStringHelper* format;
+    char* arguments;
     uint8_t command;
-    char arguments[cfg::getInteger(CFG_SERIAL_INPUT_BUFFER_SIZE) - 2];
+    uint8_t status;
+    uint8_t offset;
+    uint8_t value_size;
+    uint8_t i;
+
+    if (serial_input.buffer.length() >= sizeof(input)) {
+        lgm::error(LOG_CMD, F("cmd: too long; max=%d"CR), sizeof(input) - 1);
 
-    // Try to find the index of the first space
-    // If no space was found, we set the index to the length of the string - 1
-    space_index = serial_input.buffer.indexOf(' ');
+        serial_input.buffer = "";
+        serial_input.ready = false;
 
-    if (space_index == -1) {
-        space_index = serial_input.buffer.length() - 1;
+        return;
     }
 
+    serial_input.buffer.toCharArray(input, sizeof(input));
+
     // Pass our command handler everything up to the first space converted to
     // int (command identifier) along with everything after the first space as
     // args
-    command = serial_input.buffer.substring(0, space_index).toInt();
-    serial_input.buffer.substring(space_index + 1).toCharArray(arguments, sizeof(arguments));
+    command = strtol(input, &arguments, 10);
+    arguments += *arguments == ' ';
+
+    lgm::debug(LOG_CMD, F("cmd: \"%d\"; args: \"%s\""CR), command, arguments);
+
+    status = cmd::handleCommand(command, arguments, &response);
+
+    if (status == COMMAND_STATUS_UNKNOWN) {
+        lgm::error(LOG_CMD, F("cmd: invalid"CR));
+    } else {
+        lgm::info(LOG_CMD, F("cmd: %d; status=%d"CR), command, status);
+
+        for (offset = 0, i = 0; offset < response.size; offset += value_size, i++) {
+            value_size = cmd::formatValue(response.data + offset, response.size - offset, value, sizeof(value));
+
+            if (!value_size) {
+                break;
+            }
 
-    Log.Debug(F("cmd: \"%d\"; args: \"%s\""CR), command, arguments);
+            if (command == 21 && i < sizeof(stats_formats) / sizeof(stats_formats[0])) {
+                format = reinterpret_cast<const __FlashStringHelper*>(pgm_read_ptr(&stats_formats[i]));
+                lgm::info(LOG_CMD, format, value);
+            } else {
+                lgm::info(LOG_CMD, F("cmd: value=%s"CR), value);
+            }
 
-    if (!cmd::handleCommand(command, arguments)) {
-        Log.Error(F("cmd: invalid"CR));
+            // Write lines out as they come, rather than crowd the log buffer
+            lgm::flush();
+        }
     }
 
     serial_input.buffer = "";
@@ -267,112 +440,197 @@ void handleSerialInput() {
  * @return void
  */
 void handleSensorUpdates() {
-    if (cfg::getInteger(CFG_SENSOR_UPDATE_INTERVAL) > 0
-        && (sensor_update_elapsed / 1000) >= cfg::getInteger(CFG_SENSOR_UPDATE_INTERVAL)) {
-        Log.Debug(F("mod: updating"CR));
+    if (isSensorUpdateDue()) {
+        lgm::debug(LOG_MOD, F("mod: updating"CR));
         mod::updateModules();
+        pwr::completeUpdate();
 
         // Submit the battery level and some other stats while we're at it
-        gateway.sendBatteryLevel(getBatteryLevel(), NETWORK_REQUEST_ACK);
+        sendBatteryLevel(getBatteryLevel());
+        sendCustomData(NODE_SENSOR_ID, CV_BATTERY_VOLTAGE, bat::getVoltage());
+        sendCustomData(NODE_SENSOR_ID, CV_SLEEP_DURATION, pwr::getSleepDuration());
         sendCustomData(NODE_SENSOR_ID, CV_AVAILABLE_MEMORY, getFreeMemory());
 
-        sensor_update_elapsed = 0;
+        // Energy figures change slowly, so they're only sent every so often
+        if (cfg::getInteger(CFG_ENERGY_REPORT_INTERVAL) > 0
+            && ++energy_report_updates >= cfg::getInteger(CFG_ENERGY_REPORT_INTERVAL)) {
+            sendEnergyStats();
+            energy_report_updates = 0;
+        }
+
+        last_sensor_update = clk::now();
     }
 }
 
+/**
+ * Returns whether a sensor update is due.
+ *
+ * @return bool
+ */
+bool isSensorUpdateDue() {
+    return cfg::getInteger(CFG_SENSOR_UPDATE_INTERVAL) > 0
+        && ((clk::now() - last_sensor_update) / 1000) >= cfg::getInteger(CFG_SENSOR_UPDATE_INTERVAL);
+}
+
+/**
+ * Send the time spent in every power state and the estimated charge consumed.
+ *
+ * @return void
+ */
+void sendEnergyStats() {
+    pwr::accountAwake();
+
+    sendCustomData(NODE_SENSOR_ID, CV_AWAKE_TIME, (int32_t) pwr::getAwakeTime(), 0);
+    sendCustomData(NODE_SENSOR_ID, CV_SLEEP_TIME, (int32_t) pwr::getSleepTime(), 0);
+    sendCustomData(NODE_SENSOR_ID, CV_CONVERSION_TIME, (int32_t) pwr::getConversionTime(), 3);
+    sendCustomData(NODE_SENSOR_ID, CV_TRANSMIT_TIME, (int32_t) pwr::getTransmitTime(), 3);
+    sendCustomData(NODE_SENSOR_ID, CV_CHARGE_CONSUMED, (int32_t) pwr::getCharge(), 3);
+    sendCustomData(NODE_SENSOR_ID, CV_PROJECTED_LIFETIME, (int32_t) pwr::getProjectedLifetime(), 0);
+}
+
 /**
  * Returns the amount of free memory in bytes.
  *
  * @return int
  */
 int getFreeMemory() {
+    #ifdef KALMON_SIMULATION
+    return simulateFreeMemory();
+    #else
     extern int __heap_start, *__brkval;
     int v;
     return (int) &v - (__brkval == 0 ? (int) &__heap_start : (int) __brkval);
+    #endif
 }
 
 /**
- * Returns the current battery level as a percentage.
+ * Measures and returns the current battery level as a percentage.
  *
  * @return uint8_t
  */
 uint8_t getBatteryLevel() {
-    // @TODO Add support for measuring battery voltage
-    return 100;
+    bat::measure();
+
+    return bat::getLevel();
 }
 
 /**
- * Prints stats.
+ * Get stats: uptime in s, free memory in B, battery level in %, battery
+ * voltage in mV, sleep duration in s, activity, time awake and asleep in s,
+ * conversion and transmit time in ms, charge consumed in uAh, projected
+ * lifetime in h and log lines dropped.
  *
- * @return void
+ * @return uint8_t Status
  */
-void printStats(char* args) {
-    Log.Info(F("free: %dB"CR), getFreeMemory());
-    Log.Info(F("battery: %d%%"CR), getBatteryLevel());
+uint8_t getStats(char* args, cmd::Response* response) {
+    response->addInteger(clk::now() / 1000);
+    response->addInteger(getFreeMemory());
+    response->addInteger(getBatteryLevel());
+    response->addInteger(bat::getVoltage());
+    response->addInteger(pwr::getSleepDuration());
+    response->addInteger(pwr::getActivity());
+
+    pwr::accountAwake();
+
+    response->addInteger(pwr::getAwakeTime());
+    response->addInteger(pwr::getSleepTime());
+    response->addInteger(pwr::getConversionTime());
+    response->addInteger(pwr::getTransmitTime());
+    response->addInteger(pwr::getCharge());
+    response->addInteger(pwr::getProjectedLifetime());
+    response->addInteger(lgm::getDropped());
+
+    return COMMAND_STATUS_OK;
 }
 
 /**
  * Performs a soft reset.
  *
- * @return void
+ * @return uint8_t Status
  */
-void performReset(char* args) {
-    Log.Info(F("reset"CR));
+uint8_t performReset(char* args, cmd::Response* response) {
+    lgm::info(LOG_CMD, F("reset"CR));
+    lgm::flush();
     gateway.wait(200);
 
+    #ifdef KALMON_SIMULATION
+    simulateReset();
+    #else
     asm volatile("  jmp 0");
+    #endif
+
+    return COMMAND_STATUS_OK;
 }
 
 /**
  * Load configuration.
  *
- * @return void
+ * @return uint8_t Status
  */
-void loadConfiguration(char* args) {
+uint8_t loadConfiguration(char* args, cmd::Response* response) {
     cfg::load();
+
+    return COMMAND_STATUS_OK;
 }
 
 /**
  * Save configuration.
  *
- * @return void
+ * @return uint8_t Status
  */
-void saveConfiguration(char* args) {
+uint8_t saveConfiguration(char* args, cmd::Response* response) {
     cfg::save();
+
+    return COMMAND_STATUS_OK;
 }
 
 /**
- * Retrieve and print a configuration value.
+ * Add a configuration value to a response, preceded by its key.
  *
  * @return void
  */
-void getConfigurationValue(char* args) {
+void addConfigurationValue(uint8_t key, cmd::Response* response) {
+    response->addInteger(key);
+
+    if (key >= CONFIG_STRINGS_OFFSET) {
+        response->addString(cfg::getString(key));
+    } else if (key >= CONFIG_INTEGERS_OFFSET) {
+        response->addInteger(cfg::getInteger(key));
+    } else {
+        response->addInteger(cfg::getBoolean(key));
+    }
+}
+
+/**
+ * Retrieve a configuration value, responding with its key and value.
+ *
+ * @return uint8_t Status
+ */
+uint8_t getConfigurationValue(char* args, cmd::Response* response) {
     uint8_t key;
     char* errstr;
 
     key = strtol(args, &errstr, 10);
 
     if (key >= (CONFIG_STRINGS_AVAILABLE_SLOTS + CONFIG_STRINGS_OFFSET)) {
-        Log.Error(F("cfg: key out of bounds; max=%d"CR), (CONFIG_STRINGS_AVAILABLE_SLOTS + CONFIG_STRINGS_OFFSET - 1));
-    } else if (*errstr) {
-        Log.Error(F("cfg: error converting key; part=%s"CR), errstr);
+        lgm::error(LOG_CFG, F("cfg: key out of bounds; max=%d"CR), (CONFIG_STRINGS_AVAILABLE_SLOTS + CONFIG_STRINGS_OFFSET - 1));
+    } else if (*errstr || errstr == args) {
+        lgm::error(LOG_CFG, F("cfg: error converting key; part=%s"CR), errstr);
     } else {
-        if (key >= CONFIG_STRINGS_OFFSET) {
-            Log.Info(F("cfg: %s=%s"CR), args, cfg::getString(key));
-        } else if (key >= CONFIG_INTEGERS_OFFSET) {
-            Log.Info(F("cfg: %s=%d"CR), args, cfg::getInteger(key));
-        } else {
-            Log.Info(F("cfg: %s=%d"CR), args, cfg::getBoolean(key));
-        }
+        addConfigurationValue(key, response);
+
+        return COMMAND_STATUS_OK;
     }
+
+    return COMMAND_STATUS_INVALID_ARGUMENTS;
 }
 
 /**
- * Set a configuration value.
+ * Set a configuration value, responding with its key and new value.
  *
- * @return void
+ * @return uint8_t Status
  */
-void setConfigurationValue(char* args) {
+uint8_t setConfigurationValue(char* args, cmd::Response* response) {
     uint8_t key;
     uint16_t value;
     char* errstr;
@@ -382,32 +640,53 @@ void setConfigurationValue(char* args) {
     key_tok = strtok(args, " ");
     value_tok = strtok(NULL, " ");
 
-    if (*key_tok && *value_tok) {
-        key = strtol(key_tok, &errstr, 10);
+    if (key_tok == NULL || value_tok == NULL) {
+        return COMMAND_STATUS_INVALID_ARGUMENTS;
+    }
 
-        if (key >= (CONFIG_STRINGS_AVAILABLE_SLOTS + CONFIG_STRINGS_OFFSET - 1)) {
-            Log.Error(F("cfg: key out of bounds; max=%d"CR), (CONFIG_STRINGS_AVAILABLE_SLOTS + CONFIG_STRINGS_OFFSET - 1));
-        } else if (*errstr) {
-            Log.Error(F("cfg: error converting key; part=%s"CR), errstr);
-        } else {
-            if (key >= CONFIG_STRINGS_OFFSET) {
-                cfg::setString(key, value_tok);
-                Log.Info(F("cfg: %d=%s"CR), key, value_tok);
-            } else if (key >= CONFIG_INTEGERS_OFFSET) {
-                value = strtol(value_tok, &errstr, 10);
-
-                if (*errstr) {
-                    Log.Error(F("cfg: error converting value; part=%s"CR), errstr);
-                } else {
-                    cfg::setInteger(key, value);
-                    Log.Info(F("cfg: %d=%d"CR), key, value);
-                }
-            } else {
-                cfg::setBoolean(key, value_tok[0] == '1');
-                Log.Info(F("cfg: %d=%d"CR), key, value_tok[0] == '1');
+    key = strtol(key_tok, &errstr, 10);
+
+    if (key >= (CONFIG_STRINGS_AVAILABLE_SLOTS + CONFIG_STRINGS_OFFSET - 1)) {
+        lgm::error(LOG_CFG, F("cfg: key out of bounds; max=%d"CR), (CONFIG_STRINGS_AVAILABLE_SLOTS + CONFIG_STRINGS_OFFSET - 1));
+    } else if (*errstr) {
+        lgm::error(LOG_CFG, F("cfg: error converting key; part=%s"CR), errstr);
+    } else {
+        if (key >= CONFIG_STRINGS_OFFSET) {
+            if (!cfg::setString(key, value_tok)) {
+                return COMMAND_STATUS_INVALID_ARGUMENTS;
+            }
+        } else if (key >= CONFIG_INTEGERS_OFFSET) {
+            value = strtol(value_tok, &errstr, 10);
+
+            if (*errstr) {
+                lgm::error(LOG_CFG, F("cfg: error converting value; part=%s"CR), errstr);
+
+                return COMMAND_STATUS_INVALID_ARGUMENTS;
             }
+
+            cfg::setInteger(key, value);
+        } else {
+            cfg::setBoolean(key, value_tok[0] == '1');
         }
+
+        addConfigurationValue(key, response);
+
+        return COMMAND_STATUS_OK;
     }
+
+    return COMMAND_STATUS_INVALID_ARGUMENTS;
+}
+
+/**
+ * Release all allocated child sensor IDs. IDs are allocated again as sensors
+ * are presented, so a reset is required for the new IDs to take effect.
+ *
+ * @return uint8_t Status
+ */
+uint8_t clearChildIds(char* args, cmd::Response* response) {
+    cfg::clearChildIds();
+
+    return COMMAND_STATUS_OK;
 }
 
 /**
@@ -427,8 +706,14 @@ void onInterrupt()
  */
 void handleInterrupt()
 {
-    // Trigger a sensor update
+    pwr::recordInterrupt();
+
+    // Trigger a sensor update, which doesn't count as a scheduled update
+    trc::setInterrupt(true);
+    pwr::setInterrupt(true);
     mod::updateModules();
+    pwr::setInterrupt(false);
+    trc::setInterrupt(false);
 
     interrupt = false;
 }
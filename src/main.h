@@ -4,16 +4,31 @@
 #include "KalmonVersion.h"
 
 #include <Logging.h>
-#include <elapsedMillis.h>
 
 #include "Network.h"
 #include "ConfigurationManager.h"
 #include "CommandManager.h"
 #include "ModuleManager.h"
+#include "AdcManager.h"
+#include "I2CManager.h"
+#include "BatteryManager.h"
+#include "PowerManager.h"
+#include "ClockManager.h"
+#include "TraceManager.h"
+#include "FrameManager.h"
+#include "LogManager.h"
 
 #define cfg ConfigurationManager
 #define cmd CommandManager
 #define mod ModuleManager
+#define adc AdcManager
+#define i2c I2CManager
+#define bat BatteryManager
+#define pwr PowerManager
+#define clk ClockManager
+#define trc TraceManager
+#define frm FrameManager
+#define lgm LogManager
 
 #define POWER_INT0_INT1_ENABLED 0b00010001
 
@@ -43,22 +58,33 @@ static struct {
     ""
 };
 
-static elapsedMillis sensor_update_elapsed;
-static elapsedMillis power_state_elapsed;
+// Timestamps on the sleep-compensated clock.
+static uint32_t last_sensor_update = 0;
+static uint32_t power_state_changed = 0;
+
+static uint16_t energy_report_updates = 0;
 
 static bool interrupt = false;
 
+// Whether the device woke up to do its work and go back to sleep right away.
+static bool fast_wake = false;
+
 void initLogging();
 void initCommands();
 void initConfiguration();
 void initConnection();
+void initAnalog();
+void initI2C();
 void initModules();
 void initInterrupts();
 
 void handlePowerState();
 void handleSerialInput();
 void handleSensorUpdates();
+bool isSensorUpdateDue();
+void sendEnergyStats();
 void handleConnection();
+void handleMessage(const MyMessage& message);
 
 void onInterrupt();
 void handleInterrupt();
@@ -66,10 +92,12 @@ void handleInterrupt();
 int getFreeMemory();
 uint8_t getBatteryLevel();
 
-void printStats(char* = NULL);
-void performReset(char* = NULL);
+uint8_t getStats(char* args, cmd::Response* response);
+uint8_t performReset(char* args, cmd::Response* response);
 
-void loadConfiguration(char* = NULL);
-void saveConfiguration(char* = NULL);
-void getConfigurationValue(char* args);
-void setConfigurationValue(char* args);
+uint8_t loadConfiguration(char* args, cmd::Response* response);
+uint8_t saveConfiguration(char* args, cmd::Response* response);
+void addConfigurationValue(uint8_t key, cmd::Response* response);
+uint8_t getConfigurationValue(char* args, cmd::Response* response);
+uint8_t setConfigurationValue(char* args, cmd::Response* response);
+uint8_t clearChildIds(char* args, cmd::Response* response);